@@ -0,0 +1,218 @@
+# 各转换器共用的核心库：谱面中间表示、格式识别、各格式解码器和批量流水线
+# 由 malody/、cylheim/、lanotalium/ 和 tbc/ 的 CMakeLists.txt 通过 include() 引入
+
+set(BLOPHY_ROOT ${CMAKE_CURRENT_LIST_DIR}/..)
+
+# 可选的动态库 libblophy，供编辑器等程序进程内调用（接口见 includes/blophy.h）
+option(BLOPHY_BUILD_SHARED_LIBRARY "同时生成 blophy 动态库" OFF)
+if (BLOPHY_BUILD_SHARED_LIBRARY)
+    # 动态库会链接子模块的静态库
+    set(CMAKE_POSITION_INDEPENDENT_CODE ON)
+endif ()
+
+# 链接时优化，对转换器、cJSON 和 miniz 同时生效，使 cJSON 访问函数和 miniz 解压能内联进热点循环
+option(BLOPHY_ENABLE_LTO "启用链接时优化 (LTO)" OFF)
+if (BLOPHY_ENABLE_LTO)
+    if (CMAKE_VERSION VERSION_LESS 3.9)
+        message(WARNING "LTO 需要 CMake 3.9 以上，已忽略 BLOPHY_ENABLE_LTO")
+    else ()
+        include(CheckIPOSupported)
+        check_ipo_supported(RESULT BLOPHY_IPO_SUPPORTED OUTPUT BLOPHY_IPO_OUTPUT LANGUAGES C)
+        if (BLOPHY_IPO_SUPPORTED)
+            message(STATUS "启用链接时优化")
+            # 子模块的 cmake_minimum_required 较旧时也按新策略处理 INTERPROCEDURAL_OPTIMIZATION
+            set(CMAKE_POLICY_DEFAULT_CMP0069 NEW)
+            set(CMAKE_INTERPROCEDURAL_OPTIMIZATION ON)
+        else ()
+            message(WARNING "编译器不支持 LTO: ${BLOPHY_IPO_OUTPUT}")
+        endif ()
+    endif ()
+endif ()
+
+# USDT 静态探针（见 includes/trace.h），系统有 <sys/sdt.h> 时自动启用，未挂载时只是 nop
+option(BLOPHY_ENABLE_USDT "在阶段边界加入 USDT 静态探针" ON)
+if (NOT BLOPHY_ENABLE_USDT)
+    add_definitions(-DBLOPHY_NO_USDT)
+endif ()
+
+# 配置文件引导优化 (PGO)：GENERATE 生成插桩程序，USE 使用 BLOPHY_PGO_DIR 中的配置文件重新编译。
+# 一般通过 pgo 目标自动完成两步（见 blophy_add_pgo_target）
+set(BLOPHY_PGO OFF CACHE STRING "PGO 阶段: OFF、GENERATE 或 USE")
+set_property(CACHE BLOPHY_PGO PROPERTY STRINGS OFF GENERATE USE)
+set(BLOPHY_PGO_DIR ${CMAKE_BINARY_DIR}/pgo-profile CACHE PATH "PGO 配置文件目录")
+if (BLOPHY_PGO AND NOT BLOPHY_PGO STREQUAL "OFF")
+    if (CMAKE_C_COMPILER_ID STREQUAL "GNU")
+        if (BLOPHY_PGO STREQUAL "GENERATE")
+            # 批量模式是多线程的，计数器需要原子更新
+            set(BLOPHY_PGO_FLAGS "-fprofile-generate=${BLOPHY_PGO_DIR} -fprofile-update=atomic")
+        else ()
+            set(BLOPHY_PGO_FLAGS "-fprofile-use=${BLOPHY_PGO_DIR} -fprofile-correction -Wno-missing-profile")
+            if (NOT CMAKE_C_COMPILER_VERSION VERSION_LESS 10)
+                # 语料没有覆盖到的代码仍按普通 -O2/-O3 优化，而不是当作冷代码
+                set(BLOPHY_PGO_FLAGS "${BLOPHY_PGO_FLAGS} -fprofile-partial-training")
+            endif ()
+        endif ()
+    elseif (CMAKE_C_COMPILER_ID MATCHES "Clang")
+        if (BLOPHY_PGO STREQUAL "GENERATE")
+            set(BLOPHY_PGO_FLAGS "-fprofile-generate=${BLOPHY_PGO_DIR}")
+        else ()
+            # 训练得到的 .profraw 需先用 llvm-profdata 合并
+            set(BLOPHY_PGO_FLAGS "-fprofile-use=${BLOPHY_PGO_DIR}/default.profdata -Wno-profile-instr-unprofiled -Wno-profile-instr-out-of-date")
+        endif ()
+    else ()
+        message(FATAL_ERROR "PGO 只支持 GCC 和 Clang，当前编译器: ${CMAKE_C_COMPILER_ID}")
+    endif ()
+    message(STATUS "PGO 阶段 ${BLOPHY_PGO}: ${BLOPHY_PGO_DIR}")
+    # 通过全局编译选项对子模块一并生效
+    set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${BLOPHY_PGO_FLAGS}")
+    set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} ${BLOPHY_PGO_FLAGS}")
+    set(CMAKE_SHARED_LINKER_FLAGS "${CMAKE_SHARED_LINKER_FLAGS} ${BLOPHY_PGO_FLAGS}")
+endif ()
+
+# 两步 PGO 目标：在 <构建目录>/pgo 中生成插桩程序，用合成谱面语料训练后以配置文件重新编译，
+# 结果为 <构建目录>/pgo/build/<可执行文件>。交叉编译时通过 CMAKE_CROSSCOMPILING_EMULATOR 运行插桩程序。
+# ARGS 中 @CORPUS@ 替换为语料目录、@OUTPUT@ 替换为输出目录；指定 EACH <通配符> 时
+# 对语料中每个匹配的文件运行一次，@INPUT@ 替换为该文件
+function(blophy_add_pgo_target target)
+    cmake_parse_arguments(PGO "" "EACH" "ARGS" ${ARGN})
+    if (CMAKE_C_COMPILER_ID MATCHES "Clang")
+        get_filename_component(compiler_dir ${CMAKE_C_COMPILER} DIRECTORY)
+        find_program(BLOPHY_LLVM_PROFDATA NAMES llvm-profdata HINTS ${compiler_dir})
+    endif ()
+    string(REPLACE ";" "|" train_args "${PGO_ARGS}")
+    string(REPLACE ";" "|" emulator "${CMAKE_CROSSCOMPILING_EMULATOR}")
+    add_custom_target(pgo
+            COMMAND ${CMAKE_COMMAND}
+            -DPGO_SOURCE_DIR=${CMAKE_SOURCE_DIR}
+            -DPGO_BINARY_DIR=${CMAKE_BINARY_DIR}/pgo
+            -DPGO_GENERATOR=${CMAKE_GENERATOR}
+            -DPGO_TARGET=${target}
+            -DPGO_TRAIN_ARGS=${train_args}
+            -DPGO_EACH=${PGO_EACH}
+            -DPGO_EMULATOR=${emulator}
+            -DPGO_COMPILER_ID=${CMAKE_C_COMPILER_ID}
+            -DPGO_C_COMPILER=${CMAKE_C_COMPILER}
+            -DPGO_LLVM_PROFDATA=${BLOPHY_LLVM_PROFDATA}
+            -DPGO_ENABLE_LTO=${BLOPHY_ENABLE_LTO}
+            -DPGO_ARM_BUILD=${ARM_BUILD}
+            -P ${BLOPHY_ROOT}/cmake/blophy_pgo.cmake
+            COMMENT "两步 PGO 构建 ${target}"
+            USES_TERMINAL
+            VERBATIM
+    )
+endfunction()
+
+# 添加子模块
+add_subdirectory(${BLOPHY_ROOT}/thirdparty/cJSON ${CMAKE_BINARY_DIR}/cJSON)
+add_subdirectory(${BLOPHY_ROOT}/thirdparty/miniz ${CMAKE_BINARY_DIR}/miniz)
+
+set(BLOPHY_CORE_SOURCES
+        ${BLOPHY_ROOT}/includes/cross_platform.h
+        ${BLOPHY_ROOT}/includes/file_utils.h
+        ${BLOPHY_ROOT}/includes/file_utils.c
+        ${BLOPHY_ROOT}/includes/json_reader.h
+        ${BLOPHY_ROOT}/includes/json_reader.c
+        ${BLOPHY_ROOT}/includes/chart_validate.h
+        ${BLOPHY_ROOT}/includes/chart_validate.c
+        ${BLOPHY_ROOT}/includes/schema_decode.h
+        ${BLOPHY_ROOT}/includes/schema_decode.c
+        ${BLOPHY_ROOT}/includes/json_writer.h
+        ${BLOPHY_ROOT}/includes/json_writer.c
+        ${BLOPHY_ROOT}/includes/deflate_stream.h
+        ${BLOPHY_ROOT}/includes/deflate_stream.c
+        ${BLOPHY_ROOT}/includes/chart_ir.h
+        ${BLOPHY_ROOT}/includes/chart_ir.c
+        ${BLOPHY_ROOT}/includes/chart_format.h
+        ${BLOPHY_ROOT}/includes/chart_format.c
+        ${BLOPHY_ROOT}/includes/chart_stats.h
+        ${BLOPHY_ROOT}/includes/chart_stats.c
+        ${BLOPHY_ROOT}/includes/blophy.h
+        ${BLOPHY_ROOT}/includes/blophy.c
+        ${BLOPHY_ROOT}/includes/thread_pool.h
+        ${BLOPHY_ROOT}/includes/thread_pool.c
+        ${BLOPHY_ROOT}/includes/bounded_queue.h
+        ${BLOPHY_ROOT}/includes/bounded_queue.c
+        ${BLOPHY_ROOT}/includes/metrics.h
+        ${BLOPHY_ROOT}/includes/metrics.c
+        ${BLOPHY_ROOT}/includes/trace.h
+        ${BLOPHY_ROOT}/includes/trace.c
+        ${BLOPHY_ROOT}/malody/mc_decode.h
+        ${BLOPHY_ROOT}/malody/mc_decode.c
+        ${BLOPHY_ROOT}/malody/create_bpmlist.h
+        ${BLOPHY_ROOT}/malody/create_bpmlist.c
+        ${BLOPHY_ROOT}/malody/tools.h
+        ${BLOPHY_ROOT}/malody/audio_length.c
+        ${BLOPHY_ROOT}/malody/batch.h
+        ${BLOPHY_ROOT}/malody/batch.c
+        ${BLOPHY_ROOT}/malody/batch_crawl.h
+        ${BLOPHY_ROOT}/malody/batch_crawl.c
+        ${BLOPHY_ROOT}/malody/batch_io.h
+        ${BLOPHY_ROOT}/malody/batch_io.c
+        ${BLOPHY_ROOT}/malody/batch_journal.h
+        ${BLOPHY_ROOT}/malody/batch_journal.c
+        ${BLOPHY_ROOT}/malody/batch_shard.h
+        ${BLOPHY_ROOT}/malody/batch_shard.c
+        ${BLOPHY_ROOT}/cylheim/cylheim_decode.h
+        ${BLOPHY_ROOT}/cylheim/cylheim_decode.c
+        ${BLOPHY_ROOT}/cylheim/process_tempo.h
+        ${BLOPHY_ROOT}/cylheim/process_tempo.c
+        ${BLOPHY_ROOT}/cylheim/create_bpmlist.h
+        ${BLOPHY_ROOT}/cylheim/create_bpmlist.c
+        ${BLOPHY_ROOT}/lanotalium/lanota_decode.h
+        ${BLOPHY_ROOT}/lanotalium/lanota_decode.c
+        ${BLOPHY_ROOT}/lanotalium/create_bpmlist.h
+        ${BLOPHY_ROOT}/lanotalium/create_bpmlist.c
+)
+
+add_library(blophy_core STATIC ${BLOPHY_CORE_SOURCES})
+set(BLOPHY_CORE_TARGETS blophy_core)
+
+if (BLOPHY_BUILD_SHARED_LIBRARY)
+    add_library(blophy SHARED ${BLOPHY_CORE_SOURCES})
+    # 只导出 blophy.h 中标记为 BLOPHY_API 的函数
+    target_compile_definitions(blophy PRIVATE BLOPHY_BUILD PUBLIC BLOPHY_SHARED)
+    set_target_properties(blophy PROPERTIES C_VISIBILITY_PRESET hidden)
+    # 静态链接进来的 cJSON、miniz 不受上面的可见性设置影响，链接时同样隐藏，
+    # 避免与调用方自带的同名库冲突（macOS 的 ld 没有这个选项，Windows 只导出 dllexport 的函数）
+    if (UNIX AND NOT APPLE)
+        set_property(TARGET blophy APPEND_STRING PROPERTY LINK_FLAGS " -Wl,--exclude-libs,ALL")
+    endif ()
+    list(APPEND BLOPHY_CORE_TARGETS blophy)
+endif ()
+
+foreach (target ${BLOPHY_CORE_TARGETS})
+    target_compile_definitions(${target} PUBLIC
+            $<$<CONFIG:Debug>:DEBUG>
+    )
+
+    # 设置 include 目录
+    target_include_directories(${target} PUBLIC
+            ${BLOPHY_ROOT}/thirdparty/cJSON
+            ${BLOPHY_ROOT}/thirdparty/miniz
+            ${CMAKE_BINARY_DIR}/miniz
+            ${CMAKE_BINARY_DIR}/cJSON
+    )
+endforeach ()
+
+# 批量模式可选的 io_uring 后端
+option(MTBC_ENABLE_IO_URING "批量模式使用 io_uring（需要 liburing）" ON)
+if (MTBC_ENABLE_IO_URING AND CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    find_path(LIBURING_INCLUDE_DIR liburing.h)
+    find_library(LIBURING_LIBRARY uring)
+    if (LIBURING_INCLUDE_DIR AND LIBURING_LIBRARY)
+        message(STATUS "批量模式启用 io_uring: ${LIBURING_LIBRARY}")
+        foreach (target ${BLOPHY_CORE_TARGETS})
+            target_compile_definitions(${target} PRIVATE HAVE_LIBURING)
+            target_include_directories(${target} PRIVATE ${LIBURING_INCLUDE_DIR})
+            target_link_libraries(${target} PUBLIC ${LIBURING_LIBRARY})
+        endforeach ()
+    else ()
+        message(STATUS "未找到 liburing，批量模式使用标准库读写")
+    endif ()
+endif ()
+
+# 链接库
+find_package(Threads REQUIRED)
+foreach (target ${BLOPHY_CORE_TARGETS})
+    target_link_libraries(${target} PUBLIC cjson miniz Threads::Threads)
+endforeach ()
@@ -0,0 +1,99 @@
+# 两步 PGO 构建脚本，由 blophy_add_pgo_target 生成的 pgo 目标以 cmake -P 方式调用：
+#   1. 以 BLOPHY_PGO=GENERATE 配置并编译插桩程序
+#   2. 生成合成谱面语料并运行插桩程序收集配置文件
+#   3. 在同一构建目录以 BLOPHY_PGO=USE 重新配置并编译
+# 两步共用一个构建目录，GCC 按目标文件路径查找 .gcda，目录不同会匹配不上
+
+cmake_minimum_required(VERSION 3.5)
+
+foreach (var PGO_SOURCE_DIR PGO_BINARY_DIR PGO_TARGET PGO_GENERATOR)
+    if (NOT ${var})
+        message(FATAL_ERROR "缺少参数 ${var}")
+    endif ()
+endforeach ()
+
+include(${CMAKE_CURRENT_LIST_DIR}/blophy_pgo_corpus.cmake)
+
+set(build_dir ${PGO_BINARY_DIR}/build)
+set(profile_dir ${PGO_BINARY_DIR}/profile)
+set(corpus_dir ${PGO_BINARY_DIR}/corpus)
+set(output_dir ${PGO_BINARY_DIR}/output)
+string(REPLACE "|" ";" train_args "${PGO_TRAIN_ARGS}")
+string(REPLACE "|" ";" emulator "${PGO_EMULATOR}")
+
+set(configure_args
+        -G ${PGO_GENERATOR}
+        -DCMAKE_BUILD_TYPE=Release
+        -DBLOPHY_PGO_DIR=${profile_dir}
+        -DBLOPHY_ENABLE_LTO=${PGO_ENABLE_LTO}
+)
+if (PGO_ARM_BUILD)
+    list(APPEND configure_args -DARM_BUILD=${PGO_ARM_BUILD})
+elseif (PGO_C_COMPILER)
+    list(APPEND configure_args -DCMAKE_C_COMPILER=${PGO_C_COMPILER})
+endif ()
+
+function(pgo_run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "命令执行失败 (${result}): ${ARGN}")
+    endif ()
+endfunction()
+
+function(pgo_build stage)
+    message(STATUS "==> PGO ${stage}: 编译 ${PGO_TARGET}")
+    file(MAKE_DIRECTORY ${build_dir})
+    pgo_run(${CMAKE_COMMAND} ${configure_args} -DBLOPHY_PGO=${stage} ${PGO_SOURCE_DIR}
+            WORKING_DIRECTORY ${build_dir})
+    pgo_run(${CMAKE_COMMAND} --build ${build_dir} --target ${PGO_TARGET} --config Release)
+endfunction()
+
+# 第一步：插桩编译，清除上一次的配置文件
+file(REMOVE_RECURSE ${profile_dir} ${output_dir})
+file(MAKE_DIRECTORY ${profile_dir} ${output_dir})
+pgo_build(GENERATE)
+
+# 训练
+blophy_generate_corpus(${corpus_dir})
+set(program ${build_dir}/${PGO_TARGET})
+if (NOT EXISTS ${program} AND EXISTS ${program}.exe)
+    set(program ${program}.exe)
+endif ()
+if (PGO_EACH)
+    file(GLOB_RECURSE inputs ${corpus_dir}/${PGO_EACH})
+else ()
+    set(inputs ${corpus_dir})
+endif ()
+list(LENGTH inputs input_count)
+message(STATUS "==> PGO 训练: ${input_count} 个输入")
+set(index 0)
+foreach (input ${inputs})
+    set(output ${output_dir}/${index})
+    file(MAKE_DIRECTORY ${output})
+    set(args "")
+    foreach (arg ${train_args})
+        string(REPLACE "@CORPUS@" ${corpus_dir} arg ${arg})
+        string(REPLACE "@OUTPUT@" ${output} arg ${arg})
+        string(REPLACE "@INPUT@" ${input} arg ${arg})
+        list(APPEND args ${arg})
+    endforeach ()
+    # 训练结果只用于收集配置文件，忽略输出；个别输入转换失败不影响配置文件
+    execute_process(COMMAND ${emulator} ${program} ${args} RESULT_VARIABLE result OUTPUT_QUIET)
+    if (NOT result EQUAL 0)
+        message(WARNING "训练命令返回 ${result}: ${program} ${args}")
+    endif ()
+    math(EXPR index "${index} + 1")
+endforeach ()
+
+# Clang 需要把 .profraw 合并为 .profdata
+if (PGO_COMPILER_ID MATCHES "Clang")
+    if (NOT PGO_LLVM_PROFDATA)
+        message(FATAL_ERROR "未找到 llvm-profdata")
+    endif ()
+    file(GLOB raw_profiles ${profile_dir}/*.profraw)
+    pgo_run(${PGO_LLVM_PROFDATA} merge -output=${profile_dir}/default.profdata ${raw_profiles})
+endif ()
+
+# 第二步：使用配置文件重新编译
+pgo_build(USE)
+message(STATUS "==> PGO 完成: ${program}")
@@ -0,0 +1,157 @@
+# 生成 PGO 训练用的合成谱面语料，内容由固定种子的伪随机数决定，每次生成结果相同。
+# 规模按常见谱面设置：BPM 点从 1 个到几十个，note 从几百到几千，
+# 并包含解码器会跳过的元数据、特效和 note 字段，使训练覆盖真实谱面的解析路径。
+#   malody/   .mc 谱面，以及打包成 .mcz 的歌曲
+#   cylheim/  Cylheim 谱面 (.json)
+#   lanota/   Lanotalium 谱面 (.txt)
+
+set(BLOPHY_CORPUS_SEED 20240601)
+
+# 线性同余伪随机数，结果为 [0, range)；在函数中使用后需把种子传回上层
+macro(corpus_random out range)
+    math(EXPR BLOPHY_CORPUS_SEED "(${BLOPHY_CORPUS_SEED} * 1103515245 + 12345) % 2147483648")
+    math(EXPR ${out} "(${BLOPHY_CORPUS_SEED} / 65536) % (${range})")
+endmacro()
+
+function(corpus_malody path tempo_count note_count)
+    set(text "{\"meta\":{\"creator\":\"pgo\",\"background\":\"bg.jpg\",\"version\":\"4K Lv.20\",\"id\":1,")
+    string(APPEND text "\"mode\":0,\"time\":1700000000,\"song\":{\"title\":\"corpus\",\"artist\":\"blophy\",\"id\":1},")
+    string(APPEND text "\"mode_ext\":{\"column\":4,\"bar_begin\":0}},\"time\":[")
+    set(beat 0)
+    foreach (i RANGE 1 ${tempo_count})
+        corpus_random(bpm 180)
+        math(EXPR bpm "${bpm} + 80")
+        corpus_random(molecule 4)
+        if (i GREATER 1)
+            string(APPEND text ",")
+        endif ()
+        string(APPEND text "{\"beat\":[${beat},${molecule},4],\"bpm\":${bpm}.5}")
+        corpus_random(step 32)
+        math(EXPR beat "${beat} + ${step} + 1")
+    endforeach ()
+    string(APPEND text "],\"effect\":[{\"beat\":[8,0,1],\"scroll\":1.5}],\"note\":[")
+    set(beat 0)
+    foreach (i RANGE 1 ${note_count})
+        corpus_random(column 4)
+        corpus_random(molecule 16)
+        corpus_random(step 3)
+        math(EXPR beat "${beat} + ${step}")
+        string(APPEND text "{\"beat\":[${beat},${molecule},16],\"column\":${column}")
+        corpus_random(hold 8)
+        if (hold EQUAL 0)
+            math(EXPR end "${beat} + 2")
+            string(APPEND text ",\"endbeat\":[${end},0,1]")
+        endif ()
+        string(APPEND text "},")
+    endforeach ()
+    corpus_random(offset 500)
+    string(APPEND text "{\"beat\":[0,0,1],\"sound\":\"song.ogg\",\"vol\":100,\"offset\":${offset},\"type\":1}],")
+    string(APPEND text "\"extra\":{\"test\":{\"divide\":4,\"speed\":100,\"save\":0,\"lock\":0,\"edit_mode\":0}}}")
+    file(WRITE ${path} "${text}")
+    set(BLOPHY_CORPUS_SEED ${BLOPHY_CORPUS_SEED} PARENT_SCOPE)
+endfunction()
+
+function(corpus_cylheim path tempo_count note_count)
+    set(text "{\"format_version\":0,\"time_base\":480,\"start_offset_time\":0.0,\"page_list\":[")
+    foreach (i RANGE 0 31)
+        math(EXPR start "${i} * 960")
+        math(EXPR end "${start} + 960")
+        if (i GREATER 0)
+            string(APPEND text ",")
+        endif ()
+        string(APPEND text "{\"start_tick\":${start},\"end_tick\":${end},\"scan_line_direction\":1}")
+    endforeach ()
+    string(APPEND text "],\"tempo_list\":[")
+    set(tick 0)
+    foreach (i RANGE 1 ${tempo_count})
+        corpus_random(value 400000)
+        math(EXPR value "${value} + 250000")
+        if (i GREATER 1)
+            string(APPEND text ",")
+        endif ()
+        string(APPEND text "{\"tick\":${tick},\"value\":${value}}")
+        corpus_random(step 4800)
+        math(EXPR tick "${tick} + ${step} + 240")
+    endforeach ()
+    string(APPEND text "],\"event_order_list\":[],\"note_list\":[")
+    set(tick 0)
+    foreach (i RANGE 1 ${note_count})
+        corpus_random(x 1000)
+        corpus_random(step 240)
+        math(EXPR tick "${tick} + ${step}")
+        math(EXPR page "${tick} / 960")
+        if (i GREATER 1)
+            string(APPEND text ",")
+        endif ()
+        string(APPEND text "{\"page_index\":${page},\"type\":0,\"id\":${i},\"tick\":${tick},\"x\":0.${x},")
+        string(APPEND text "\"has_sibling\":false,\"hold_tick\":0,\"next_id\":0,\"is_forward\":false}")
+    endforeach ()
+    string(APPEND text "]}")
+    file(WRITE ${path} "${text}")
+    set(BLOPHY_CORPUS_SEED ${BLOPHY_CORPUS_SEED} PARENT_SCOPE)
+endfunction()
+
+function(corpus_lanota path tempo_count note_count)
+    set(text "{\"info\":{\"designer\":\"pgo\"},\"tap\":[")
+    set(timing 0)
+    foreach (i RANGE 1 ${note_count})
+        corpus_random(degree 360)
+        corpus_random(step 500)
+        math(EXPR timing "${timing} + ${step}")
+        if (i GREATER 1)
+            string(APPEND text ",")
+        endif ()
+        string(APPEND text "{\"Type\":0,\"Timing\":${timing}.0,\"Degree\":${degree}.0,\"Size\":1,\"Combination\":0}")
+    endforeach ()
+    string(APPEND text "],\"bpm\":[{\"Timing\":-1,\"Bpm\":120}")
+    set(timing 0)
+    foreach (i RANGE 1 ${tempo_count})
+        corpus_random(bpm 200)
+        math(EXPR bpm "${bpm} + 60")
+        corpus_random(step 20000)
+        math(EXPR timing "${timing} + ${step}")
+        string(APPEND text ",{\"Timing\":${timing}.25,\"Bpm\":${bpm}}")
+    endforeach ()
+    string(APPEND text "],\"scroll\":[],\"eos\":1.5}")
+    file(WRITE ${path} "${text}")
+    set(BLOPHY_CORPUS_SEED ${BLOPHY_CORPUS_SEED} PARENT_SCOPE)
+endfunction()
+
+function(blophy_generate_corpus dir)
+    if (EXISTS ${dir}/done)
+        return()
+    endif ()
+    message(STATUS "==> 生成 PGO 语料: ${dir}")
+    file(REMOVE_RECURSE ${dir})
+    file(MAKE_DIRECTORY ${dir}/malody ${dir}/cylheim ${dir}/lanota)
+
+    # 各种规模的 Malody 谱面，其中一部分按歌曲打包成 .mcz
+    foreach (i RANGE 0 23)
+        corpus_random(tempo_count 40)
+        corpus_random(note_count 2700)
+        math(EXPR tempo_count "${tempo_count} + 1")
+        math(EXPR note_count "${note_count} + 300")
+        math(EXPR song "${i} / 3")
+        if (song LESS 4)
+            file(MAKE_DIRECTORY ${dir}/mcz/${song}/0)
+            corpus_malody(${dir}/mcz/${song}/0/${i}.mc ${tempo_count} ${note_count})
+        else ()
+            corpus_malody(${dir}/malody/${i}.mc ${tempo_count} ${note_count})
+        endif ()
+    endforeach ()
+    foreach (song RANGE 0 3)
+        execute_process(COMMAND ${CMAKE_COMMAND} -E tar cf ${dir}/malody/song${song}.mcz --format=zip 0
+                WORKING_DIRECTORY ${dir}/mcz/${song})
+    endforeach ()
+    file(REMOVE_RECURSE ${dir}/mcz)
+
+    foreach (i RANGE 0 7)
+        corpus_random(tempo_count 24)
+        corpus_random(note_count 1500)
+        math(EXPR tempo_count "${tempo_count} + 1")
+        math(EXPR note_count "${note_count} + 200")
+        corpus_cylheim(${dir}/cylheim/${i}.json ${tempo_count} ${note_count})
+        corpus_lanota(${dir}/lanota/${i}.txt ${tempo_count} ${note_count})
+    endforeach ()
+    file(WRITE ${dir}/done "")
+endfunction()
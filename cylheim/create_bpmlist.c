@@ -3,48 +3,41 @@
 #include "process_tempo.h"
 
 // 生成 bpmList
-cJSON *create_bpm_list(const cJSON *entry) {
-    cJSON *bpm_list = cJSON_CreateArray();
-    const cJSON *tempo_entry = cJSON_GetObjectItem(entry, "tempo_list");
-    const int count = cJSON_GetArraySize(tempo_entry);
-
-    for (int i = 0; i < count; i++) {
-        if (!cJSON_IsArray(tempo_entry)) {
-            fprintf(stderr, RED "==> Bpm 数组中的元素格式不正确\n" RESET);
-            continue;
-        }
+int cylheim_create_bpm_list(const cylheim_chart *chart, chart_ir *ir) {
+    if (!chart->has_tempo_list) {
+        LOG_ERROR(RED "==> tempo_list 字段不是数组\n" RESET);
+        return 0;
+    }
+    if (!chart->has_time_base || chart->time_base == 0) {
+        LOG_ERROR(RED "==> 未找到有效的 time_base 值\n" RESET);
+        return 0;
+    }
 
-        const cJSON *tempo = cJSON_GetArrayItem(tempo_entry, i);
-        const cJSON *tempo_value = cJSON_GetObjectItem(tempo, "value");
-        const int tempo_value_int = tempo_value->valueint;
+    for (int i = 0; i < chart->tempo_count; i++) {
+        const cylheim_tempo *tempo = &chart->tempos[i];
 
         double timing, bpm;
 
-        const cJSON *time_base_item = cJSON_GetObjectItem(entry, "time_base");
-        const int time_base = time_base_item->valueint;
-        const cJSON *tick_item = cJSON_GetObjectItem(tempo, "tick");
-        const int tick = tick_item->valueint;
-
-        calculate_real_time_and_bpm(time_base, tempo_value_int, tick, &timing, &bpm);
+        calculate_real_time_and_bpm(chart->time_base, tempo->value, tempo->tick, &timing, &bpm);
 
         int a, b, c;
-
-        printf("%lf %lf \n",timing, bpm);
-
         double_to_fraction(timing, &a, &b, &c);
 
-
-        cJSON *bpm_entry = cJSON_CreateObject();
-        cJSON_AddNumberToObject(bpm_entry, "integer", a);
-        cJSON_AddNumberToObject(bpm_entry, "molecule", b);
-        cJSON_AddNumberToObject(bpm_entry, "denominator", c);
-        cJSON_AddNumberToObject(bpm_entry, "currentBPM", bpm);
-        cJSON_AddNumberToObject(bpm_entry, "ThisStartBPM", bpm);
-
-        cJSON_AddItemToArray(bpm_list, bpm_entry);
+        const chart_beat beat = {a, b, c, bpm, bpm};
+        if (!chart_ir_add_tempo(ir, &beat)) {
+            return 0;
+        }
     }
 
-    printf(GREEN "==> BPM List解析完成.\n");
+    LOG_INFO(GREEN "==> BPM List解析完成.\n");
+
+    return 1;
+}
 
-    return bpm_list;
+// 由解码后的 Cylheim 谱面生成中间表示，Cylheim 谱面没有 offset；失败时 ir 仍需 chart_ir_free
+int cylheim_build_chart_ir(const cylheim_chart *chart, chart_ir *ir) {
+    const double offset = 0;
+    const int built = chart_ir_init(ir, offset, -1.0, chart->tempo_count) && cylheim_create_bpm_list(chart, ir);
+    LOG_INFO(GREEN "==> Offset: %f(SKIPPED)\n" RESET, offset);
+    return built;
 }
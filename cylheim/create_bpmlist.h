@@ -1,6 +1,10 @@
 #pragma once
 #include "../includes/cross_platform.h"
 #include <stdbool.h>
+#include "cylheim_decode.h"
+#include "../includes/chart_ir.h"
 
 // 生成 bpmList
-cJSON *create_bpm_list(const cJSON *entry);
\ No newline at end of file
+int cylheim_create_bpm_list(const cylheim_chart *chart, chart_ir *ir);
+// 由解码后的谱面生成中间表示；失败时 ir 仍需 chart_ir_free
+int cylheim_build_chart_ir(const cylheim_chart *chart, chart_ir *ir);
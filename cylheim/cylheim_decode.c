@@ -0,0 +1,92 @@
+#include "cylheim_decode.h"
+#include "../includes/trace.h"
+
+enum {
+    CYLHEIM_KEY_UNKNOWN = 0,
+    CYLHEIM_KEY_TIME_BASE,
+    CYLHEIM_KEY_TEMPO_LIST,
+    CYLHEIM_KEY_TICK,
+    CYLHEIM_KEY_VALUE,
+};
+
+#define CYLHEIM_KEY_MASK 7u
+
+static const schema_key cylheim_keys[CYLHEIM_KEY_MASK + 1] = {
+    SCHEMA_KEY(CYLHEIM_KEY_MASK, "time_base", 't', 'e', CYLHEIM_KEY_TIME_BASE),
+    SCHEMA_KEY(CYLHEIM_KEY_MASK, "tempo_list", 't', 't', CYLHEIM_KEY_TEMPO_LIST),
+    SCHEMA_KEY(CYLHEIM_KEY_MASK, "tick", 't', 'k', CYLHEIM_KEY_TICK),
+    SCHEMA_KEY(CYLHEIM_KEY_MASK, "value", 'v', 'e', CYLHEIM_KEY_VALUE),
+};
+
+static int decode_tempo_field(json_reader *r, void *ctx, const int key, const json_token_type token) {
+    cylheim_tempo *tempo = ctx;
+    double value = 0;
+    const int result = schema_read_number(r, token, &value);
+    if (result == 1) {
+        if (key == CYLHEIM_KEY_TICK) {
+            tempo->tick = (int) value;
+        } else if (key == CYLHEIM_KEY_VALUE) {
+            tempo->value = (int) value;
+        }
+    }
+    return result;
+}
+
+static int decode_tempo(json_reader *r, void *ctx, const json_token_type token) {
+    cylheim_chart *chart = ctx;
+    if (token != JSON_TOKEN_OBJECT_START) {
+        LOG_ERROR(RED "==> Bpm 数组中的元素格式不正确\n" RESET);
+        return json_reader_skip(r, token) ? 0 : -1;
+    }
+    if (!schema_array_reserve((void **) &chart->tempos, &chart->tempo_capacity, chart->tempo_count,
+                              sizeof(cylheim_tempo))) {
+        return -1;
+    }
+    cylheim_tempo *tempo = &chart->tempos[chart->tempo_count++];
+    tempo->tick = 0;
+    tempo->value = 0;
+    return schema_read_object(r, token, cylheim_keys, CYLHEIM_KEY_MASK, tempo, decode_tempo_field);
+}
+
+static int decode_chart_field(json_reader *r, void *ctx, const int key, const json_token_type token) {
+    cylheim_chart *chart = ctx;
+    if (key == CYLHEIM_KEY_TIME_BASE) {
+        double time_base = 0;
+        const int result = schema_read_number(r, token, &time_base);
+        if (result == 1) {
+            chart->time_base = (int) time_base;
+            chart->has_time_base = 1;
+        }
+        return result;
+    }
+    if (key == CYLHEIM_KEY_TEMPO_LIST) {
+        chart->has_tempo_list = token == JSON_TOKEN_ARRAY_START;
+        return schema_read_array(r, token, chart, decode_tempo);
+    }
+    return json_reader_skip(r, token) ? 0 : -1;
+}
+
+int cylheim_decode(json_reader *r, cylheim_chart *chart) {
+    memset(chart, 0, sizeof(*chart));
+    return schema_decode_document(r, cylheim_keys, CYLHEIM_KEY_MASK, chart, decode_chart_field);
+}
+
+int cylheim_decode_string(const char *json, const size_t len, cylheim_chart *chart) {
+    TRACE_PROBE2(parse_start, "cylheim", len);
+    const double trace_start_time = trace_begin();
+    json_reader r;
+    json_reader_init_mem(&r, json, len);
+    const int ok = cylheim_decode(&r, chart);
+    TRACE_PROBE2(parse_done, "cylheim", ok);
+    trace_end("decode", trace_start_time, NULL);
+    if (!ok && r.error) {
+        DEBUG_PRINT("JSON 解析失败: %s\n", r.error);
+    }
+    json_reader_free(&r);
+    return ok;
+}
+
+void cylheim_chart_free(cylheim_chart *chart) {
+    free(chart->tempos);
+    memset(chart, 0, sizeof(*chart));
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "../includes/schema_decode.h"
+
+// Cylheim 谱面中转换所需的字段，由 schema 解码器直接填充
+
+typedef struct {
+    int tick;
+    int value; // 每拍的微秒数
+} cylheim_tempo;
+
+typedef struct {
+    int time_base; // 每拍的 tick 数
+    int has_time_base;
+
+    cylheim_tempo *tempos;
+    int tempo_count;
+    int tempo_capacity;
+    int has_tempo_list; // tempo_list 字段存在且为数组
+} cylheim_chart;
+
+// 解码 Cylheim 谱面，成功返回 1；失败时 chart 中已解码的内容仍需 cylheim_chart_free
+int cylheim_decode(json_reader *r, cylheim_chart *chart);
+int cylheim_decode_string(const char *json, size_t len, cylheim_chart *chart);
+void cylheim_chart_free(cylheim_chart *chart);
@@ -1,7 +1,3 @@
 #pragma once
 
 void calculate_real_time_and_bpm(int timeBase, double tempo, int tick, double *timing, double *bpm);
-
-int gcd(int a, int b);
-
-void double_to_fraction(double value, int *main, int *molecule, int *denominator);
\ No newline at end of file
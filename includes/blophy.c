@@ -0,0 +1,297 @@
+#include "blophy.h"
+#include "chart_format.h"
+#include "file_utils.h"
+#include "../malody/create_bpmlist.h"
+#include "../malody/tools.h"
+#include "../cylheim/create_bpmlist.h"
+#include "../lanotalium/create_bpmlist.h"
+
+#include <stddef.h>
+
+THREAD_LOCAL int log_quiet = 0;
+
+uint32_t blophy_abi_version(void) {
+    return BLOPHY_ABI_VERSION;
+}
+
+void blophy_options_init(blophy_options *options) {
+    if (!options) return;
+    memset(options, 0, sizeof(blophy_options));
+    options->struct_size = sizeof(blophy_options);
+    options->formatted = 1;
+    options->chart_index = 0;
+    options->music_length = -1.0;
+}
+
+const char *blophy_status_message(const blophy_status status) {
+    switch (status) {
+        case BLOPHY_OK:
+            return "ok";
+        case BLOPHY_ERR_INVALID_ARGUMENT:
+            return "invalid argument";
+        case BLOPHY_ERR_UNKNOWN_FORMAT:
+            return "unknown input format";
+        case BLOPHY_ERR_PARSE:
+            return "malformed chart JSON";
+        case BLOPHY_ERR_MISSING_FIELD:
+            return "required chart field missing";
+        case BLOPHY_ERR_ARCHIVE:
+            return "cannot open .mcz archive";
+        case BLOPHY_ERR_NO_CHART:
+            return "no chart with the requested index in archive";
+        case BLOPHY_ERR_NO_MEMORY:
+            return "out of memory";
+        case BLOPHY_ERR_BUFFER_TOO_SMALL:
+            return "output buffer too small";
+        default:
+            return "unknown error";
+    }
+}
+
+static chart_format to_chart_format(const blophy_format format) {
+    switch (format) {
+        case BLOPHY_FORMAT_MCZ:
+            return CHART_FORMAT_MCZ;
+        case BLOPHY_FORMAT_MALODY:
+            return CHART_FORMAT_MALODY;
+        case BLOPHY_FORMAT_CYLHEIM:
+            return CHART_FORMAT_CYLHEIM;
+        case BLOPHY_FORMAT_LANOTA:
+            return CHART_FORMAT_LANOTA;
+        default:
+            return CHART_FORMAT_UNKNOWN;
+    }
+}
+
+static blophy_format from_chart_format(const chart_format format) {
+    switch (format) {
+        case CHART_FORMAT_MCZ:
+            return BLOPHY_FORMAT_MCZ;
+        case CHART_FORMAT_MALODY:
+            return BLOPHY_FORMAT_MALODY;
+        case CHART_FORMAT_CYLHEIM:
+            return BLOPHY_FORMAT_CYLHEIM;
+        case CHART_FORMAT_LANOTA:
+            return BLOPHY_FORMAT_LANOTA;
+        default:
+            return BLOPHY_FORMAT_AUTO;
+    }
+}
+
+blophy_format blophy_detect_format(const void *input, const size_t input_size) {
+    if (!input) return BLOPHY_FORMAT_AUTO;
+    const int quiet = log_quiet;
+    log_quiet = 1;
+    const chart_format format = chart_format_detect(input, input_size);
+    log_quiet = quiet;
+    return from_chart_format(format);
+}
+
+// 旧版本调用方的结构体较短，缺少的字段使用默认值
+static int read_options(const blophy_options *options, blophy_options *resolved) {
+    blophy_options_init(resolved);
+    if (!options) return 1;
+    if (options->struct_size < offsetof(blophy_options, formatted)) return 0;
+    const size_t size = options->struct_size < sizeof(blophy_options) ? options->struct_size : sizeof(blophy_options);
+    memcpy(resolved, options, size);
+    resolved->struct_size = sizeof(blophy_options);
+    return 1;
+}
+
+// 由解码结果生成谱面并释放 chart；zip 为 NULL 时不探测音频时长
+static blophy_status build_malody(mc_chart *chart, const int decoded, mz_zip_archive *zip, const char *entry_name,
+                                  double music_length, chart_ir *ir) {
+    blophy_status status = BLOPHY_OK;
+    if (!decoded) {
+        status = BLOPHY_ERR_PARSE;
+    } else if (!chart->has_time) {
+        status = BLOPHY_ERR_MISSING_FIELD;
+    } else {
+        if (music_length < 0 && zip) {
+            // 音频与谱面位于压缩包中的同一目录
+            char chart_dir[512];
+            snprintf(chart_dir, sizeof(chart_dir), "%s", entry_name);
+            char *last_slash = strrchr(chart_dir, '/');
+            if (last_slash) {
+                *last_slash = '\0';
+            } else {
+                chart_dir[0] = '\0';
+            }
+            const int audio_index = locate_chart_audio(zip, chart_dir, extract_sound_file(chart));
+            if (audio_index >= 0) {
+                music_length = probe_zip_audio_length(zip, audio_index);
+            }
+        }
+        if (!mc_build_chart_ir(chart, music_length, ir)) {
+            status = BLOPHY_ERR_NO_MEMORY;
+        }
+    }
+    mc_chart_free(chart);
+    return status;
+}
+
+static blophy_status build_cylheim(const char *data, const size_t len, chart_ir *ir) {
+    cylheim_chart chart;
+    blophy_status status = BLOPHY_OK;
+    if (!cylheim_decode_string(data, len, &chart)) {
+        status = BLOPHY_ERR_PARSE;
+    } else if (!chart.has_tempo_list || !chart.has_time_base || chart.time_base == 0) {
+        status = BLOPHY_ERR_MISSING_FIELD;
+    } else if (!cylheim_build_chart_ir(&chart, ir)) {
+        status = BLOPHY_ERR_NO_MEMORY;
+    }
+    cylheim_chart_free(&chart);
+    return status;
+}
+
+static blophy_status build_lanota(const char *data, const size_t len, chart_ir *ir) {
+    lanota_chart chart;
+    blophy_status status = BLOPHY_OK;
+    if (!lanota_decode_string(data, len, &chart)) {
+        status = BLOPHY_ERR_PARSE;
+    } else if (!chart.has_bpm) {
+        status = BLOPHY_ERR_MISSING_FIELD;
+    } else if (!lanota_build_chart_ir(&chart, ir)) {
+        status = BLOPHY_ERR_NO_MEMORY;
+    }
+    lanota_chart_free(&chart);
+    return status;
+}
+
+// 查找压缩包中第 index 个 .mc 条目；index 为负数时只计数
+static int find_archive_chart(mz_zip_archive *zip, const int index, mz_zip_archive_file_stat *file_stat) {
+    int found = 0;
+    const unsigned int num_files = mz_zip_reader_get_num_files(zip);
+    for (unsigned int i = 0; i < num_files; i++) {
+        if (!mz_zip_reader_file_stat(zip, i, file_stat) || file_stat->m_is_directory ||
+            !has_extension(file_stat->m_filename, ".mc")) {
+            continue;
+        }
+        if (found++ == index) return 1;
+    }
+    return index < 0 ? found : 0;
+}
+
+static blophy_status build_archive(const char *data, const size_t len, const blophy_options *options, chart_ir *ir) {
+    mz_zip_archive zip = {0};
+    if (!mz_zip_reader_init_mem(&zip, data, len, 0)) {
+        return BLOPHY_ERR_ARCHIVE;
+    }
+
+    blophy_status status;
+    mz_zip_archive_file_stat file_stat;
+    if (options->chart_index < 0 || !find_archive_chart(&zip, options->chart_index, &file_stat)) {
+        status = BLOPHY_ERR_NO_CHART;
+    } else {
+        // 谱面条目分块解压后直接解析，不在内存中保留解压后的完整文本
+        mc_chart chart;
+        const int decoded = mc_preview_zip_entry(&zip, file_stat.m_file_index, options->preview_seconds, &chart);
+        mz_zip_archive *audio_zip = options->preview_seconds > 0 ? NULL : &zip;
+        status = build_malody(&chart, decoded, audio_zip, file_stat.m_filename, options->music_length, ir);
+    }
+    mz_zip_reader_end(&zip);
+    return status;
+}
+
+static blophy_status convert_chart(const void *input, const size_t input_size, const blophy_format format,
+                                   const blophy_options *options, char **output, size_t *output_size) {
+    blophy_options resolved;
+    if (!input || !read_options(options, &resolved)) {
+        return BLOPHY_ERR_INVALID_ARGUMENT;
+    }
+    const char *data = input;
+    const chart_format resolved_format =
+            format == BLOPHY_FORMAT_AUTO ? chart_format_detect(data, input_size) : to_chart_format(format);
+
+    chart_ir ir;
+    memset(&ir, 0, sizeof(chart_ir));
+    blophy_status status;
+    switch (resolved_format) {
+        case CHART_FORMAT_MCZ:
+            status = build_archive(data, input_size, &resolved, &ir);
+            break;
+        case CHART_FORMAT_MALODY: {
+            mc_chart chart;
+            const int decoded = mc_preview_string(data, input_size, resolved.preview_seconds, &chart);
+            status = build_malody(&chart, decoded, NULL, "", resolved.music_length, &ir);
+            break;
+        }
+        case CHART_FORMAT_CYLHEIM:
+            status = build_cylheim(data, input_size, &ir);
+            break;
+        case CHART_FORMAT_LANOTA:
+            status = build_lanota(data, input_size, &ir);
+            break;
+        default:
+            status = BLOPHY_ERR_UNKNOWN_FORMAT;
+            break;
+    }
+    if (status == BLOPHY_OK && resolved_format != CHART_FORMAT_MALODY && resolved_format != CHART_FORMAT_MCZ) {
+        ir.music_length = resolved.music_length < 0 ? -1.0 : resolved.music_length;
+    }
+    if (status == BLOPHY_OK && resolved.preview_seconds > 0) {
+        chart_ir_truncate(&ir, resolved.preview_seconds);
+    }
+
+    if (status == BLOPHY_OK) {
+        *output = chart_ir_serialize(&ir, resolved.formatted != 0, output_size);
+        if (!*output) status = BLOPHY_ERR_NO_MEMORY;
+    }
+    chart_ir_free(&ir);
+    return status;
+}
+
+blophy_status blophy_archive_chart_count(const void *input, const size_t input_size, int32_t *count) {
+    if (!input || !count) {
+        return BLOPHY_ERR_INVALID_ARGUMENT;
+    }
+    mz_zip_archive zip = {0};
+    if (!mz_zip_reader_init_mem(&zip, input, input_size, 0)) {
+        return BLOPHY_ERR_ARCHIVE;
+    }
+    mz_zip_archive_file_stat file_stat;
+    *count = find_archive_chart(&zip, -1, &file_stat);
+    mz_zip_reader_end(&zip);
+    return BLOPHY_OK;
+}
+
+blophy_status blophy_convert(const void *input, const size_t input_size, const blophy_format format,
+                             const blophy_options *options, char **output, size_t *output_size) {
+    if (!output) {
+        return BLOPHY_ERR_INVALID_ARGUMENT;
+    }
+    *output = NULL;
+    size_t length = 0;
+    const int quiet = log_quiet;
+    log_quiet = 1;
+    const blophy_status status = convert_chart(input, input_size, format, options, output, &length);
+    log_quiet = quiet;
+    if (output_size) *output_size = length;
+    return status;
+}
+
+blophy_status blophy_convert_into(const void *input, const size_t input_size, const blophy_format format,
+                                  const blophy_options *options, char *buffer, const size_t buffer_size,
+                                  size_t *required_size) {
+    if (!buffer && buffer_size > 0) {
+        return BLOPHY_ERR_INVALID_ARGUMENT;
+    }
+    char *output;
+    size_t length;
+    const blophy_status status = blophy_convert(input, input_size, format, options, &output, &length);
+    if (status != BLOPHY_OK) {
+        return status;
+    }
+    if (required_size) *required_size = length + 1;
+    if (length + 1 > buffer_size) {
+        free(output);
+        return BLOPHY_ERR_BUFFER_TOO_SMALL;
+    }
+    memcpy(buffer, output, length + 1);
+    free(output);
+    return BLOPHY_OK;
+}
+
+void blophy_free(void *ptr) {
+    free(ptr);
+}
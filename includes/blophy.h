@@ -0,0 +1,76 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// 可嵌入的转换库接口：输入谱面或 .mcz 的字节，输出 Chart.json 文本，不读写文件、不打印日志，
+// 错误通过 blophy_status 返回。所有函数可在多个线程中同时调用。
+// 接口只使用定长整数和不透明的指针，结构体以 struct_size 开头，新增字段只追加在末尾
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32) && defined(BLOPHY_SHARED)
+#ifdef BLOPHY_BUILD
+#define BLOPHY_API __declspec(dllexport)
+#else
+#define BLOPHY_API __declspec(dllimport)
+#endif
+#elif defined(BLOPHY_SHARED) && defined(BLOPHY_BUILD)
+#define BLOPHY_API __attribute__((visibility("default")))
+#else
+#define BLOPHY_API
+#endif
+
+// 接口版本，不兼容的修改时递增
+#define BLOPHY_ABI_VERSION 1
+
+typedef enum {
+    BLOPHY_OK = 0,
+    BLOPHY_ERR_INVALID_ARGUMENT = 1,
+    BLOPHY_ERR_UNKNOWN_FORMAT = 2, // 无法识别输入格式
+    BLOPHY_ERR_PARSE = 3, // JSON 语法错误
+    BLOPHY_ERR_MISSING_FIELD = 4, // 缺少 time、tempo_list、bpm 等必需字段
+    BLOPHY_ERR_ARCHIVE = 5, // 无法打开 .mcz
+    BLOPHY_ERR_NO_CHART = 6, // .mcz 中没有指定序号的谱面
+    BLOPHY_ERR_NO_MEMORY = 7,
+    BLOPHY_ERR_BUFFER_TOO_SMALL = 8, // 调用方提供的缓冲区不足，所需大小已写入 required_size
+} blophy_status;
+
+typedef enum {
+    BLOPHY_FORMAT_AUTO = 0, // 按内容识别
+    BLOPHY_FORMAT_MCZ = 1,
+    BLOPHY_FORMAT_MALODY = 2,
+    BLOPHY_FORMAT_CYLHEIM = 3,
+    BLOPHY_FORMAT_LANOTA = 4,
+} blophy_format;
+
+typedef struct {
+    uint32_t struct_size; // sizeof(blophy_options)，由 blophy_options_init 填写
+    int32_t formatted; // 非 0 时输出带缩进的 JSON，默认 1
+    int32_t chart_index; // .mcz 中第几个 .mc 谱面（按压缩包中的顺序，从 0 开始），默认 0
+    double music_length; // 音频时长（秒），小于 0 时 .mcz 从压缩包中的音频探测，其他格式输出 -1（未知）
+    double preview_seconds; // 大于 0 时只输出开头这么多秒的 note 和事件，musicLength 不超过该值，.mcz 不探测音频；默认 0
+} blophy_options;
+
+BLOPHY_API uint32_t blophy_abi_version(void);
+BLOPHY_API void blophy_options_init(blophy_options *options);
+// 错误码的说明文字（静态字符串）
+BLOPHY_API const char *blophy_status_message(blophy_status status);
+// 识别输入格式，无法识别时返回 BLOPHY_FORMAT_AUTO
+BLOPHY_API blophy_format blophy_detect_format(const void *input, size_t input_size);
+// .mcz 中 .mc 谱面的数量
+BLOPHY_API blophy_status blophy_archive_chart_count(const void *input, size_t input_size, int32_t *count);
+
+// 转换结果由库分配，以 '\0' 结尾，output_size 不含 '\0'；用 blophy_free 释放。options 可为 NULL
+BLOPHY_API blophy_status blophy_convert(const void *input, size_t input_size, blophy_format format,
+                                        const blophy_options *options, char **output, size_t *output_size);
+// 转换结果写入调用方的缓冲区（含结尾的 '\0'），required_size 返回所需的字节数（含 '\0'）
+BLOPHY_API blophy_status blophy_convert_into(const void *input, size_t input_size, blophy_format format,
+                                             const blophy_options *options, char *buffer, size_t buffer_size,
+                                             size_t *required_size);
+BLOPHY_API void blophy_free(void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
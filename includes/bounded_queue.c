@@ -0,0 +1,81 @@
+#include "bounded_queue.h"
+
+int bounded_queue_init(bounded_queue *q, const int capacity) {
+    memset(q, 0, sizeof(bounded_queue));
+    q->items = malloc(sizeof(void *) * (capacity > 0 ? capacity : 1));
+    if (!q->items) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        return 0;
+    }
+    q->capacity = capacity > 0 ? capacity : 1;
+    MUTEX_INIT(&q->mutex);
+    COND_INIT(&q->not_empty);
+    COND_INIT(&q->not_full);
+    return 1;
+}
+
+void bounded_queue_destroy(bounded_queue *q) {
+    MUTEX_DESTROY(&q->mutex);
+    COND_DESTROY(&q->not_empty);
+    COND_DESTROY(&q->not_full);
+    free(q->items);
+    q->items = NULL;
+}
+
+int bounded_queue_push(bounded_queue *q, void *item) {
+    MUTEX_LOCK(&q->mutex);
+    while (q->count == q->capacity && !q->closed) {
+        COND_WAIT(&q->not_full, &q->mutex);
+    }
+    if (q->closed) {
+        MUTEX_UNLOCK(&q->mutex);
+        return 0;
+    }
+    q->items[(q->head + q->count) % q->capacity] = item;
+    q->count++;
+    COND_SIGNAL(&q->not_empty);
+    MUTEX_UNLOCK(&q->mutex);
+    return 1;
+}
+
+void *bounded_queue_pop(bounded_queue *q) {
+    MUTEX_LOCK(&q->mutex);
+    while (q->count == 0 && !q->closed) {
+        COND_WAIT(&q->not_empty, &q->mutex);
+    }
+    void *item = NULL;
+    if (q->count > 0) {
+        item = q->items[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        COND_SIGNAL(&q->not_full);
+    }
+    MUTEX_UNLOCK(&q->mutex);
+    return item;
+}
+
+int bounded_queue_pop_many(bounded_queue *q, void **items, const int max) {
+    MUTEX_LOCK(&q->mutex);
+    while (q->count == 0 && !q->closed) {
+        COND_WAIT(&q->not_empty, &q->mutex);
+    }
+    int n = 0;
+    while (q->count > 0 && n < max) {
+        items[n++] = q->items[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+    }
+    if (n > 0) {
+        COND_BROADCAST(&q->not_full);
+    }
+    MUTEX_UNLOCK(&q->mutex);
+    return n;
+}
+
+void bounded_queue_close(bounded_queue *q) {
+    MUTEX_LOCK(&q->mutex);
+    q->closed = 1;
+    COND_BROADCAST(&q->not_empty);
+    COND_BROADCAST(&q->not_full);
+    MUTEX_UNLOCK(&q->mutex);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "cross_platform.h"
+
+// 有界阻塞队列：队列满时 push 阻塞，为流水线各阶段提供背压
+typedef struct {
+    void **items;
+    int capacity;
+    int head;
+    int count;
+    int closed;
+    mutex_t mutex;
+    cond_t not_empty;
+    cond_t not_full;
+} bounded_queue;
+
+int bounded_queue_init(bounded_queue *q, int capacity);
+void bounded_queue_destroy(bounded_queue *q);
+
+// 放入元素，队列已关闭时返回 0
+int bounded_queue_push(bounded_queue *q, void *item);
+// 取出元素，队列已关闭且为空时返回 NULL
+void *bounded_queue_pop(bounded_queue *q);
+// 批量取出最多 max 个元素，至少取到一个前阻塞，队列已关闭且为空时返回 0
+int bounded_queue_pop_many(bounded_queue *q, void **items, int max);
+// 关闭队列，不再接受新元素，已有元素仍可取出
+void bounded_queue_close(bounded_queue *q);
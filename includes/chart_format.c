@@ -0,0 +1,139 @@
+#include "chart_format.h"
+#include "schema_decode.h"
+#include "../malody/create_bpmlist.h"
+#include "../cylheim/create_bpmlist.h"
+#include "../lanotalium/create_bpmlist.h"
+
+enum {
+    FORMAT_KEY_UNKNOWN = 0,
+    FORMAT_KEY_META,
+    FORMAT_KEY_TIME,
+    FORMAT_KEY_TIME_BASE,
+    FORMAT_KEY_TEMPO_LIST,
+    FORMAT_KEY_BPM,
+    FORMAT_KEY_EOS,
+};
+
+#define FORMAT_KEY_MASK 63u
+
+static const schema_key format_keys[FORMAT_KEY_MASK + 1] = {
+    SCHEMA_KEY(FORMAT_KEY_MASK, "meta", 'm', 'a', FORMAT_KEY_META),
+    SCHEMA_KEY(FORMAT_KEY_MASK, "time", 't', 'e', FORMAT_KEY_TIME),
+    SCHEMA_KEY(FORMAT_KEY_MASK, "time_base", 't', 'e', FORMAT_KEY_TIME_BASE),
+    SCHEMA_KEY(FORMAT_KEY_MASK, "tempo_list", 't', 't', FORMAT_KEY_TEMPO_LIST),
+    SCHEMA_KEY(FORMAT_KEY_MASK, "bpm", 'b', 'm', FORMAT_KEY_BPM),
+    SCHEMA_KEY(FORMAT_KEY_MASK, "eos", 'e', 's', FORMAT_KEY_EOS),
+};
+
+static chart_format format_of_key(const int key) {
+    switch (key) {
+        case FORMAT_KEY_META:
+        case FORMAT_KEY_TIME:
+            return CHART_FORMAT_MALODY;
+        case FORMAT_KEY_TIME_BASE:
+        case FORMAT_KEY_TEMPO_LIST:
+            return CHART_FORMAT_CYLHEIM;
+        case FORMAT_KEY_BPM:
+        case FORMAT_KEY_EOS:
+            return CHART_FORMAT_LANOTA;
+        default:
+            return CHART_FORMAT_UNKNOWN;
+    }
+}
+
+chart_format chart_format_detect(const char *data, const size_t len) {
+    if (chart_format_is_zip(data, len)) {
+        return CHART_FORMAT_MCZ;
+    }
+
+    json_reader r;
+    json_reader_init_mem(&r, data, len);
+    chart_format format = CHART_FORMAT_UNKNOWN;
+    json_token_type token = json_reader_next(&r);
+    if (token == JSON_TOKEN_OBJECT_START) {
+        // 各格式的特征键互不重叠，遇到第一个即可确定格式
+        while (format == CHART_FORMAT_UNKNOWN && json_reader_next(&r) == JSON_TOKEN_KEY) {
+            format = format_of_key(schema_key_lookup(format_keys, FORMAT_KEY_MASK, r.str, r.str_len));
+            token = json_reader_next(&r);
+            if (format == CHART_FORMAT_UNKNOWN && !json_reader_skip(&r, token)) {
+                break;
+            }
+        }
+    }
+    json_reader_free(&r);
+    return format;
+}
+
+const char *chart_format_name(const chart_format format) {
+    switch (format) {
+        case CHART_FORMAT_MCZ:
+            return "mcz";
+        case CHART_FORMAT_MALODY:
+            return "malody";
+        case CHART_FORMAT_CYLHEIM:
+            return "cylheim";
+        case CHART_FORMAT_LANOTA:
+            return "lanota";
+        default:
+            return "unknown";
+    }
+}
+
+static int build_malody(const char *data, const size_t len, const double music_length, const double preview_seconds,
+                        chart_ir *ir) {
+    mc_chart chart;
+    int built = mc_preview_string(data, len, preview_seconds, &chart);
+    if (!built) {
+        LOG_ERROR(RED "==> 无法解析 JSON 数据\n" RESET);
+    } else if (!chart.has_time) {
+        LOG_ERROR(RED "==> time 字段不是数组\n" RESET);
+        built = 0;
+    } else {
+        built = mc_build_chart_ir(&chart, music_length, ir);
+    }
+    mc_chart_free(&chart);
+    return built;
+}
+
+static int build_cylheim(const char *data, const size_t len, chart_ir *ir) {
+    cylheim_chart chart;
+    int built = cylheim_decode_string(data, len, &chart);
+    if (!built) {
+        LOG_ERROR(RED "==> 无法解析 JSON 数据\n" RESET);
+    } else {
+        built = cylheim_build_chart_ir(&chart, ir);
+    }
+    cylheim_chart_free(&chart);
+    return built;
+}
+
+static int build_lanota(const char *data, const size_t len, chart_ir *ir) {
+    lanota_chart chart;
+    int built = lanota_decode_string(data, len, &chart);
+    if (!built) {
+        LOG_ERROR(RED "==> 无法解析 JSON 数据\n" RESET);
+    } else {
+        built = lanota_build_chart_ir(&chart, ir);
+    }
+    lanota_chart_free(&chart);
+    return built;
+}
+
+int chart_format_build(const chart_format format, const char *data, const size_t len, const double music_length,
+                       const double preview_seconds, chart_ir *ir) {
+    memset(ir, 0, sizeof(chart_ir));
+    switch (format) {
+        case CHART_FORMAT_MALODY:
+            return build_malody(data, len, music_length, preview_seconds, ir);
+        case CHART_FORMAT_CYLHEIM:
+            return build_cylheim(data, len, ir);
+        case CHART_FORMAT_LANOTA:
+            return build_lanota(data, len, ir);
+        case CHART_FORMAT_MCZ:
+            LOG_ERROR(RED "==> .mcz 谱面包需要先解压，请使用批量模式\n" RESET);
+            return 0;
+        default:
+            LOG_ERROR(RED "==> 无法识别的谱面格式\n" RESET);
+            return 0;
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "cross_platform.h"
+#include "chart_ir.h"
+
+// 输入格式识别：.mcz 按 zip 文件头判断，JSON 谱面按顶层键判断，
+// 识别后分派给对应前端的解码器，生成统一的谱面中间表示
+
+typedef enum {
+    CHART_FORMAT_UNKNOWN = 0,
+    CHART_FORMAT_MCZ, // Malody 谱面包
+    CHART_FORMAT_MALODY, // .mc，顶层含 meta / time
+    CHART_FORMAT_CYLHEIM, // 顶层含 time_base / tempo_list
+    CHART_FORMAT_LANOTA, // 顶层含 bpm / eos
+} chart_format;
+
+// .mcz 为 zip 压缩包
+static inline int chart_format_is_zip(const char *data, const size_t len) {
+    return len >= 4 && memcmp(data, "PK\x03\x04", 4) == 0;
+}
+
+// 只读取到第一个能区分格式的顶层键为止，不解码值
+chart_format chart_format_detect(const char *data, size_t len);
+const char *chart_format_name(chart_format format);
+
+// 解码单个 JSON 谱面并生成中间表示（不支持 MCZ），music_length 未知时为 -1；
+// preview_seconds 大于 0 时 Malody 谱面按 mc_preview_string 解码；失败时 ir 仍需 chart_ir_free
+int chart_format_build(chart_format format, const char *data, size_t len, double music_length, double preview_seconds,
+                       chart_ir *ir);
@@ -0,0 +1,618 @@
+#include "chart_ir.h"
+#include "json_writer.h"
+#include "chart_validate.h"
+#include "file_utils.h"
+#include "trace.h"
+
+static const char *event_names[CHART_EVENT_COUNT] = {
+    "speed", "moveX", "moveY", "rotate", "alpha", "scaleX", "scaleY", "centerX", "centerY", "lineAlpha"
+};
+static const char *event_length_names[CHART_EVENT_COUNT] = {
+    "LengthSpeed", "LengthMoveX", "LengthMoveY", "LengthRotate", "LengthAlpha",
+    "LengthScaleX", "LengthScaleY", "LengthCenterX", "LengthCenterY", "LengthLineAlpha"
+};
+
+// 所有列一起扩容，保证同一条目在各列中的下标一致
+static int grow_column(void **column, const int capacity, const size_t item_size) {
+    void *grown = realloc(*column, (size_t) capacity * item_size);
+    if (!grown) return 0;
+    *column = grown;
+    return 1;
+}
+
+static int grow_beats(chart_beat_columns *beats, const int capacity) {
+    return grow_column((void **) &beats->integer, capacity, sizeof(int))
+           && grow_column((void **) &beats->molecule, capacity, sizeof(int))
+           && grow_column((void **) &beats->denominator, capacity, sizeof(int))
+           && grow_column((void **) &beats->current_bpm, capacity, sizeof(double))
+           && grow_column((void **) &beats->start_bpm, capacity, sizeof(double));
+}
+
+static void free_beats(chart_beat_columns *beats) {
+    free(beats->integer);
+    free(beats->molecule);
+    free(beats->denominator);
+    free(beats->current_bpm);
+    free(beats->start_bpm);
+}
+
+static void set_beat(const chart_beat_columns *beats, const int index, const chart_beat *beat) {
+    beats->integer[index] = beat->integer;
+    beats->molecule[index] = beat->molecule;
+    beats->denominator[index] = beat->denominator;
+    beats->current_bpm[index] = beat->current_bpm;
+    beats->start_bpm[index] = beat->start_bpm;
+}
+
+// 计算扩容后的容量，不需要扩容时返回 0
+static int next_capacity(const int count, const int capacity, const int hint) {
+    if (count < capacity) return 0;
+    if (capacity == 0) return hint > 0 ? hint : 4;
+    return capacity * 2;
+}
+
+static int reserve_tempo(chart_tempo_track *track, const int hint) {
+    const int capacity = next_capacity(track->count, track->capacity, hint);
+    if (capacity == 0) return 1;
+    if (!grow_beats(&track->beats, capacity)) return 0;
+    track->capacity = capacity;
+    return 1;
+}
+
+static int reserve_event(chart_event_channel *channel) {
+    const int capacity = next_capacity(channel->count, channel->capacity, 0);
+    if (capacity == 0) return 1;
+    if (!grow_beats(&channel->start, capacity) || !grow_beats(&channel->end, capacity)
+        || !grow_column((void **) &channel->start_value, capacity, sizeof(double))
+        || !grow_column((void **) &channel->end_value, capacity, sizeof(double))
+        || !grow_column((void **) &channel->curve_index, capacity, sizeof(int))) {
+        return 0;
+    }
+    channel->capacity = capacity;
+    return 1;
+}
+
+static int reserve_notes(chart_note_track *track) {
+    const int capacity = next_capacity(track->count, track->capacity, 0);
+    if (capacity == 0) return 1;
+    if (!grow_beats(&track->hit, capacity)) return 0;
+    track->capacity = capacity;
+    return 1;
+}
+
+int chart_ir_init(chart_ir *ir, const double offset, const double music_length, const int tempo_hint) {
+    memset(ir, 0, sizeof(chart_ir));
+    ir->offset = offset;
+    ir->music_length = music_length;
+
+    if (tempo_hint > 0 && !reserve_tempo(&ir->tempo, tempo_hint)) {
+        LOG_ERROR(RED "==> 内存分配失败\n" RESET);
+        return 0;
+    }
+
+    // 默认的 speed 事件：第 0 拍到第 1 拍，速度 3.0
+    const chart_beat start = {0, 0, 1, 0.0, 0.0};
+    const chart_beat end = {0, 0, 1, 1.0, 1.0};
+    return chart_ir_add_event(ir, CHART_EVENT_SPEED, &start, &end, 3.0, 3.0, 0);
+}
+
+void chart_ir_free(chart_ir *ir) {
+    free_beats(&ir->tempo.beats);
+    for (int i = 0; i < CHART_EVENT_COUNT; i++) {
+        chart_event_channel *channel = &ir->events[i];
+        free_beats(&channel->start);
+        free_beats(&channel->end);
+        free(channel->start_value);
+        free(channel->end_value);
+        free(channel->curve_index);
+    }
+    for (int i = 0; i < CHART_LINE_COUNT; i++) {
+        free_beats(&ir->lines[i].online.hit);
+        free_beats(&ir->lines[i].offline.hit);
+    }
+    memset(ir, 0, sizeof(chart_ir));
+}
+
+int chart_ir_add_tempo(chart_ir *ir, const chart_beat *beat) {
+    chart_tempo_track *track = &ir->tempo;
+    if (!reserve_tempo(track, 0)) {
+        LOG_ERROR(RED "==> 内存分配失败\n" RESET);
+        return 0;
+    }
+    set_beat(&track->beats, track->count++, beat);
+    return 1;
+}
+
+int chart_ir_add_event(chart_ir *ir, const chart_event_id channel_id, const chart_beat *start, const chart_beat *end,
+                       const double start_value, const double end_value, const int curve_index) {
+    chart_event_channel *channel = &ir->events[channel_id];
+    if (!reserve_event(channel)) {
+        LOG_ERROR(RED "==> 内存分配失败\n" RESET);
+        return 0;
+    }
+    const int index = channel->count++;
+    set_beat(&channel->start, index, start);
+    set_beat(&channel->end, index, end);
+    channel->start_value[index] = start_value;
+    channel->end_value[index] = end_value;
+    channel->curve_index[index] = curve_index;
+    return 1;
+}
+
+int chart_ir_add_note(chart_ir *ir, const int line, const int online, const chart_beat *hit) {
+    if (line < 0 || line >= CHART_LINE_COUNT) {
+        LOG_ERROR(RED "==> 判定线编号超出范围: %d\n" RESET, line);
+        return 0;
+    }
+    chart_note_track *track = online ? &ir->lines[line].online : &ir->lines[line].offline;
+    if (!reserve_notes(track)) {
+        LOG_ERROR(RED "==> 内存分配失败\n" RESET);
+        return 0;
+    }
+    set_beat(&track->hit, track->count++, hit);
+    return 1;
+}
+
+static double beat_value(const chart_beat_columns *beats, const int index) {
+    const int denominator = beats->denominator[index];
+    return beats->integer[index] + (denominator != 0 ? (double) beats->molecule[index] / denominator : 0.0);
+}
+
+double chart_ir_beat_to_seconds(const chart_ir *ir, const double beat) {
+    const chart_tempo_track *tempo = &ir->tempo;
+    if (tempo->count == 0) return 0.0;
+
+    // 第一个 BPM 点之前按第一个 BPM 计算，之后逐段累加
+    double seconds = 0.0;
+    double last_beat = 0.0;
+    double bpm = tempo->beats.current_bpm[0];
+    for (int i = 0; i < tempo->count; i++) {
+        const double point = beat_value(&tempo->beats, i);
+        if (point >= beat) break;
+        if (point > last_beat) {
+            if (bpm > 0) seconds += (point - last_beat) * 60.0 / bpm;
+            last_beat = point;
+        }
+        bpm = tempo->beats.current_bpm[i];
+    }
+    if (bpm > 0 && beat > last_beat) seconds += (beat - last_beat) * 60.0 / bpm;
+    return seconds;
+}
+
+void chart_ir_beats_to_seconds(const chart_ir *ir, double *beats, const int count) {
+    const chart_tempo_track *tempo = &ir->tempo;
+    // 与 chart_ir_beat_to_seconds 相同的逐段累加；拍数递增，下一个拍数从上一个停下的 BPM 点继续，
+    // 拍数变小时从第一个 BPM 点重新累加
+    const double first_bpm = tempo->count > 0 ? tempo->beats.current_bpm[0] : 0.0;
+    double seconds = 0.0;
+    double last_beat = 0.0;
+    double bpm = first_bpm;
+    double previous = 0.0;
+    int next = 0;
+    for (int n = 0; n < count; n++) {
+        const double beat = beats[n];
+        if (beat < previous) {
+            seconds = 0.0;
+            last_beat = 0.0;
+            bpm = first_bpm;
+            next = 0;
+        }
+        previous = beat;
+        for (; next < tempo->count; next++) {
+            const double point = beat_value(&tempo->beats, next);
+            if (point >= beat) break;
+            if (point > last_beat) {
+                if (bpm > 0) seconds += (point - last_beat) * 60.0 / bpm;
+                last_beat = point;
+            }
+            bpm = tempo->beats.current_bpm[next];
+        }
+        beats[n] = bpm > 0 && beat > last_beat ? seconds + (beat - last_beat) * 60.0 / bpm : seconds;
+    }
+}
+
+static void move_beat(const chart_beat_columns *beats, const int to, const int from) {
+    beats->integer[to] = beats->integer[from];
+    beats->molecule[to] = beats->molecule[from];
+    beats->denominator[to] = beats->denominator[from];
+    beats->current_bpm[to] = beats->current_bpm[from];
+    beats->start_bpm[to] = beats->start_bpm[from];
+}
+
+// 按原顺序批量换算各元素的开始时间（秒），内存不足时返回 NULL，由调用方逐个换算
+static double *start_seconds(const chart_ir *ir, const chart_beat_columns *beats, const int count) {
+    double *times = malloc((size_t) (count > 0 ? count : 1) * sizeof(double));
+    if (!times) return NULL;
+    for (int i = 0; i < count; i++) {
+        times[i] = beat_value(beats, i);
+    }
+    chart_ir_beats_to_seconds(ir, times, count);
+    return times;
+}
+
+static double start_time(const chart_ir *ir, const double *times, const chart_beat_columns *beats, const int i) {
+    return times ? times[i] : chart_ir_beat_to_seconds(ir, beat_value(beats, i));
+}
+
+// 按原顺序保留在窗口内开始的 note
+static void truncate_notes(const chart_ir *ir, chart_note_track *track, const double seconds) {
+    double *times = start_seconds(ir, &track->hit, track->count);
+    int kept = 0;
+    for (int i = 0; i < track->count; i++) {
+        if (start_time(ir, times, &track->hit, i) > seconds) continue;
+        if (kept != i) move_beat(&track->hit, kept, i);
+        kept++;
+    }
+    track->count = kept;
+    free(times);
+}
+
+void chart_ir_truncate(chart_ir *ir, const double seconds) {
+    for (int c = 0; c < CHART_EVENT_COUNT; c++) {
+        chart_event_channel *channel = &ir->events[c];
+        double *times = start_seconds(ir, &channel->start, channel->count);
+        int kept = 0;
+        for (int i = 0; i < channel->count; i++) {
+            if (start_time(ir, times, &channel->start, i) > seconds) continue;
+            if (kept != i) {
+                move_beat(&channel->start, kept, i);
+                move_beat(&channel->end, kept, i);
+                channel->start_value[kept] = channel->start_value[i];
+                channel->end_value[kept] = channel->end_value[i];
+                channel->curve_index[kept] = channel->curve_index[i];
+            }
+            kept++;
+        }
+        channel->count = kept;
+        free(times);
+    }
+    for (int i = 0; i < CHART_LINE_COUNT; i++) {
+        truncate_notes(ir, &ir->lines[i].online, seconds);
+        truncate_notes(ir, &ir->lines[i].offline, seconds);
+    }
+    if (ir->music_length < 0 || ir->music_length > seconds) {
+        ir->music_length = seconds;
+    }
+}
+
+// 每个节拍占用的字节数（各列之和）
+#define CHART_BEAT_BYTES (3 * sizeof(int) + 2 * sizeof(double))
+
+size_t chart_ir_memory(const chart_ir *ir) {
+    size_t bytes = (size_t) ir->tempo.capacity * CHART_BEAT_BYTES;
+    for (int i = 0; i < CHART_EVENT_COUNT; i++) {
+        bytes += (size_t) ir->events[i].capacity * (2 * CHART_BEAT_BYTES + 2 * sizeof(double) + sizeof(int));
+    }
+    for (int i = 0; i < CHART_LINE_COUNT; i++) {
+        bytes += (size_t) (ir->lines[i].online.capacity + ir->lines[i].offline.capacity) * CHART_BEAT_BYTES;
+    }
+    return bytes;
+}
+
+// 用于获取最简分数的最大公约数
+static int gcd(int a, int b) {
+    while (b != 0) {
+        const int temp = b;
+        b = a % b;
+        a = temp;
+    }
+    return a;
+}
+
+// 将 double 转换为近似的分数形式
+void double_to_fraction(const double value, int *main, int *molecule, int *denominator) {
+    // 获取整数部分
+    *main = (int) value;
+
+    // 获取小数部分
+    const double fractional_part = value - *main;
+
+    // 假设我们将小数部分转换为分母为 1000 的分数
+    const int precision = 1000;
+    const int num = (int) (fractional_part * precision); // 小数部分乘以1000
+    *denominator = precision;
+
+    // 最简分数
+    const int common_divisor = gcd(num, *denominator);
+    *molecule = num / common_divisor;
+    *denominator = *denominator / common_divisor;
+}
+
+static void write_beat(json_writer *w, const chart_beat_columns *beats, const int index) {
+    json_writer_begin_object(w);
+    json_writer_key(w, "integer");
+    json_writer_number(w, beats->integer[index]);
+    json_writer_key(w, "molecule");
+    json_writer_number(w, beats->molecule[index]);
+    json_writer_key(w, "denominator");
+    json_writer_number(w, beats->denominator[index]);
+    json_writer_key(w, "currentBPM");
+    json_writer_number(w, beats->current_bpm[index]);
+    json_writer_key(w, "ThisStartBPM");
+    json_writer_number(w, beats->start_bpm[index]);
+    json_writer_end_object(w);
+}
+
+static void write_events(json_writer *w, const chart_event_channel *channel) {
+    json_writer_begin_array(w);
+    for (int i = 0; i < channel->count; i++) {
+        json_writer_begin_object(w);
+        json_writer_key(w, "startBeats");
+        write_beat(w, &channel->start, i);
+        json_writer_key(w, "endBeats");
+        write_beat(w, &channel->end, i);
+        json_writer_key(w, "startValue");
+        json_writer_number(w, channel->start_value[i]);
+        json_writer_key(w, "endValue");
+        json_writer_number(w, channel->end_value[i]);
+        json_writer_key(w, "curveIndex");
+        json_writer_number(w, channel->curve_index[i]);
+        json_writer_key(w, "IsSelected");
+        json_writer_bool(w, 0);
+        json_writer_end_object(w);
+    }
+    json_writer_end_array(w);
+}
+
+static void write_notes(json_writer *w, const char *name, const char *length_name, const chart_note_track *track) {
+    json_writer_key(w, name);
+    json_writer_begin_array(w);
+    for (int i = 0; i < track->count; i++) {
+        json_writer_begin_object(w);
+        json_writer_key(w, "hitBeats");
+        write_beat(w, &track->hit, i);
+        json_writer_end_object(w);
+    }
+    json_writer_end_array(w);
+    json_writer_key(w, length_name);
+    json_writer_number(w, track->count);
+}
+
+// 按条目数预估输出大小，避免反复扩容
+static size_t estimate_size(const chart_ir *ir) {
+    size_t estimate = 4096 + (size_t) ir->tempo.count * 160;
+    for (int i = 0; i < CHART_EVENT_COUNT; i++) {
+        estimate += (size_t) ir->events[i].count * 400;
+    }
+    for (int i = 0; i < CHART_LINE_COUNT; i++) {
+        estimate += (size_t) (ir->lines[i].online.count + ir->lines[i].offline.count) * 200;
+    }
+    return estimate;
+}
+
+// 输出到 bpmList 为止的部分
+static void write_head(json_writer *w, const chart_ir *ir) {
+    json_writer_begin_object(w);
+    json_writer_key(w, "yScale");
+    json_writer_number(w, 6.0);
+    json_writer_key(w, "beatSubdivision");
+    json_writer_number(w, 4);
+    json_writer_key(w, "verticalSubdivision");
+    json_writer_number(w, 16);
+    json_writer_key(w, "eventVerticalSubdivision");
+    json_writer_number(w, 10);
+    json_writer_key(w, "playSpeed");
+    json_writer_number(w, 1.0);
+    json_writer_key(w, "offset");
+    json_writer_number(w, ir->offset);
+    json_writer_key(w, "musicLength");
+    json_writer_number(w, ir->music_length);
+    json_writer_key(w, "loopPlayBack");
+    json_writer_bool(w, 1);
+
+    json_writer_key(w, "bpmList");
+    json_writer_begin_array(w);
+    for (int i = 0; i < ir->tempo.count; i++) {
+        write_beat(w, &ir->tempo.beats, i);
+    }
+    json_writer_end_array(w);
+}
+
+// 输出 boxes 并结束根对象
+static void write_boxes(json_writer *w, const chart_ir *ir) {
+    json_writer_key(w, "boxes");
+    json_writer_begin_array(w);
+    json_writer_begin_object(w);
+
+    json_writer_key(w, "boxEvents");
+    json_writer_begin_object(w);
+    for (int i = 0; i < CHART_EVENT_COUNT; i++) {
+        json_writer_key(w, event_names[i]);
+        write_events(w, &ir->events[i]);
+    }
+    // Length 字段与对应数组的长度一致
+    for (int i = 0; i < CHART_EVENT_COUNT; i++) {
+        json_writer_key(w, event_length_names[i]);
+        json_writer_number(w, ir->events[i].count);
+    }
+    json_writer_end_object(w);
+
+    json_writer_key(w, "lines");
+    json_writer_begin_array(w);
+    for (int i = 0; i < CHART_LINE_COUNT; i++) {
+        json_writer_begin_object(w);
+        write_notes(w, "onlineNotes", "onlineNotesLength", &ir->lines[i].online);
+        write_notes(w, "offlineNotes", "offlineNotesLength", &ir->lines[i].offline);
+        json_writer_end_object(w);
+    }
+    json_writer_end_array(w);
+
+    json_writer_end_object(w);
+    json_writer_end_array(w);
+    json_writer_end_object(w);
+}
+
+static int is_default_beat(const chart_beat_columns *beats, const int index, const int integer, const double bpm) {
+    return beats->integer[index] == integer && beats->molecule[index] == 0 && beats->denominator[index] == 1
+           && beats->current_bpm[index] == bpm && beats->start_bpm[index] == bpm;
+}
+
+// boxes 是否只有 chart_ir_init 添加的默认内容
+static int has_default_boxes(const chart_ir *ir) {
+    const chart_event_channel *speed = &ir->events[CHART_EVENT_SPEED];
+    if (speed->count != 1 || !is_default_beat(&speed->start, 0, 0, 0.0) || !is_default_beat(&speed->end, 0, 0, 1.0)
+        || speed->start_value[0] != 3.0 || speed->end_value[0] != 3.0 || speed->curve_index[0] != 0) {
+        return 0;
+    }
+    for (int i = CHART_EVENT_SPEED + 1; i < CHART_EVENT_COUNT; i++) {
+        if (ir->events[i].count != 0) return 0;
+    }
+    for (int i = 0; i < CHART_LINE_COUNT; i++) {
+        if (ir->lines[i].online.count != 0 || ir->lines[i].offline.count != 0) return 0;
+    }
+    return 1;
+}
+
+int chart_skeleton_init(chart_skeleton *skeleton, const int formatted) {
+    memset(skeleton, 0, sizeof(chart_skeleton));
+    skeleton->formatted = formatted;
+
+    chart_ir ir;
+    json_writer w;
+    if (!chart_ir_init(&ir, 0.0, -1.0, 0) || !json_writer_init(&w, estimate_size(&ir), formatted)) {
+        chart_ir_free(&ir);
+        return 0;
+    }
+    write_head(&w, &ir);
+    const size_t tail_offset = w.len;
+    write_boxes(&w, &ir);
+    chart_ir_free(&ir);
+
+    size_t length;
+    char *json = json_writer_finish(&w, &length);
+    if (!json) {
+        return 0;
+    }
+    skeleton->tail_length = length - tail_offset;
+    memmove(json, json + tail_offset, skeleton->tail_length + 1);
+    skeleton->tail = json;
+    return 1;
+}
+
+void chart_skeleton_free(chart_skeleton *skeleton) {
+    free(skeleton->tail);
+    memset(skeleton, 0, sizeof(chart_skeleton));
+}
+
+static void write_chart(json_writer *w, const chart_ir *ir, const chart_skeleton *skeleton) {
+    write_head(w, ir);
+    if (skeleton && skeleton->tail && skeleton->formatted == w->formatted && has_default_boxes(ir)) {
+        json_writer_raw(w, skeleton->tail, skeleton->tail_length);
+    } else {
+        write_boxes(w, ir);
+    }
+}
+
+char *chart_ir_serialize_cached(const chart_ir *ir, const int formatted, const chart_skeleton *skeleton,
+                                size_t *length) {
+    TRACE_PROBE1(chart_json_start, ir->tempo.count);
+    const double trace_start_time = trace_begin();
+    json_writer w;
+    if (!json_writer_init(&w, estimate_size(ir), formatted)) {
+        return NULL;
+    }
+
+    write_chart(&w, ir, skeleton);
+    char *json = json_writer_finish(&w, length);
+    if (!json) {
+        LOG_ERROR(RED "==> JSON 格式化失败\n" RESET);
+    }
+    TRACE_PROBE1(chart_json_done, json != NULL);
+    trace_end("create_chart_json", trace_start_time, NULL);
+    return json;
+}
+
+int chart_ir_serialize_stream(const chart_ir *ir, const int formatted, const chart_skeleton *skeleton,
+                              const json_writer_sink sink, void *user) {
+    TRACE_PROBE1(chart_json_start, ir->tempo.count);
+    const double trace_start_time = trace_begin();
+    json_writer w;
+    if (!json_writer_init(&w, JSON_WRITER_FLUSH_SIZE, formatted)) {
+        return 0;
+    }
+    json_writer_set_sink(&w, sink, user);
+
+    write_chart(&w, ir, skeleton);
+    const int ok = json_writer_flush(&w);
+    json_writer_free(&w);
+    if (!ok) {
+        LOG_ERROR(RED "==> JSON 格式化失败\n" RESET);
+    }
+    TRACE_PROBE1(chart_json_done, ok);
+    trace_end("create_chart_json", trace_start_time, NULL);
+    return ok;
+}
+
+char *chart_ir_serialize(const chart_ir *ir, const int formatted, size_t *length) {
+    return chart_ir_serialize_cached(ir, formatted, NULL, length);
+}
+
+int chart_ir_write_file(const chart_ir *ir, const char *output_path) {
+    size_t length;
+    char *json_string = chart_ir_serialize(ir, 1, &length);
+    if (!json_string) {
+        return 0;
+    }
+
+    LOG_INFO(GREEN "==> Json数据初始化完成.\n" RESET);
+
+    // 写入同目录的临时文件后重命名，失败时不会留下不完整的 Chart.json
+    char temp_path[1100];
+    FILE *file = atomic_file_open(output_path, temp_path, sizeof(temp_path));
+    if (!file) {
+        free(json_string);
+        return 0;
+    }
+
+    fprintf(file, "%s\n", json_string);
+    if (!atomic_file_commit(file, temp_path, output_path, 1)) {
+        free(json_string);
+        return 0;
+    }
+
+    LOG_INFO(GREEN "==> 保存成功, 文件位于: %s\n" RESET, output_path);
+
+#ifdef DEBUG
+    // 调试构建下校验生成的谱面
+    validate_chart_string(json_string, length, output_path);
+#endif
+
+    free(json_string);
+    return 1;
+}
+
+static int write_to_file(void *user, const char *data, const size_t len) {
+    return fwrite(data, 1, len, user) == len;
+}
+
+int chart_ir_write_file_compressed(const chart_ir *ir, const char *output_path, const output_compression format,
+                                   const int level) {
+    if (format == OUTPUT_COMPRESSION_NONE) {
+        return chart_ir_write_file(ir, output_path);
+    }
+    char temp_path[1100];
+    FILE *file = atomic_file_open(output_path, temp_path, sizeof(temp_path));
+    if (!file) {
+        return 0;
+    }
+
+    // 边序列化边压缩，与未压缩的输出一样以换行结尾
+    deflate_stream stream;
+    int ok = deflate_stream_init(&stream, format, level, write_to_file, file);
+    if (ok) {
+        ok = chart_ir_serialize_stream(ir, 1, NULL, deflate_stream_write, &stream) &&
+             deflate_stream_write(&stream, "\n", 1);
+        ok = deflate_stream_finish(&stream) && ok;
+    }
+    if (!ok) {
+        LOG_ERROR(RED "==> 写入文件失败: %s\n" RESET, output_path);
+        fclose(file);
+        REMOVE_FILE(temp_path);
+        return 0;
+    }
+    if (!atomic_file_commit(file, temp_path, output_path, 1)) {
+        return 0;
+    }
+    LOG_INFO(GREEN "==> 保存成功, 文件位于: %s\n" RESET, output_path);
+    return 1;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include "cross_platform.h"
+#include "deflate_stream.h"
+
+// 各前端共用的谱面中间表示：按列存储（struct-of-arrays），
+// BPM 点、事件通道和每条线的 note 都是连续的类型化数组，由 chart_ir_serialize 统一输出 Chart.json
+
+// 判定线数量
+#define CHART_LINE_COUNT 5
+
+// boxEvents 中的事件通道
+typedef enum {
+    CHART_EVENT_SPEED = 0,
+    CHART_EVENT_MOVE_X,
+    CHART_EVENT_MOVE_Y,
+    CHART_EVENT_ROTATE,
+    CHART_EVENT_ALPHA,
+    CHART_EVENT_SCALE_X,
+    CHART_EVENT_SCALE_Y,
+    CHART_EVENT_CENTER_X,
+    CHART_EVENT_CENTER_Y,
+    CHART_EVENT_LINE_ALPHA,
+    CHART_EVENT_COUNT
+} chart_event_id;
+
+// 单个节拍，用于添加条目时传参
+typedef struct {
+    int integer;
+    int molecule;
+    int denominator;
+    double current_bpm;
+    double start_bpm; // 输出为 ThisStartBPM
+} chart_beat;
+
+// 节拍的各个字段分列存储
+typedef struct {
+    int *integer;
+    int *molecule;
+    int *denominator;
+    double *current_bpm;
+    double *start_bpm;
+} chart_beat_columns;
+
+typedef struct {
+    int count;
+    int capacity;
+    chart_beat_columns beats;
+} chart_tempo_track;
+
+typedef struct {
+    int count;
+    int capacity;
+    chart_beat_columns start;
+    chart_beat_columns end;
+    double *start_value;
+    double *end_value;
+    int *curve_index;
+} chart_event_channel;
+
+typedef struct {
+    int count;
+    int capacity;
+    chart_beat_columns hit; // 输出为 hitBeats
+} chart_note_track;
+
+typedef struct {
+    chart_note_track online;
+    chart_note_track offline;
+} chart_line;
+
+typedef struct {
+    double offset; // 秒
+    double music_length; // 秒，未知时为 -1
+    chart_tempo_track tempo;
+    chart_event_channel events[CHART_EVENT_COUNT];
+    chart_line lines[CHART_LINE_COUNT];
+} chart_ir;
+
+// 初始化谱面，包含默认的 speed 事件；tempo_hint 为预计的 BPM 点数量
+int chart_ir_init(chart_ir *ir, double offset, double music_length, int tempo_hint);
+void chart_ir_free(chart_ir *ir);
+
+// 添加条目，内存不足时返回 0
+int chart_ir_add_tempo(chart_ir *ir, const chart_beat *beat);
+int chart_ir_add_event(chart_ir *ir, chart_event_id channel, const chart_beat *start, const chart_beat *end,
+                       double start_value, double end_value, int curve_index);
+int chart_ir_add_note(chart_ir *ir, int line, int online, const chart_beat *hit);
+
+// 按 bpmList 把拍数换算为秒（不含 offset）
+double chart_ir_beat_to_seconds(const chart_ir *ir, double beat);
+// 同上，原地把一组拍数替换为秒；按升序排列时整体只遍历一次 bpmList
+void chart_ir_beats_to_seconds(const chart_ir *ir, double *beats, int count);
+// 预览：去掉开始时间晚于 seconds 的 note 和事件，bpmList、offset 保持完整，
+// musicLength 未知或更长时截为 seconds
+void chart_ir_truncate(chart_ir *ir, double seconds);
+// 谱面各数组已分配的字节数，用于检查单个任务的内存预算
+size_t chart_ir_memory(const chart_ir *ir);
+
+// 将小数拍转换为带分数，分母不超过 1000
+void double_to_fraction(double value, int *main, int *molecule, int *denominator);
+
+// 输出 Chart.json 文本，格式与 cJSON_Print / cJSON_PrintUnformatted 一致
+char *chart_ir_serialize(const chart_ir *ir, int formatted, size_t *length);
+// 序列化并写入文件（格式化输出），成功返回 1
+int chart_ir_write_file(const chart_ir *ir, const char *output_path);
+// 同上，输出经 gzip / zlib 压缩（level 0-9），不压缩时等同 chart_ir_write_file
+int chart_ir_write_file_compressed(const chart_ir *ir, const char *output_path, output_compression format,
+                                   int level);
+
+// 谱面骨架缓存：预先生成只含默认事件、没有 note 的 boxes 片段，
+// 批量转换时多个线程只读共享，命中的谱面只需输出 bpmList 之前的部分
+typedef struct {
+    char *tail; // bpmList 之后到文本结尾的片段
+    size_t tail_length;
+    int formatted;
+} chart_skeleton;
+
+int chart_skeleton_init(chart_skeleton *skeleton, int formatted);
+void chart_skeleton_free(chart_skeleton *skeleton);
+// skeleton 为 NULL 或谱面含有非默认的 boxes 时按完整流程输出
+char *chart_ir_serialize_cached(const chart_ir *ir, int formatted, const chart_skeleton *skeleton, size_t *length);
+// 流式输出：文本每积累 JSON_WRITER_FLUSH_SIZE 字节交给 sink 一次（例如 deflate_stream_write），
+// 不在内存中保留完整的 Chart.json；成功返回 1
+int chart_ir_serialize_stream(const chart_ir *ir, int formatted, const chart_skeleton *skeleton,
+                              json_writer_sink sink, void *user);
@@ -0,0 +1,254 @@
+#include "chart_stats.h"
+#include "json_writer.h"
+
+#include <math.h>
+
+int analysis_format_parse(const char *name, analysis_format *format) {
+    if (strcmp(name, "json") == 0) {
+        *format = ANALYSIS_JSON;
+    } else if (strcmp(name, "csv") == 0) {
+        *format = ANALYSIS_CSV;
+    } else {
+        fprintf(stderr, RED "==> 未知的统计输出格式: %s（可用 json、csv）\n" RESET, name);
+        return 0;
+    }
+    return 1;
+}
+
+void chart_stats_init(chart_stats *stats, const chart_format format) {
+    memset(stats, 0, sizeof(chart_stats));
+    stats->format = format;
+    stats->mode = -1;
+    stats->columns = -1;
+    stats->last_end_beat = -1;
+}
+
+void chart_stats_free(chart_stats *stats) {
+    free(stats->title);
+    free(stats->artist);
+    free(stats->version);
+    free(stats->creator);
+    free(stats->times);
+    memset(stats, 0, sizeof(chart_stats));
+}
+
+int chart_stats_add_note(chart_stats *stats, const double beat, const double end_beat, const int column) {
+    if (stats->time_count == stats->time_capacity) {
+        const int capacity = stats->time_capacity ? stats->time_capacity * 2 : 1024;
+        double *times = realloc(stats->times, sizeof(double) * (size_t) capacity);
+        if (!times) {
+            LOG_ERROR(RED "==> 内存分配失败\n" RESET);
+            return 0;
+        }
+        stats->times = times;
+        stats->time_capacity = capacity;
+    }
+    stats->times[stats->time_count++] = beat;
+    stats->note_count++;
+    if (end_beat >= 0) {
+        stats->type_counts[CHART_NOTE_HOLD]++;
+        if (end_beat > stats->last_end_beat) stats->last_end_beat = end_beat;
+    } else {
+        stats->type_counts[CHART_NOTE_TAP]++;
+    }
+    if (column >= 0 && column < CHART_STATS_MAX_COLUMNS) {
+        stats->column_counts[column]++;
+        if (column >= stats->column_limit) stats->column_limit = column + 1;
+    }
+    return 1;
+}
+
+static int compare_double(const void *a, const void *b) {
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void tempo_stats(chart_stats *stats, const chart_tempo_track *tempo) {
+    stats->tempo_points = tempo->count;
+    for (int i = 0; i < tempo->count; i++) {
+        const double bpm = tempo->beats.current_bpm[i];
+        if (i == 0) {
+            stats->bpm_min = stats->bpm_max = bpm;
+            continue;
+        }
+        if (bpm < stats->bpm_min) stats->bpm_min = bpm;
+        if (bpm > stats->bpm_max) stats->bpm_max = bpm;
+        if (bpm != tempo->beats.current_bpm[i - 1]) stats->tempo_changes++;
+    }
+}
+
+int chart_stats_finish(chart_stats *stats, const chart_ir *ir) {
+    tempo_stats(stats, &ir->tempo);
+
+    // 谱面中的 note 不一定按时间排列，排序后换算只需遍历一次 bpmList
+    const int count = stats->time_count;
+    double *times = stats->times;
+    qsort(times, (size_t) count, sizeof(double), compare_double);
+    chart_ir_beats_to_seconds(ir, times, count);
+    stats->duration = count > 0 ? times[count - 1] : 0.0;
+    if (stats->last_end_beat >= 0) {
+        const double end = chart_ir_beat_to_seconds(ir, stats->last_end_beat);
+        if (end > stats->duration) stats->duration = end;
+    }
+
+    // 滑动窗口：start 为窗口中最早的 note，窗口内的 note 数即为从 times[start] 开始的密度
+    int peak = 0;
+    int start = 0;
+    for (int i = 0; i < count; i++) {
+        while (times[i] - times[start] >= CHART_STATS_DENSITY_WINDOW) {
+            start++;
+        }
+        if (i - start + 1 > peak) {
+            peak = i - start + 1;
+            stats->peak_time = times[start];
+        }
+    }
+    stats->peak_nps = peak / CHART_STATS_DENSITY_WINDOW;
+    stats->average_nps = stats->duration > 0 ? stats->note_count / stats->duration : 0.0;
+    return 1;
+}
+
+size_t chart_stats_memory(const chart_stats *stats) {
+    return (size_t) stats->time_capacity * sizeof(double);
+}
+
+const char *chart_stats_csv_header(void) {
+    return "file,format,title,artist,version,creator,mode,columns,notes,taps,holds,column_notes,"
+           "tempo_points,tempo_changes,bpm_min,bpm_max,duration,peak_nps,peak_time,average_nps\n";
+}
+
+// 秒数保留到毫秒
+static double round_ms(const double seconds) {
+    return round(seconds * 1000) / 1000;
+}
+
+static void json_optional_string(json_writer *w, const char *key, const char *value) {
+    json_writer_key(w, key);
+    if (value) {
+        json_writer_string(w, value);
+    } else {
+        json_writer_null(w);
+    }
+}
+
+static void json_optional_int(json_writer *w, const char *key, const int value) {
+    json_writer_key(w, key);
+    if (value >= 0) {
+        json_writer_number(w, value);
+    } else {
+        json_writer_null(w);
+    }
+}
+
+static void format_json(json_writer *w, const chart_stats *stats, const char *name) {
+    json_writer_begin_object(w);
+    json_writer_key(w, "file");
+    json_writer_string(w, name);
+    json_writer_key(w, "format");
+    json_writer_string(w, chart_format_name(stats->format));
+    json_optional_string(w, "title", stats->title);
+    json_optional_string(w, "artist", stats->artist);
+    json_optional_string(w, "version", stats->version);
+    json_optional_string(w, "creator", stats->creator);
+    json_optional_int(w, "mode", stats->mode);
+    json_optional_int(w, "columns", stats->columns);
+    json_writer_key(w, "notes");
+    json_writer_number(w, stats->note_count);
+    json_writer_key(w, "taps");
+    json_writer_number(w, stats->type_counts[CHART_NOTE_TAP]);
+    json_writer_key(w, "holds");
+    json_writer_number(w, stats->type_counts[CHART_NOTE_HOLD]);
+    json_writer_key(w, "column_notes");
+    json_writer_begin_array(w);
+    for (int i = 0; i < stats->column_limit; i++) {
+        json_writer_number(w, stats->column_counts[i]);
+    }
+    json_writer_end_array(w);
+    json_writer_key(w, "tempo_points");
+    json_writer_number(w, stats->tempo_points);
+    json_writer_key(w, "tempo_changes");
+    json_writer_number(w, stats->tempo_changes);
+    json_writer_key(w, "bpm_min");
+    json_writer_number(w, stats->bpm_min);
+    json_writer_key(w, "bpm_max");
+    json_writer_number(w, stats->bpm_max);
+    json_writer_key(w, "duration");
+    json_writer_number(w, round_ms(stats->duration));
+    json_writer_key(w, "peak_nps");
+    json_writer_number(w, stats->peak_nps);
+    json_writer_key(w, "peak_time");
+    json_writer_number(w, round_ms(stats->peak_time));
+    json_writer_key(w, "average_nps");
+    json_writer_number(w, round_ms(stats->average_nps));
+    json_writer_end_object(w);
+}
+
+// 含逗号、引号或换行的字段加引号，字段中的引号写两次
+static void csv_string(json_writer *w, const char *value) {
+    if (value && strpbrk(value, ",\"\r\n")) {
+        json_writer_raw(w, "\"", 1);
+        for (const char *p = value; *p; p++) {
+            if (*p == '"') json_writer_raw(w, "\"", 1);
+            json_writer_raw(w, p, 1);
+        }
+        json_writer_raw(w, "\"", 1);
+    } else if (value) {
+        json_writer_raw(w, value, strlen(value));
+    }
+    json_writer_raw(w, ",", 1);
+}
+
+static void csv_number(json_writer *w, const double value, const char *separator) {
+    char number[32];
+    const int length = snprintf(number, sizeof(number), "%.15g%s", value, separator);
+    json_writer_raw(w, number, (size_t) length);
+}
+
+static void csv_optional_int(json_writer *w, const int value) {
+    if (value >= 0) {
+        csv_number(w, value, ",");
+    } else {
+        json_writer_raw(w, ",", 1);
+    }
+}
+
+static void format_csv(json_writer *w, const chart_stats *stats, const char *name) {
+    csv_string(w, name);
+    csv_string(w, chart_format_name(stats->format));
+    csv_string(w, stats->title);
+    csv_string(w, stats->artist);
+    csv_string(w, stats->version);
+    csv_string(w, stats->creator);
+    csv_optional_int(w, stats->mode);
+    csv_optional_int(w, stats->columns);
+    csv_number(w, stats->note_count, ",");
+    csv_number(w, stats->type_counts[CHART_NOTE_TAP], ",");
+    csv_number(w, stats->type_counts[CHART_NOTE_HOLD], ",");
+    // 各列的数量以分号分隔，放在同一个字段中
+    for (int i = 0; i < stats->column_limit; i++) {
+        csv_number(w, stats->column_counts[i], i + 1 < stats->column_limit ? ";" : "");
+    }
+    json_writer_raw(w, ",", 1);
+    csv_number(w, stats->tempo_points, ",");
+    csv_number(w, stats->tempo_changes, ",");
+    csv_number(w, stats->bpm_min, ",");
+    csv_number(w, stats->bpm_max, ",");
+    csv_number(w, round_ms(stats->duration), ",");
+    csv_number(w, stats->peak_nps, ",");
+    csv_number(w, round_ms(stats->peak_time), ",");
+    csv_number(w, round_ms(stats->average_nps), "");
+}
+
+char *chart_stats_format(const chart_stats *stats, const analysis_format format, const char *name,
+                         size_t *length) {
+    json_writer w;
+    if (!json_writer_init(&w, 512, 0)) return NULL;
+    if (format == ANALYSIS_CSV) {
+        format_csv(&w, stats, name);
+    } else {
+        format_json(&w, stats, name);
+    }
+    json_writer_raw(&w, "\n", 1);
+    return json_writer_finish(&w, length);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "cross_platform.h"
+#include "chart_format.h"
+
+// 谱面统计 (--analyze)：复用各前端的解码和 bpmList，不生成 Chart.json，
+// 统计 note 数量（按类型和列）、BPM 变化、时长和每秒 note 数的峰值，每个谱面输出一行 JSON 或 CSV。
+// 解码时只记录每个 note 的开始拍数，全部解码后排序，按 bpmList 一次换算为秒
+
+// 按列统计的列数上限，更大的列号只计入总数
+#define CHART_STATS_MAX_COLUMNS 16
+// 密度窗口（秒）：峰值为任意这么长的区间内的 note 数换算到每秒
+#define CHART_STATS_DENSITY_WINDOW 1.0
+
+// 统计结果的输出格式
+typedef enum {
+    ANALYSIS_NONE = 0,
+    ANALYSIS_JSON, // 每个谱面一行 JSON
+    ANALYSIS_CSV, // 第一行为表头
+} analysis_format;
+
+typedef enum {
+    CHART_NOTE_TAP,
+    CHART_NOTE_HOLD,
+    CHART_NOTE_TYPE_COUNT
+} chart_note_type;
+
+typedef struct {
+    chart_format format;
+    // 谱面信息，格式中没有时为 NULL / -1
+    char *title;
+    char *artist;
+    char *version; // 难度名
+    char *creator;
+    int mode;
+    int columns;
+
+    int note_count;
+    int type_counts[CHART_NOTE_TYPE_COUNT];
+    int column_counts[CHART_STATS_MAX_COLUMNS];
+    int column_limit; // 出现过的最大列号 + 1
+    int tempo_points;
+    int tempo_changes; // BPM 与前一个点不同的次数
+    double bpm_min;
+    double bpm_max;
+    double duration; // 到最后一个 note（长条按结束）的秒数
+    double peak_nps;
+    double peak_time; // 峰值窗口开始的秒数
+    double average_nps;
+
+    // note 的开始拍数，chart_stats_finish 后为升序的秒数
+    double *times;
+    int time_count;
+    int time_capacity;
+    double last_end_beat; // 最晚的长条结束拍，没有长条时为 -1
+} chart_stats;
+
+// 解析 "json" 或 "csv"，无效时返回 0
+int analysis_format_parse(const char *name, analysis_format *format);
+
+void chart_stats_init(chart_stats *stats, chart_format format);
+void chart_stats_free(chart_stats *stats);
+// 记录一个 note：end_beat 小于 0 时为单键，column 小于 0 时不按列统计；内存不足时返回 0
+int chart_stats_add_note(chart_stats *stats, double beat, double end_beat, int column);
+// 按 ir 中的 bpmList 统计 BPM，并把记录的拍数换算为秒，计算时长和密度
+int chart_stats_finish(chart_stats *stats, const chart_ir *ir);
+// 已记录的 note 占用的字节数，用于检查单个任务的内存预算
+size_t chart_stats_memory(const chart_stats *stats);
+
+// CSV 的表头行（含换行）
+const char *chart_stats_csv_header(void);
+// 输出一行统计结果（含换行），name 为谱面的输入路径
+char *chart_stats_format(const chart_stats *stats, analysis_format format, const char *name, size_t *length);
@@ -0,0 +1,331 @@
+#include "chart_validate.h"
+
+#include <stdarg.h>
+
+typedef struct {
+    json_reader *r;
+    const char *name;
+    int errors;
+} chart_validator;
+
+// boxEvents 中的事件数组及其对应的 Length 字段
+static const char *event_names[] = {
+    "speed", "moveX", "moveY", "rotate", "alpha", "scaleX", "scaleY", "centerX", "centerY", "lineAlpha"
+};
+static const char *event_length_names[] = {
+    "LengthSpeed", "LengthMoveX", "LengthMoveY", "LengthRotate", "LengthAlpha",
+    "LengthScaleX", "LengthScaleY", "LengthCenterX", "LengthCenterY", "LengthLineAlpha"
+};
+#define EVENT_COUNT (sizeof(event_names) / sizeof(event_names[0]))
+
+// 顶层必需字段
+static const char *required_fields[] = {
+    "yScale", "beatSubdivision", "verticalSubdivision", "eventVerticalSubdivision", "playSpeed",
+    "offset", "musicLength", "loopPlayBack", "bpmList", "boxes"
+};
+#define REQUIRED_COUNT (sizeof(required_fields) / sizeof(required_fields[0]))
+
+static void report(chart_validator *v, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, RED "==> 校验失败 %s: " RESET, v->name);
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    v->errors++;
+}
+
+static int find_name(const char *key, const char **names, const size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(key, names[i]) == 0) return (int) i;
+    }
+    return -1;
+}
+
+// 读取期望的 token，类型不符时报告并跳过该值
+static int expect(chart_validator *v, const json_token_type token, const json_token_type expected, const char *what) {
+    if (token == JSON_TOKEN_ERROR) return 0;
+    if (token != expected) {
+        report(v, "%s 类型不正确", what);
+        return json_reader_skip(v->r, token) ? -1 : 0;
+    }
+    return 1;
+}
+
+// 读取节拍对象 {integer, molecule, denominator}，返回节拍值
+static int read_beat(chart_validator *v, const char *what, double *beat) {
+    double integer = 0, molecule = 0, denominator = 1;
+    json_token_type token;
+    while ((token = json_reader_next(v->r)) == JSON_TOKEN_KEY) {
+        const int field = strcmp(v->r->str, "integer") == 0 ? 0
+                          : strcmp(v->r->str, "molecule") == 0 ? 1
+                          : strcmp(v->r->str, "denominator") == 0 ? 2 : -1;
+        token = json_reader_next(v->r);
+        if (field < 0) {
+            if (!json_reader_skip(v->r, token)) return 0;
+            continue;
+        }
+        if (token != JSON_TOKEN_NUMBER) {
+            if (!expect(v, token, JSON_TOKEN_NUMBER, what)) return 0;
+            continue;
+        }
+        if (field == 0) integer = v->r->number;
+        else if (field == 1) molecule = v->r->number;
+        else denominator = v->r->number;
+    }
+    if (token != JSON_TOKEN_OBJECT_END) return 0;
+
+    if (denominator == 0) {
+        report(v, "%s 的 denominator 为 0", what);
+        *beat = integer;
+    } else {
+        *beat = integer + molecule / denominator;
+    }
+    return 1;
+}
+
+// bpmList：节拍单调不减，分母不为 0
+static int validate_bpm_list(chart_validator *v) {
+    double last_beat = -1e300;
+    int index = 0;
+    json_token_type token;
+    while ((token = json_reader_next(v->r)) != JSON_TOKEN_ARRAY_END) {
+        char what[64];
+        snprintf(what, sizeof(what), "bpmList[%d]", index);
+        const int ok = expect(v, token, JSON_TOKEN_OBJECT_START, what);
+        if (ok == 0) return 0;
+        if (ok > 0) {
+            double beat;
+            if (!read_beat(v, what, &beat)) return 0;
+            if (beat < last_beat) {
+                report(v, "%s 的节拍 %lf 小于前一项 %lf", what, beat, last_beat);
+            }
+            last_beat = beat;
+        }
+        index++;
+    }
+    return 1;
+}
+
+// 统计数组元素个数
+static int count_array(chart_validator *v, int *count) {
+    *count = 0;
+    json_token_type token;
+    while ((token = json_reader_next(v->r)) != JSON_TOKEN_ARRAY_END) {
+        if (!json_reader_skip(v->r, token)) return 0;
+        (*count)++;
+    }
+    return 1;
+}
+
+// 音符数组：统计个数并检查 hitBeats 有序
+static int validate_notes(chart_validator *v, const char *what, int *count) {
+    double last_beat = -1e300;
+    *count = 0;
+    json_token_type token;
+    while ((token = json_reader_next(v->r)) != JSON_TOKEN_ARRAY_END) {
+        const int ok = expect(v, token, JSON_TOKEN_OBJECT_START, what);
+        if (ok == 0) return 0;
+        if (ok > 0) {
+            while ((token = json_reader_next(v->r)) == JSON_TOKEN_KEY) {
+                const int is_hit_beats = strcmp(v->r->str, "hitBeats") == 0;
+                token = json_reader_next(v->r);
+                if (is_hit_beats && token == JSON_TOKEN_OBJECT_START) {
+                    char note_what[96];
+                    snprintf(note_what, sizeof(note_what), "%s[%d].hitBeats", what, *count);
+                    double beat;
+                    if (!read_beat(v, note_what, &beat)) return 0;
+                    if (beat < last_beat) {
+                        report(v, "%s 未按节拍排序", note_what);
+                    }
+                    last_beat = beat;
+                } else if (!json_reader_skip(v->r, token)) {
+                    return 0;
+                }
+            }
+            if (token != JSON_TOKEN_OBJECT_END) return 0;
+        }
+        (*count)++;
+    }
+    return 1;
+}
+
+// 判线：onlineNotes/offlineNotes 与其 Length 字段一致
+static int validate_line(chart_validator *v, const char *what) {
+    int counts[2] = {-1, -1};
+    double lengths[2] = {-1, -1};
+    static const char *names[] = {"onlineNotes", "offlineNotes"};
+    static const char *length_names[] = {"onlineNotesLength", "offlineNotesLength"};
+
+    json_token_type token;
+    while ((token = json_reader_next(v->r)) == JSON_TOKEN_KEY) {
+        const int array = find_name(v->r->str, names, 2);
+        const int length = find_name(v->r->str, length_names, 2);
+        token = json_reader_next(v->r);
+        if (array >= 0 && token == JSON_TOKEN_ARRAY_START) {
+            char notes_what[96];
+            snprintf(notes_what, sizeof(notes_what), "%s.%s", what, names[array]);
+            if (!validate_notes(v, notes_what, &counts[array])) return 0;
+        } else if (length >= 0 && token == JSON_TOKEN_NUMBER) {
+            lengths[length] = v->r->number;
+        } else if (!json_reader_skip(v->r, token)) {
+            return 0;
+        }
+    }
+    if (token != JSON_TOKEN_OBJECT_END) return 0;
+
+    for (int i = 0; i < 2; i++) {
+        if (counts[i] >= 0 && lengths[i] >= 0 && lengths[i] != counts[i]) {
+            report(v, "%s.%s 为 %g，但 %s 有 %d 项", what, length_names[i], lengths[i], names[i], counts[i]);
+        }
+    }
+    return 1;
+}
+
+// boxEvents：每个事件数组与对应的 Length 字段一致
+static int validate_box_events(chart_validator *v, const char *what) {
+    int counts[EVENT_COUNT];
+    double lengths[EVENT_COUNT];
+    for (size_t i = 0; i < EVENT_COUNT; i++) {
+        counts[i] = -1;
+        lengths[i] = -1;
+    }
+
+    json_token_type token;
+    while ((token = json_reader_next(v->r)) == JSON_TOKEN_KEY) {
+        const int array = find_name(v->r->str, event_names, EVENT_COUNT);
+        const int length = find_name(v->r->str, event_length_names, EVENT_COUNT);
+        token = json_reader_next(v->r);
+        if (array >= 0 && token == JSON_TOKEN_ARRAY_START) {
+            if (!count_array(v, &counts[array])) return 0;
+        } else if (length >= 0 && token == JSON_TOKEN_NUMBER) {
+            lengths[length] = v->r->number;
+        } else if (!json_reader_skip(v->r, token)) {
+            return 0;
+        }
+    }
+    if (token != JSON_TOKEN_OBJECT_END) return 0;
+
+    for (size_t i = 0; i < EVENT_COUNT; i++) {
+        if (counts[i] >= 0 && lengths[i] >= 0 && lengths[i] != counts[i]) {
+            report(v, "%s.%s 为 %g，但 %s 有 %d 项", what, event_length_names[i], lengths[i], event_names[i],
+                   counts[i]);
+        }
+    }
+    return 1;
+}
+
+static int validate_boxes(chart_validator *v) {
+    int box_index = 0;
+    json_token_type token;
+    while ((token = json_reader_next(v->r)) != JSON_TOKEN_ARRAY_END) {
+        char what[64];
+        snprintf(what, sizeof(what), "boxes[%d]", box_index++);
+        const int ok = expect(v, token, JSON_TOKEN_OBJECT_START, what);
+        if (ok == 0) return 0;
+        if (ok < 0) continue;
+
+        while ((token = json_reader_next(v->r)) == JSON_TOKEN_KEY) {
+            const int is_events = strcmp(v->r->str, "boxEvents") == 0;
+            const int is_lines = strcmp(v->r->str, "lines") == 0;
+            token = json_reader_next(v->r);
+            if (is_events && token == JSON_TOKEN_OBJECT_START) {
+                char events_what[96];
+                snprintf(events_what, sizeof(events_what), "%s.boxEvents", what);
+                if (!validate_box_events(v, events_what)) return 0;
+            } else if (is_lines && token == JSON_TOKEN_ARRAY_START) {
+                int line_index = 0;
+                while ((token = json_reader_next(v->r)) != JSON_TOKEN_ARRAY_END) {
+                    char line_what[96];
+                    snprintf(line_what, sizeof(line_what), "%s.lines[%d]", what, line_index++);
+                    const int line_ok = expect(v, token, JSON_TOKEN_OBJECT_START, line_what);
+                    if (line_ok == 0) return 0;
+                    if (line_ok > 0 && !validate_line(v, line_what)) return 0;
+                }
+            } else if (!json_reader_skip(v->r, token)) {
+                return 0;
+            }
+        }
+        if (token != JSON_TOKEN_OBJECT_END) return 0;
+    }
+    return 1;
+}
+
+static int validate_chart_object(chart_validator *v) {
+    int seen[REQUIRED_COUNT] = {0};
+    json_token_type token = json_reader_next(v->r);
+    if (token != JSON_TOKEN_OBJECT_START) {
+        if (token != JSON_TOKEN_ERROR) report(v, "顶层不是对象");
+        return 0;
+    }
+
+    while ((token = json_reader_next(v->r)) == JSON_TOKEN_KEY) {
+        const int field = find_name(v->r->str, required_fields, REQUIRED_COUNT);
+        token = json_reader_next(v->r);
+        if (field < 0) {
+            if (!json_reader_skip(v->r, token)) return 0;
+            continue;
+        }
+        seen[field] = 1;
+
+        int ok;
+        if (strcmp(required_fields[field], "bpmList") == 0) {
+            ok = expect(v, token, JSON_TOKEN_ARRAY_START, "bpmList");
+            if (ok > 0) ok = validate_bpm_list(v);
+        } else if (strcmp(required_fields[field], "boxes") == 0) {
+            ok = expect(v, token, JSON_TOKEN_ARRAY_START, "boxes");
+            if (ok > 0) ok = validate_boxes(v);
+        } else if (strcmp(required_fields[field], "loopPlayBack") == 0) {
+            ok = token == JSON_TOKEN_TRUE || token == JSON_TOKEN_FALSE
+                     ? 1
+                     : expect(v, token, JSON_TOKEN_TRUE, "loopPlayBack");
+        } else {
+            ok = expect(v, token, JSON_TOKEN_NUMBER, required_fields[field]);
+        }
+        if (ok == 0) return 0;
+    }
+    if (token != JSON_TOKEN_OBJECT_END) return 0;
+
+    for (size_t i = 0; i < REQUIRED_COUNT; i++) {
+        if (!seen[i]) report(v, "缺少字段 %s", required_fields[i]);
+    }
+    return json_reader_next(v->r) == JSON_TOKEN_END;
+}
+
+int validate_chart_reader(json_reader *r, const char *name) {
+    chart_validator v = {r, name, 0};
+    if (!validate_chart_object(&v)) {
+        if (r->error) {
+            report(&v, "JSON 语法错误（第 %zu 字节）: %s", r->consumed + r->pos, r->error);
+        } else if (v.errors == 0) {
+            report(&v, "谱面结构不完整");
+        }
+    }
+    return v.errors;
+}
+
+int validate_chart_file(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, RED "==> 无法打开文件: %s\n" RESET, path);
+        return -1;
+    }
+    json_reader r;
+    if (!json_reader_init_file(&r, file)) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        fclose(file);
+        return -1;
+    }
+    const int errors = validate_chart_reader(&r, path);
+    json_reader_free(&r);
+    fclose(file);
+    return errors;
+}
+
+int validate_chart_string(const char *json, const size_t len, const char *name) {
+    json_reader r;
+    json_reader_init_mem(&r, json, len);
+    const int errors = validate_chart_reader(&r, name);
+    json_reader_free(&r);
+    return errors;
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include "json_reader.h"
+
+// 单次流式校验 Blophy 谱面，返回发现的问题数（0 表示通过），读取失败返回 -1
+int validate_chart_reader(json_reader *r, const char *name);
+int validate_chart_file(const char *path);
+int validate_chart_string(const char *json, size_t len, const char *name);
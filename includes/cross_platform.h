@@ -11,8 +11,42 @@
 #define REMOVE_DIR(path) RemoveDirectoryA(path)  // 删除空目录
 #define REMOVE_FILE_UTF16(path) DeleteFileW(path)  // 支持 UTF-16 编码路径
 #define REMOVE_DIR_UTF16(path) RemoveDirectoryW(path)  // 支持 UTF-16 编码路径
+#define STRCASECMP(a, b) _stricmp(a, b)  // 忽略大小写比较
+#define REPLACE_FILE(from, to) (MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0)  // 覆盖目标文件的重命名
+#include <process.h>
+#define GETPID() _getpid()
+#define FSYNC(fd) _commit(fd)  // 刷新文件到磁盘
+#include <io.h>
+#define DUP(fd) _dup(fd)  // 复制文件描述符
+#define DUP2(fd, fd2) _dup2(fd, fd2)
+#define FDOPEN(fd, mode) _fdopen(fd, mode)
+#define FILENO(file) _fileno(file)
+// 线程同步原语
+typedef CRITICAL_SECTION mutex_t;
+typedef CONDITION_VARIABLE cond_t;
+#define MUTEX_INIT(m) InitializeCriticalSection(m)
+#define MUTEX_LOCK(m) EnterCriticalSection(m)
+#define MUTEX_UNLOCK(m) LeaveCriticalSection(m)
+#define MUTEX_DESTROY(m) DeleteCriticalSection(m)
+#define COND_INIT(c) InitializeConditionVariable(c)
+#define COND_WAIT(c, m) SleepConditionVariableCS(c, m, INFINITE)
+#define COND_SIGNAL(c) WakeConditionVariable(c)
+#define COND_BROADCAST(c) WakeAllConditionVariable(c)
+#define COND_DESTROY(c) ((void) 0)
+// 在 Windows 控制台启用 ANSI 颜色
+static inline void enable_ansi_colors(void) {
+    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (hOut == INVALID_HANDLE_VALUE) return;
+
+    DWORD dwMode = 0;
+    if (!GetConsoleMode(hOut, &dwMode)) return;
+
+    dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+    SetConsoleMode(hOut, dwMode);
+}
 #else
 #include <dirent.h>
+#include <strings.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #define PATH_SEPARATOR '/'
@@ -20,6 +54,27 @@
 #define GET_ABS_PATH(path, abs_path) realpath(path, abs_path)
 #define REMOVE_FILE(path) remove(path)
 #define REMOVE_DIR(path) rmdir(path)
+#define STRCASECMP(a, b) strcasecmp(a, b)
+#define REPLACE_FILE(from, to) (rename(from, to) == 0)
+#define GETPID() getpid()
+#define FSYNC(fd) fsync(fd)
+#define DUP(fd) dup(fd)
+#define DUP2(fd, fd2) dup2(fd, fd2)
+#define FDOPEN(fd, mode) fdopen(fd, mode)
+#define FILENO(file) fileno(file)
+#include <pthread.h>
+typedef pthread_mutex_t mutex_t;
+typedef pthread_cond_t cond_t;
+#define MUTEX_INIT(m) pthread_mutex_init(m, NULL)
+#define MUTEX_LOCK(m) pthread_mutex_lock(m)
+#define MUTEX_UNLOCK(m) pthread_mutex_unlock(m)
+#define MUTEX_DESTROY(m) pthread_mutex_destroy(m)
+#define COND_INIT(c) pthread_cond_init(c, NULL)
+#define COND_WAIT(c, m) pthread_cond_wait(c, m)
+#define COND_SIGNAL(c) pthread_cond_signal(c)
+#define COND_BROADCAST(c) pthread_cond_broadcast(c)
+#define COND_DESTROY(c) pthread_cond_destroy(c)
+#define enable_ansi_colors() ((void) 0)
 #endif
 
 #include <stdio.h>
@@ -31,6 +86,8 @@
 
 // 定义缓冲区大小
 #define BUFFER_SIZE 8192
+// 标准输入按块读取的大小
+#define STDIN_BLOCK_SIZE (64 * 1024)
 
 // 调试输出宏
 #ifdef DEBUG
@@ -47,3 +104,14 @@
 #define MAGENTA "\033[1;35m"
 #define CYAN "\033[1;36m"
 #define WHITE "\033[1;37m"
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+// 核心库的输出开关（线程局部）：通过 blophy.h 嵌入调用时关闭，错误改由返回码报告
+extern THREAD_LOCAL int log_quiet;
+#define LOG_INFO(...) do { if (!log_quiet) printf(__VA_ARGS__); } while (0)
+#define LOG_ERROR(...) do { if (!log_quiet) fprintf(stderr, __VA_ARGS__); } while (0)
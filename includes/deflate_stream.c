@@ -0,0 +1,105 @@
+#include "deflate_stream.h"
+
+int output_compression_parse(const char *name, output_compression *format) {
+    if (strcmp(name, "gzip") == 0) {
+        *format = OUTPUT_COMPRESSION_GZIP;
+    } else if (strcmp(name, "zlib") == 0) {
+        *format = OUTPUT_COMPRESSION_ZLIB;
+    } else if (strcmp(name, "none") == 0) {
+        *format = OUTPUT_COMPRESSION_NONE;
+    } else {
+        fprintf(stderr, RED "==> 未知的压缩格式: %s（可用 gzip、zlib、none）\n" RESET, name);
+        return 0;
+    }
+    return 1;
+}
+
+const char *output_compression_extension(const output_compression format) {
+    switch (format) {
+        case OUTPUT_COMPRESSION_GZIP:
+            return ".gz";
+        case OUTPUT_COMPRESSION_ZLIB:
+            return ".zz";
+        default:
+            return "";
+    }
+}
+
+static mz_bool put_compressed(const void *data, const int len, void *user) {
+    deflate_stream *stream = user;
+    if (!stream->out(stream->out_user, data, (size_t) len)) {
+        stream->failed = 1;
+        return MZ_FALSE;
+    }
+    return MZ_TRUE;
+}
+
+// 按小端序写入 gzip 尾部的 32 位整数
+static void put_le32(unsigned char *p, const mz_uint32 value) {
+    p[0] = (unsigned char) value;
+    p[1] = (unsigned char) (value >> 8);
+    p[2] = (unsigned char) (value >> 16);
+    p[3] = (unsigned char) (value >> 24);
+}
+
+int deflate_stream_init(deflate_stream *stream, const output_compression format, const int level,
+                        const json_writer_sink out, void *user) {
+    memset(stream, 0, sizeof(deflate_stream));
+    stream->format = format;
+    stream->crc32 = MZ_CRC32_INIT;
+    stream->out = out;
+    stream->out_user = user;
+    stream->compressor = malloc(sizeof(tdefl_compressor));
+    if (!stream->compressor) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        return 0;
+    }
+
+    // gzip 使用原始 deflate 流，文件头和尾部自行输出；zlib 由 tdefl 输出头部和 Adler-32
+    const int window_bits = format == OUTPUT_COMPRESSION_ZLIB ? 15 : -15;
+    const mz_uint flags = tdefl_create_comp_flags_from_zip_params(level, window_bits, 0);
+    if (tdefl_init(stream->compressor, put_compressed, stream, (int) flags) != TDEFL_STATUS_OKAY) {
+        deflate_stream_free(stream);
+        return 0;
+    }
+    if (format == OUTPUT_COMPRESSION_GZIP) {
+        // ID1 ID2、deflate、无标志、修改时间为 0、XFL、OS 未知
+        static const char header[10] = {0x1f, (char) 0x8b, 8, 0, 0, 0, 0, 0, 0, (char) 0xff};
+        if (!out(user, header, sizeof(header))) {
+            deflate_stream_free(stream);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int deflate_stream_write(void *user, const char *data, const size_t len) {
+    deflate_stream *stream = user;
+    if (stream->failed) return 0;
+    if (stream->format == OUTPUT_COMPRESSION_GZIP) {
+        stream->crc32 = mz_crc32(stream->crc32, (const unsigned char *) data, len);
+        stream->size += (mz_uint32) len;
+    }
+    if (tdefl_compress_buffer(stream->compressor, data, len, TDEFL_NO_FLUSH) != TDEFL_STATUS_OKAY) {
+        stream->failed = 1;
+    }
+    return !stream->failed;
+}
+
+int deflate_stream_finish(deflate_stream *stream) {
+    int ok = !stream->failed &&
+             tdefl_compress_buffer(stream->compressor, NULL, 0, TDEFL_FINISH) == TDEFL_STATUS_DONE;
+    if (ok && stream->format == OUTPUT_COMPRESSION_GZIP) {
+        unsigned char trailer[8];
+        put_le32(trailer, (mz_uint32) stream->crc32);
+        put_le32(trailer + 4, stream->size);
+        ok = stream->out(stream->out_user, (const char *) trailer, sizeof(trailer));
+    }
+    deflate_stream_free(stream);
+    return ok;
+}
+
+void deflate_stream_free(deflate_stream *stream) {
+    free(stream->compressor);
+    stream->compressor = NULL;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "cross_platform.h"
+#include "json_writer.h"
+
+// 输出文件的压缩格式
+typedef enum {
+    OUTPUT_COMPRESSION_NONE = 0,
+    OUTPUT_COMPRESSION_GZIP, // .gz，可直接用 gzip -d / zcat 解压
+    OUTPUT_COMPRESSION_ZLIB, // .zz，zlib 头和 Adler-32 校验
+} output_compression;
+
+// 流式压缩：用 miniz 的 tdefl 边写入边压缩，压缩结果按顺序交给 out 回调，
+// 不需要先得到完整的未压缩文本
+typedef struct {
+    tdefl_compressor *compressor;
+    output_compression format;
+    mz_ulong crc32; // gzip 尾部的 CRC-32 和未压缩长度
+    mz_uint32 size;
+    json_writer_sink out;
+    void *out_user;
+    int failed;
+} deflate_stream;
+
+// 解析 "gzip"、"zlib" 或 "none"，无效时返回 0
+int output_compression_parse(const char *name, output_compression *format);
+// 输出文件名追加的扩展名，不压缩时为空字符串
+const char *output_compression_extension(output_compression format);
+
+// level 为 0-9（0 只存储不压缩）；gzip 时立即输出文件头
+int deflate_stream_init(deflate_stream *stream, output_compression format, int level, json_writer_sink out,
+                        void *user);
+// 压缩一段数据，签名与 json_writer_sink 相同，可直接作为 json_writer 的输出回调
+int deflate_stream_write(void *stream, const char *data, size_t len);
+// 输出剩余的压缩数据和校验尾部并释放压缩器，全部成功返回 1
+int deflate_stream_finish(deflate_stream *stream);
+// 出错时放弃压缩，释放压缩器
+void deflate_stream_free(deflate_stream *stream);
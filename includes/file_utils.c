@@ -0,0 +1,236 @@
+#ifdef __linux__
+#define _GNU_SOURCE // syncfs
+#endif
+#include "file_utils.h"
+#include "trace.h"
+
+#include <fcntl.h>
+
+char *read_file_sized(const char *filename, size_t *size) {
+    DEBUG_PRINT("读取文件: %s\n", filename);
+    TRACE_PROBE1(read_file_start, filename);
+    FILE *file = fopen(filename, "rb"); // Open in binary mode for cross-platform compatibility
+    if (!file) {
+        fprintf(stderr, RED "==> 无法打开文件: %s\n" RESET, filename);
+        return NULL;
+    }
+    const double trace_start_time = trace_begin();
+
+    fseek(file, 0, SEEK_END);
+    const long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (length < 0) {
+        fprintf(stderr, RED "==> 读取文件失败: %s\n" RESET, filename);
+        fclose(file);
+        return NULL;
+    }
+
+    char *content = malloc((size_t) length + 1);
+    if (!content) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        fclose(file);
+        return NULL;
+    }
+
+    const size_t read_len = fread(content, 1, (size_t) length, file);
+    if (read_len != (size_t) length) {
+        fprintf(stderr, RED "==> 读取文件失败: %s\n" RESET, filename);
+        free(content);
+        fclose(file);
+        return NULL;
+    }
+
+    content[length] = '\0';
+    fclose(file);
+    TRACE_PROBE2(read_file_done, filename, length);
+    trace_end("read_file", trace_start_time, filename);
+
+    DEBUG_PRINT("文件读取成功，大小: %ld 字节\n", length);
+    if (size) *size = (size_t) length;
+    return content;
+}
+
+char *read_file(const char *filename) {
+    return read_file_sized(filename, NULL);
+}
+
+int get_absolute_path(const char *path, char *abs_path) {
+    DEBUG_PRINT("获取绝对路径: %s\n", path);
+    if (!GET_ABS_PATH(path, abs_path)) {
+        fprintf(stderr, RED "==> 无法获取绝对路径: %s\n" RESET, path);
+        return 0;
+    }
+    return 1;
+}
+
+int create_directories(const char *path) {
+    char buffer[1024];
+    snprintf(buffer, sizeof(buffer), "%s", path);
+    for (char *p = buffer + 1; *p; p++) {
+        if (*p != PATH_SEPARATOR || p[-1] == ':') continue; // 跳过 Windows 盘符
+        *p = '\0';
+        if (MKDIR(buffer) != 0 && errno != EEXIST) {
+            return 0;
+        }
+        *p = PATH_SEPARATOR;
+    }
+    return MKDIR(buffer) == 0 || errno == EEXIST;
+}
+
+int has_extension(const char *name, const char *extension) {
+    const char *dot = strrchr(name, '.');
+    return dot && STRCASECMP(dot, extension) == 0;
+}
+
+int get_file_info(const char *path, uint64_t *size, int64_t *mtime) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path, &st) != 0) return 0;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+#endif
+    if (size) *size = (uint64_t) st.st_size;
+    if (mtime) *mtime = (int64_t) st.st_mtime;
+    return 1;
+}
+
+#ifndef _WIN32
+int dirent_is_directory(const char *dir, const struct dirent *entry) {
+    if (entry->d_type != DT_UNKNOWN) {
+        return entry->d_type == DT_DIR;
+    }
+    const size_t length = strlen(dir) + strlen(entry->d_name) + 2;
+    char *path = malloc(length);
+    if (!path) return 0;
+    snprintf(path, length, "%s%c%s", dir, PATH_SEPARATOR, entry->d_name);
+    struct stat st;
+    const int is_dir = lstat(path, &st) == 0 && S_ISDIR(st.st_mode);
+    free(path);
+    return is_dir;
+}
+#endif
+
+void atomic_temp_path(const char *path, char *temp_path, const size_t temp_size) {
+    // 进程号区分同时写入同一目录的多个进程
+    snprintf(temp_path, temp_size, "%s.%d.tmp", path, (int) GETPID());
+}
+
+FILE *atomic_file_open(const char *path, char *temp_path, const size_t temp_size) {
+    atomic_temp_path(path, temp_path, temp_size);
+    FILE *file = fopen(temp_path, "w");
+    if (!file) {
+        LOG_ERROR(RED "==> 无法创建文件: %s\n" RESET, temp_path);
+    }
+    return file;
+}
+
+int atomic_file_commit(FILE *file, const char *temp_path, const char *path, const int sync) {
+    int ok = fflush(file) == 0 && !ferror(file);
+    if (ok && sync) {
+        ok = FSYNC(FILENO(file)) == 0;
+    }
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    if (!ok || !REPLACE_FILE(temp_path, path)) {
+        LOG_ERROR(RED "==> 写入文件失败: %s\n" RESET, path);
+        REMOVE_FILE(temp_path);
+        return 0;
+    }
+    return 1;
+}
+
+static int sync_path(const char *path) {
+#ifdef _WIN32
+    const int fd = _open(path, _O_RDWR);
+    if (fd < 0) return 0;
+    const int ok = _commit(fd) == 0;
+    _close(fd);
+#else
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    const int ok = fsync(fd) == 0;
+    close(fd);
+#endif
+    return ok;
+}
+
+int sync_files(const char *const *paths, const int count) {
+    if (count <= 0) return 1;
+#ifdef __linux__
+    // 一次 syncfs 覆盖同一文件系统上的所有文件，代替逐个 fsync
+    const int fd = open(paths[0], O_RDONLY);
+    if (fd >= 0) {
+        const int ok = syncfs(fd) == 0;
+        close(fd);
+        if (ok) return 1;
+    }
+#endif
+    int ok = 1;
+    for (int i = 0; i < count; i++) {
+        if (!sync_path(paths[i])) ok = 0;
+    }
+    return ok;
+}
+
+int sync_directory(const char *path) {
+#ifdef _WIN32
+    (void) path;
+    return 1;
+#elif defined(__linux__)
+    return sync_files(&path, 1);
+#else
+    return sync_path(path);
+#endif
+}
+
+int sync_parent_directories(const char *const *paths, const int count, const char *root) {
+#if defined(_WIN32) || defined(__linux__)
+    (void) paths;
+    (void) count;
+    (void) root;
+    return 1;
+#else
+    char **synced = NULL;
+    int synced_count = 0;
+    int synced_capacity = 0;
+    int ok = 1;
+    const size_t root_length = strlen(root);
+    for (int i = 0; i < count && ok; i++) {
+        char dir[1024];
+        snprintf(dir, sizeof(dir), "%s", paths[i]);
+        // 从所在目录向上逐级同步（新建的目录在上级中的目录项同样需要落盘），遇到已同步的目录时停止
+        char *separator;
+        while ((separator = strrchr(dir, PATH_SEPARATOR)) != NULL && (size_t) (separator - dir) >= root_length) {
+            *separator = '\0';
+            int seen = 0;
+            for (int j = 0; j < synced_count && !seen; j++) {
+                seen = strcmp(synced[j], dir) == 0;
+            }
+            if (seen) break;
+            if (synced_count == synced_capacity) {
+                const int capacity = synced_capacity ? synced_capacity * 2 : 16;
+                char **grown = realloc(synced, (size_t) capacity * sizeof(char *));
+                if (!grown) {
+                    ok = 0;
+                    break;
+                }
+                synced = grown;
+                synced_capacity = capacity;
+            }
+            if (!(synced[synced_count] = strdup(dir))) {
+                ok = 0;
+                break;
+            }
+            synced_count++;
+            if (!sync_path(dir)) ok = 0;
+        }
+    }
+    for (int i = 0; i < synced_count; i++) {
+        free(synced[i]);
+    }
+    free(synced);
+    return ok;
+#endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "cross_platform.h"
+#include <stdint.h>
+
+// 各转换器共用的文件与路径工具
+
+// 读取文件内容，size 不为 NULL 时返回文件大小
+char *read_file_sized(const char *filename, size_t *size);
+char *read_file(const char *filename);
+// 获取绝对路径，abs_path 至少 1024 字节
+int get_absolute_path(const char *path, char *abs_path);
+// 逐级创建目录
+int create_directories(const char *path);
+// 判断文件名的扩展名（忽略大小写）
+int has_extension(const char *name, const char *extension);
+// 获取文件大小和修改时间（秒），文件不存在时返回 0
+int get_file_info(const char *path, uint64_t *size, int64_t *mtime);
+#ifndef _WIN32
+// readdir 得到的条目是否为目录；文件系统不提供 d_type 时用 lstat 判断，符号链接不算目录
+int dirent_is_directory(const char *dir, const struct dirent *entry);
+#endif
+
+// 原子写入：在 path 同目录下创建临时文件，写完后由 atomic_file_commit 重命名到 path，
+// 中途崩溃或磁盘写满时 path 保持原样，不会留下写了一半的文件
+FILE *atomic_file_open(const char *path, char *temp_path, size_t temp_size);
+// 关闭临时文件，sync 为 1 时先刷到磁盘，再覆盖 path；失败时删除临时文件
+int atomic_file_commit(FILE *file, const char *temp_path, const char *path, int sync);
+// 生成 path 对应的临时文件名
+void atomic_temp_path(const char *path, char *temp_path, size_t temp_size);
+
+// 批量落盘：Linux 上对所在文件系统执行一次 syncfs，其他平台逐个 fsync
+int sync_files(const char *const *paths, int count);
+// 让目录中的重命名落盘；Windows 上为空操作
+int sync_directory(const char *path);
+// 让 paths 中各文件重命名产生的目录项落盘：同步所在目录及其上级直到 root，每个目录只同步一次。
+// 只在非 Linux 的 POSIX 上执行；Linux 上由之后的 sync_files（syncfs）或 sync_directory 一并落盘，Windows 上为空操作
+int sync_parent_directories(const char *const *paths, int count, const char *root);
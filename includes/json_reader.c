@@ -0,0 +1,359 @@
+#include "json_reader.h"
+
+enum {
+    STATE_VALUE, // 期望一个值
+    STATE_VALUE_OR_END, // '[' 之后
+    STATE_KEY, // ',' 之后的对象键
+    STATE_KEY_OR_END, // '{' 之后
+    STATE_COLON,
+    STATE_COMMA_OR_END,
+    STATE_DONE, // 顶层值已读取完毕
+};
+
+static size_t read_file_block(void *ctx, char *buf, const size_t size) {
+    return fread(buf, 1, size, ctx);
+}
+
+int json_reader_init(json_reader *r, const json_read_fn read, void *ctx, size_t block_size) {
+    memset(r, 0, sizeof(json_reader));
+    if (block_size == 0) block_size = JSON_READER_BLOCK_SIZE;
+    r->buf = malloc(block_size);
+    if (!r->buf) {
+        r->error = "内存分配失败";
+        return 0;
+    }
+    r->read = read;
+    r->ctx = ctx;
+    r->buf_size = block_size;
+    r->owns_buf = 1;
+    return 1;
+}
+
+int json_reader_init_mem(json_reader *r, const char *data, const size_t len) {
+    memset(r, 0, sizeof(json_reader));
+    r->buf = (char *) data;
+    r->buf_size = len;
+    r->len = len;
+    r->eof = 1;
+    return 1;
+}
+
+int json_reader_init_file(json_reader *r, FILE *file) {
+    return json_reader_init(r, read_file_block, file, JSON_READER_BLOCK_SIZE);
+}
+
+void json_reader_free(json_reader *r) {
+    if (r->owns_buf) free(r->buf);
+    free(r->str);
+    r->buf = NULL;
+    r->str = NULL;
+}
+
+int json_reader_depth(const json_reader *r) {
+    return r->depth;
+}
+
+// 确保缓冲区中至少有一个未处理的字节，输入结束时返回 0
+static int fill(json_reader *r) {
+    if (r->pos < r->len) return 1;
+    if (r->eof) return 0;
+    r->consumed += r->len;
+    r->pos = 0;
+    r->len = r->read(r->ctx, r->buf, r->buf_size);
+    if (r->len == 0) {
+        r->eof = 1;
+        return 0;
+    }
+    return 1;
+}
+
+static json_token_type fail(json_reader *r, const char *error) {
+    if (!r->error) r->error = error;
+    return JSON_TOKEN_ERROR;
+}
+
+static int skip_whitespace(json_reader *r) {
+    while (fill(r)) {
+        const char c = r->buf[r->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') return 1;
+        r->pos++;
+    }
+    return 0;
+}
+
+static int append_str(json_reader *r, const char *data, const size_t n) {
+    if (r->str_len + n > JSON_READER_MAX_STRING) {
+        r->error = "字符串过长";
+        return 0;
+    }
+    if (r->str_len + n + 1 > r->str_cap) {
+        size_t cap = r->str_cap ? r->str_cap : 64;
+        while (cap < r->str_len + n + 1) cap *= 2;
+        char *str = realloc(r->str, cap);
+        if (!str) return 0;
+        r->str = str;
+        r->str_cap = cap;
+    }
+    memcpy(r->str + r->str_len, data, n);
+    r->str_len += n;
+    r->str[r->str_len] = '\0';
+    return 1;
+}
+
+static int read_hex4(json_reader *r, unsigned int *value) {
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        if (!fill(r)) return 0;
+        const char c = r->buf[r->pos++];
+        *value <<= 4;
+        if (c >= '0' && c <= '9') *value |= c - '0';
+        else if (c >= 'a' && c <= 'f') *value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') *value |= c - 'A' + 10;
+        else return 0;
+    }
+    return 1;
+}
+
+// 读取字符串（起始引号已跳过），结果写入 r->str
+static int read_string(json_reader *r) {
+    r->str_len = 0;
+    if (!append_str(r, "", 0)) return 0;
+
+    while (1) {
+        if (!fill(r)) {
+            r->error = "字符串未结束";
+            return 0;
+        }
+        // 批量复制不需要转义的字符
+        const size_t start = r->pos;
+        while (r->pos < r->len && r->buf[r->pos] != '"' && r->buf[r->pos] != '\\' &&
+               (unsigned char) r->buf[r->pos] >= 0x20) {
+            r->pos++;
+        }
+        if (!append_str(r, r->buf + start, r->pos - start)) {
+            if (!r->error) r->error = "内存分配失败";
+            return 0;
+        }
+        if (r->pos == r->len) continue;
+
+        const char c = r->buf[r->pos++];
+        if (c == '"') return 1;
+        if (c != '\\') {
+            r->error = "字符串中包含控制字符";
+            return 0;
+        }
+
+        if (!fill(r)) {
+            r->error = "字符串未结束";
+            return 0;
+        }
+        const char escape = r->buf[r->pos++];
+        char out = 0;
+        switch (escape) {
+            case '"': out = '"'; break;
+            case '\\': out = '\\'; break;
+            case '/': out = '/'; break;
+            case 'b': out = '\b'; break;
+            case 'f': out = '\f'; break;
+            case 'n': out = '\n'; break;
+            case 'r': out = '\r'; break;
+            case 't': out = '\t'; break;
+            case 'u': {
+                unsigned int code;
+                if (!read_hex4(r, &code)) {
+                    r->error = "无效的 \\u 转义";
+                    return 0;
+                }
+                // 代理对
+                if (code >= 0xd800 && code <= 0xdbff) {
+                    unsigned int low;
+                    if (!fill(r) || r->buf[r->pos++] != '\\' || !fill(r) || r->buf[r->pos++] != 'u' ||
+                        !read_hex4(r, &low) || low < 0xdc00 || low > 0xdfff) {
+                        r->error = "无效的 UTF-16 代理对";
+                        return 0;
+                    }
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                char utf8[4];
+                size_t n;
+                if (code < 0x80) {
+                    utf8[0] = (char) code;
+                    n = 1;
+                } else if (code < 0x800) {
+                    utf8[0] = (char) (0xc0 | code >> 6);
+                    utf8[1] = (char) (0x80 | (code & 0x3f));
+                    n = 2;
+                } else if (code < 0x10000) {
+                    utf8[0] = (char) (0xe0 | code >> 12);
+                    utf8[1] = (char) (0x80 | (code >> 6 & 0x3f));
+                    utf8[2] = (char) (0x80 | (code & 0x3f));
+                    n = 3;
+                } else {
+                    utf8[0] = (char) (0xf0 | code >> 18);
+                    utf8[1] = (char) (0x80 | (code >> 12 & 0x3f));
+                    utf8[2] = (char) (0x80 | (code >> 6 & 0x3f));
+                    utf8[3] = (char) (0x80 | (code & 0x3f));
+                    n = 4;
+                }
+                if (!append_str(r, utf8, n)) {
+                    if (!r->error) r->error = "内存分配失败";
+                    return 0;
+                }
+                continue;
+            }
+            default:
+                r->error = "无效的转义字符";
+                return 0;
+        }
+        if (!append_str(r, &out, 1)) {
+            if (!r->error) r->error = "内存分配失败";
+            return 0;
+        }
+    }
+}
+
+static int read_number(json_reader *r) {
+    char number[64];
+    size_t n = 0;
+    while (fill(r)) {
+        const char c = r->buf[r->pos];
+        if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) break;
+        if (n + 1 >= sizeof(number)) {
+            r->error = "数字过长";
+            return 0;
+        }
+        number[n++] = c;
+        r->pos++;
+    }
+    number[n] = '\0';
+
+    char *end;
+    r->number = strtod(number, &end);
+    if (n == 0 || *end != '\0') {
+        r->error = "无效的数字";
+        return 0;
+    }
+    return 1;
+}
+
+static int read_literal(json_reader *r, const char *literal) {
+    for (const char *p = literal; *p; p++) {
+        if (!fill(r) || r->buf[r->pos] != *p) {
+            r->error = "无效的字面量";
+            return 0;
+        }
+        r->pos++;
+    }
+    return 1;
+}
+
+// 标量值读取完毕后的状态
+static void after_value(json_reader *r) {
+    r->state = r->depth > 0 ? STATE_COMMA_OR_END : STATE_DONE;
+}
+
+static json_token_type read_value(json_reader *r) {
+    const char c = r->buf[r->pos];
+    switch (c) {
+        case '{':
+        case '[':
+            if (r->depth >= JSON_READER_MAX_DEPTH) {
+                return fail(r, "嵌套层数过深");
+            }
+            r->pos++;
+            r->stack[r->depth++] = (unsigned char) c;
+            r->state = c == '{' ? STATE_KEY_OR_END : STATE_VALUE_OR_END;
+            return c == '{' ? JSON_TOKEN_OBJECT_START : JSON_TOKEN_ARRAY_START;
+        case '"':
+            r->pos++;
+            if (!read_string(r)) return JSON_TOKEN_ERROR;
+            after_value(r);
+            return JSON_TOKEN_STRING;
+        case 't':
+            if (!read_literal(r, "true")) return JSON_TOKEN_ERROR;
+            after_value(r);
+            return JSON_TOKEN_TRUE;
+        case 'f':
+            if (!read_literal(r, "false")) return JSON_TOKEN_ERROR;
+            after_value(r);
+            return JSON_TOKEN_FALSE;
+        case 'n':
+            if (!read_literal(r, "null")) return JSON_TOKEN_ERROR;
+            after_value(r);
+            return JSON_TOKEN_NULL;
+        default:
+            if (c != '-' && (c < '0' || c > '9')) {
+                return fail(r, "意外的字符");
+            }
+            if (!read_number(r)) return JSON_TOKEN_ERROR;
+            after_value(r);
+            return JSON_TOKEN_NUMBER;
+    }
+}
+
+static json_token_type close_container(json_reader *r, const char c) {
+    const unsigned char open = c == '}' ? '{' : '[';
+    if (r->depth == 0 || r->stack[r->depth - 1] != open) {
+        return fail(r, "括号不匹配");
+    }
+    r->pos++;
+    r->depth--;
+    after_value(r);
+    return c == '}' ? JSON_TOKEN_OBJECT_END : JSON_TOKEN_ARRAY_END;
+}
+
+json_token_type json_reader_next(json_reader *r) {
+    if (r->error) return JSON_TOKEN_ERROR;
+
+    while (1) {
+        if (!skip_whitespace(r)) {
+            if (r->state == STATE_DONE) return JSON_TOKEN_END;
+            return fail(r, "输入意外结束");
+        }
+        const char c = r->buf[r->pos];
+
+        switch (r->state) {
+            case STATE_VALUE:
+                return read_value(r);
+            case STATE_VALUE_OR_END:
+                if (c == ']') return close_container(r, c);
+                return read_value(r);
+            case STATE_KEY_OR_END:
+                if (c == '}') return close_container(r, c);
+            // fallthrough
+            case STATE_KEY:
+                if (c != '"') return fail(r, "期望对象键");
+                r->pos++;
+                if (!read_string(r)) return JSON_TOKEN_ERROR;
+                r->state = STATE_COLON;
+                return JSON_TOKEN_KEY;
+            case STATE_COLON:
+                if (c != ':') return fail(r, "期望 ':'");
+                r->pos++;
+                r->state = STATE_VALUE;
+                continue;
+            case STATE_COMMA_OR_END:
+                if (c == '}' || c == ']') return close_container(r, c);
+                if (c != ',') return fail(r, "期望 ',' 或结束括号");
+                r->pos++;
+                r->state = r->stack[r->depth - 1] == '{' ? STATE_KEY : STATE_VALUE;
+                continue;
+            default:
+                return fail(r, "顶层值之后存在多余数据");
+        }
+    }
+}
+
+int json_reader_skip(json_reader *r, const json_token_type token) {
+    if (token == JSON_TOKEN_ERROR) return 0;
+    if (token != JSON_TOKEN_OBJECT_START && token != JSON_TOKEN_ARRAY_START) return 1;
+
+    const int depth = r->depth - 1;
+    while (r->depth > depth) {
+        if (json_reader_next(r) <= JSON_TOKEN_END) {
+            fail(r, "输入意外结束");
+            return 0;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "cross_platform.h"
+
+// 流式 JSON 词法读取器：按块读取输入，逐个返回 token，不构建 DOM
+
+// 最大嵌套深度，超过后报错
+#define JSON_READER_MAX_DEPTH 256
+// 默认读取块大小
+#define JSON_READER_BLOCK_SIZE (64 * 1024)
+// 单个字符串（键或值）的最大长度：按块读取时内存只取决于块大小和解码出的数据，不随输入增长
+#define JSON_READER_MAX_STRING (1024 * 1024)
+
+typedef enum {
+    JSON_TOKEN_ERROR = -1,
+    JSON_TOKEN_END = 0, // 输入结束
+    JSON_TOKEN_OBJECT_START,
+    JSON_TOKEN_OBJECT_END,
+    JSON_TOKEN_ARRAY_START,
+    JSON_TOKEN_ARRAY_END,
+    JSON_TOKEN_KEY,
+    JSON_TOKEN_STRING,
+    JSON_TOKEN_NUMBER,
+    JSON_TOKEN_TRUE,
+    JSON_TOKEN_FALSE,
+    JSON_TOKEN_NULL,
+} json_token_type;
+
+// 数据源读取函数，返回读取的字节数，0 表示结束
+typedef size_t (*json_read_fn)(void *ctx, char *buf, size_t size);
+
+typedef struct {
+    json_read_fn read;
+    void *ctx;
+    char *buf;
+    size_t buf_size;
+    size_t pos;
+    size_t len;
+    size_t consumed; // 已处理的字节数，用于错误定位
+    int eof;
+    int owns_buf;
+
+    char *str; // 当前 KEY/STRING 的值（已反转义，以 '\0' 结尾）
+    size_t str_len;
+    size_t str_cap;
+    double number; // 当前 NUMBER 的值
+
+    int state;
+    int depth;
+    unsigned char stack[JSON_READER_MAX_DEPTH];
+    const char *error;
+} json_reader;
+
+// 从数据源按块读取
+int json_reader_init(json_reader *r, json_read_fn read, void *ctx, size_t block_size);
+// 直接读取内存中的数据，不复制
+int json_reader_init_mem(json_reader *r, const char *data, size_t len);
+// 从已打开的文件按块读取
+int json_reader_init_file(json_reader *r, FILE *file);
+void json_reader_free(json_reader *r);
+
+json_token_type json_reader_next(json_reader *r);
+// 跳过一个完整的值；token 为已读取的值的首个 token
+int json_reader_skip(json_reader *r, json_token_type token);
+// 当前容器嵌套深度
+int json_reader_depth(const json_reader *r);
@@ -0,0 +1,222 @@
+#include "json_writer.h"
+
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+
+static int flush_to_sink(json_writer *w) {
+    if (w->len > 0 && !w->sink(w->sink_user, w->buf, w->len)) {
+        w->failed = 1;
+        return 0;
+    }
+    w->len = 0;
+    return 1;
+}
+
+static int reserve(json_writer *w, const size_t extra) {
+    if (w->failed) return 0;
+    if (w->len + extra + 1 <= w->cap) return 1;
+    // 流式输出时先交出已有内容，只有单次写入超过缓冲区时才扩容
+    if (w->sink && (!flush_to_sink(w) || w->len + extra + 1 <= w->cap)) return !w->failed;
+    size_t cap = w->cap ? w->cap : 256;
+    while (w->len + extra + 1 > cap) {
+        cap *= 2;
+    }
+    char *buf = realloc(w->buf, cap);
+    if (!buf) {
+        LOG_ERROR(RED "==> 内存分配失败\n" RESET);
+        w->failed = 1;
+        return 0;
+    }
+    w->buf = buf;
+    w->cap = cap;
+    return 1;
+}
+
+static void append(json_writer *w, const char *data, const size_t len) {
+    if (!reserve(w, len)) return;
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+static void append_char(json_writer *w, const char c) {
+    if (!reserve(w, 1)) return;
+    w->buf[w->len++] = c;
+}
+
+static void indent(json_writer *w, const int depth) {
+    if (!reserve(w, (size_t) depth)) return;
+    memset(w->buf + w->len, '\t', (size_t) depth);
+    w->len += (size_t) depth;
+}
+
+static int in_array(const json_writer *w) {
+    return w->depth > 0 && (w->array_bits >> (w->depth - 1) & 1u);
+}
+
+// 写入值之前的分隔符：对象中的值由 json_writer_key 处理，数组元素之间为 ", "
+static void before_value(json_writer *w) {
+    if (w->after_key) {
+        w->after_key = 0;
+        return;
+    }
+    if (in_array(w) && w->need_comma) {
+        append(w, w->formatted ? ", " : ",", w->formatted ? 2 : 1);
+    }
+}
+
+static void begin_container(json_writer *w, const char open, const int is_array) {
+    before_value(w);
+    if (w->depth >= JSON_WRITER_MAX_DEPTH) {
+        LOG_ERROR(RED "==> JSON 嵌套过深\n" RESET);
+        w->failed = 1;
+        return;
+    }
+    append_char(w, open);
+    if (is_array) {
+        w->array_bits |= 1ull << w->depth;
+    } else {
+        w->array_bits &= ~(1ull << w->depth);
+        if (w->formatted) append_char(w, '\n');
+    }
+    w->depth++;
+    w->need_comma = 0;
+}
+
+int json_writer_init(json_writer *w, const size_t initial_capacity, const int formatted) {
+    memset(w, 0, sizeof(json_writer));
+    w->formatted = formatted;
+    return reserve(w, initial_capacity);
+}
+
+char *json_writer_finish(json_writer *w, size_t *length) {
+    if (w->failed || !reserve(w, 0)) {
+        json_writer_free(w);
+        return NULL;
+    }
+    w->buf[w->len] = '\0';
+    if (length) *length = w->len;
+    char *result = w->buf;
+    w->buf = NULL;
+    w->len = w->cap = 0;
+    return result;
+}
+
+void json_writer_free(json_writer *w) {
+    free(w->buf);
+    w->buf = NULL;
+    w->len = w->cap = 0;
+}
+
+void json_writer_set_sink(json_writer *w, const json_writer_sink sink, void *user) {
+    w->sink = sink;
+    w->sink_user = user;
+}
+
+int json_writer_flush(json_writer *w) {
+    if (w->failed) return 0;
+    return w->sink ? flush_to_sink(w) : 1;
+}
+
+void json_writer_begin_object(json_writer *w) {
+    begin_container(w, '{', 0);
+}
+
+void json_writer_end_object(json_writer *w) {
+    if (w->formatted) {
+        if (w->need_comma) append_char(w, '\n');
+        indent(w, w->depth - 1);
+    }
+    append_char(w, '}');
+    w->depth--;
+    w->need_comma = 1;
+}
+
+void json_writer_begin_array(json_writer *w) {
+    begin_container(w, '[', 1);
+}
+
+void json_writer_end_array(json_writer *w) {
+    append_char(w, ']');
+    w->depth--;
+    w->need_comma = 1;
+}
+
+void json_writer_key(json_writer *w, const char *key) {
+    if (w->need_comma) {
+        append(w, w->formatted ? ",\n" : ",", w->formatted ? 2 : 1);
+    }
+    if (w->formatted) indent(w, w->depth);
+    append_char(w, '"');
+    append(w, key, strlen(key));
+    append(w, w->formatted ? "\":\t" : "\":", w->formatted ? 3 : 2);
+    w->after_key = 1;
+}
+
+// 与 cJSON 的数值输出一致：整数直接输出，否则优先 15 位有效数字，无法精确还原时用 17 位
+void json_writer_number(json_writer *w, const double value) {
+    before_value(w);
+    char number[32];
+    int length;
+    const int as_int = value >= INT_MAX ? INT_MAX : value <= (double) INT_MIN ? INT_MIN : (int) value;
+    if (isnan(value) || isinf(value)) {
+        length = snprintf(number, sizeof(number), "null");
+    } else if (value == (double) as_int) {
+        length = snprintf(number, sizeof(number), "%d", as_int);
+    } else {
+        length = snprintf(number, sizeof(number), "%1.15g", value);
+        const double test = strtod(number, NULL);
+        const double max = fabs(test) > fabs(value) ? fabs(test) : fabs(value);
+        if (fabs(test - value) > max * DBL_EPSILON) {
+            length = snprintf(number, sizeof(number), "%1.17g", value);
+        }
+    }
+    append(w, number, (size_t) length);
+    w->need_comma = 1;
+}
+
+void json_writer_bool(json_writer *w, const int value) {
+    before_value(w);
+    append(w, value ? "true" : "false", value ? 4 : 5);
+    w->need_comma = 1;
+}
+
+void json_writer_null(json_writer *w) {
+    before_value(w);
+    append(w, "null", 4);
+    w->need_comma = 1;
+}
+
+// 与 cJSON 的字符串输出一致：引号、反斜杠和控制字符转义，其余字节（包括 UTF-8）原样输出
+void json_writer_string(json_writer *w, const char *value) {
+    before_value(w);
+    append_char(w, '"');
+    const char *run = value;
+    for (const char *p = value; *p; p++) {
+        const unsigned char c = (unsigned char) *p;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        append(w, run, (size_t) (p - run));
+        run = p + 1;
+        char escaped[8];
+        switch (c) {
+            case '"': append(w, "\\\"", 2); break;
+            case '\\': append(w, "\\\\", 2); break;
+            case '\b': append(w, "\\b", 2); break;
+            case '\f': append(w, "\\f", 2); break;
+            case '\n': append(w, "\\n", 2); break;
+            case '\r': append(w, "\\r", 2); break;
+            case '\t': append(w, "\\t", 2); break;
+            default:
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                append(w, escaped, 6);
+                break;
+        }
+    }
+    append(w, run, strlen(run));
+    append_char(w, '"');
+    w->need_comma = 1;
+}
+
+void json_writer_raw(json_writer *w, const char *data, const size_t len) {
+    append(w, data, len);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "cross_platform.h"
+
+// 追加式 JSON 写入器：直接输出到可增长的缓冲区，格式与 cJSON_Print / cJSON_PrintUnformatted 一致
+
+// 最大嵌套深度
+#define JSON_WRITER_MAX_DEPTH 64
+// 设置了输出回调时缓冲区的大小，写满后交给回调
+#define JSON_WRITER_FLUSH_SIZE (64 * 1024)
+
+// 输出回调：按顺序接收写入的文本，失败时返回 0
+typedef int (*json_writer_sink)(void *user, const char *data, size_t len);
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+    int formatted;
+    int depth;
+    int need_comma; // 当前容器中已有元素
+    int after_key; // 刚写入键，下一个值直接跟在键后
+    unsigned long long array_bits; // 按深度记录容器是否为数组
+    int failed;
+    json_writer_sink sink; // 为 NULL 时全部内容留在 buf 中
+    void *sink_user;
+} json_writer;
+
+int json_writer_init(json_writer *w, size_t initial_capacity, int formatted);
+// 返回以 '\0' 结尾的结果，所有权转移给调用者；写入过程中出错时返回 NULL
+char *json_writer_finish(json_writer *w, size_t *length);
+void json_writer_free(json_writer *w);
+// 流式输出：之后缓冲区写满时把内容交给 sink 并清空，缓冲区不再增长。
+// 结束时用 json_writer_flush 交出剩余内容，不调用 json_writer_finish
+void json_writer_set_sink(json_writer *w, json_writer_sink sink, void *user);
+// 把缓冲区中的内容交给 sink，全部写入成功返回 1
+int json_writer_flush(json_writer *w);
+
+void json_writer_begin_object(json_writer *w);
+void json_writer_end_object(json_writer *w);
+void json_writer_begin_array(json_writer *w);
+void json_writer_end_array(json_writer *w);
+// 键名只能是不需要转义的 ASCII 字符串
+void json_writer_key(json_writer *w, const char *key);
+void json_writer_number(json_writer *w, double value);
+void json_writer_bool(json_writer *w, int value);
+void json_writer_null(json_writer *w);
+void json_writer_string(json_writer *w, const char *value);
+// 原样追加已经生成好的片段，不改变写入器的嵌套状态
+void json_writer_raw(json_writer *w, const char *data, size_t len);
+
@@ -0,0 +1,220 @@
+#include "metrics.h"
+#include "file_utils.h"
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+// 直方图各桶的上界（秒）
+static const double bucket_bounds[METRICS_BUCKET_COUNT] = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 1.0
+};
+
+static const char *failure_names[METRICS_FAIL_COUNT] = {
+    "read", "zip_open", "zip_extract", "json_parse", "missing_time", "out_of_memory",
+    "serialize", "mkdir", "write", "timeout", "budget", "crash"
+};
+
+// 输出时使用的计数器副本
+typedef struct {
+    unsigned long long converted[METRICS_FORMAT_COUNT];
+    unsigned long long failures[METRICS_FAIL_COUNT];
+    unsigned long long skipped;
+    unsigned long long bytes_in;
+    unsigned long long bytes_out;
+    metrics_histogram stages[METRICS_STAGE_MAX];
+} metrics_snapshot;
+
+double monotonic_seconds(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+#endif
+}
+
+void metrics_init(metrics *m, const char *path, const double interval, const char *const *stage_names,
+                  const int stage_count) {
+    memset(m, 0, sizeof(metrics));
+    m->path = path;
+    m->interval = interval > 0 ? interval : 10.0;
+    m->last_write = monotonic_seconds();
+    m->stage_names = stage_names;
+    m->stage_count = stage_count < METRICS_STAGE_MAX ? stage_count : METRICS_STAGE_MAX;
+    MUTEX_INIT(&m->mutex);
+    MUTEX_INIT(&m->write_mutex);
+    COND_INIT(&m->timer_cond);
+}
+
+void metrics_destroy(metrics *m) {
+    COND_DESTROY(&m->timer_cond);
+    MUTEX_DESTROY(&m->write_mutex);
+    MUTEX_DESTROY(&m->mutex);
+}
+
+void metrics_converted(metrics *m, const chart_format format) {
+    MUTEX_LOCK(&m->mutex);
+    m->converted[format < METRICS_FORMAT_COUNT ? format : CHART_FORMAT_UNKNOWN]++;
+    MUTEX_UNLOCK(&m->mutex);
+}
+
+void metrics_failed(metrics *m, const metrics_failure reason) {
+    MUTEX_LOCK(&m->mutex);
+    m->failures[reason]++;
+    MUTEX_UNLOCK(&m->mutex);
+}
+
+void metrics_skipped(metrics *m) {
+    MUTEX_LOCK(&m->mutex);
+    m->skipped++;
+    MUTEX_UNLOCK(&m->mutex);
+}
+
+void metrics_bytes(metrics *m, const unsigned long long bytes_in, const unsigned long long bytes_out) {
+    MUTEX_LOCK(&m->mutex);
+    m->bytes_in += bytes_in;
+    m->bytes_out += bytes_out;
+    MUTEX_UNLOCK(&m->mutex);
+}
+
+void metrics_observe(metrics *m, const int stage, const double seconds, const int count) {
+    if (stage < 0 || stage >= m->stage_count || count <= 0) return;
+    int bucket = 0;
+    while (bucket < METRICS_BUCKET_COUNT && seconds > bucket_bounds[bucket]) {
+        bucket++;
+    }
+    MUTEX_LOCK(&m->mutex);
+    metrics_histogram *histogram = &m->stages[stage];
+    histogram->buckets[bucket] += (unsigned long long) count;
+    histogram->count += (unsigned long long) count;
+    histogram->sum += seconds * count;
+    MUTEX_UNLOCK(&m->mutex);
+}
+
+static void write_counter_header(FILE *file, const char *name, const char *help) {
+    fprintf(file, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+}
+
+static int write_textfile(const metrics *m, const metrics_snapshot *snapshot) {
+    char temp_path[1100];
+    FILE *file = atomic_file_open(m->path, temp_path, sizeof(temp_path));
+    if (!file) {
+        return 0;
+    }
+
+    write_counter_header(file, "blophy_charts_converted_total", "成功转换的谱面数");
+    for (int i = CHART_FORMAT_MCZ; i < METRICS_FORMAT_COUNT; i++) {
+        fprintf(file, "blophy_charts_converted_total{format=\"%s\"} %llu\n", chart_format_name(i),
+                snapshot->converted[i]);
+    }
+    write_counter_header(file, "blophy_charts_failed_total", "转换失败的谱面数");
+    for (int i = 0; i < METRICS_FAIL_COUNT; i++) {
+        fprintf(file, "blophy_charts_failed_total{reason=\"%s\"} %llu\n", failure_names[i], snapshot->failures[i]);
+    }
+    write_counter_header(file, "blophy_files_skipped_total", "无法识别格式而跳过的文件数");
+    fprintf(file, "blophy_files_skipped_total %llu\n", snapshot->skipped);
+    write_counter_header(file, "blophy_input_bytes_total", "读取的输入字节数");
+    fprintf(file, "blophy_input_bytes_total %llu\n", snapshot->bytes_in);
+    write_counter_header(file, "blophy_output_bytes_total", "写入的 Chart.json 字节数");
+    fprintf(file, "blophy_output_bytes_total %llu\n", snapshot->bytes_out);
+
+    fprintf(file, "# HELP blophy_stage_duration_seconds 各阶段处理单个任务的耗时\n");
+    fprintf(file, "# TYPE blophy_stage_duration_seconds histogram\n");
+    for (int i = 0; i < m->stage_count; i++) {
+        const metrics_histogram *histogram = &snapshot->stages[i];
+        const char *stage = m->stage_names[i];
+        unsigned long long cumulative = 0;
+        for (int b = 0; b < METRICS_BUCKET_COUNT; b++) {
+            cumulative += histogram->buckets[b];
+            fprintf(file, "blophy_stage_duration_seconds_bucket{stage=\"%s\",le=\"%g\"} %llu\n", stage,
+                    bucket_bounds[b], cumulative);
+        }
+        fprintf(file, "blophy_stage_duration_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n", stage,
+                histogram->count);
+        fprintf(file, "blophy_stage_duration_seconds_sum{stage=\"%s\"} %.9f\n", stage, histogram->sum);
+        fprintf(file, "blophy_stage_duration_seconds_count{stage=\"%s\"} %llu\n", stage, histogram->count);
+    }
+
+    // 指标每次整体覆盖，只需重命名保证原子性，不需要落盘
+    return atomic_file_commit(file, temp_path, m->path, 0);
+}
+
+// 在锁内复制计数器，释放锁后再写文件，写入期间记录指标的线程不会被阻塞；
+// write_mutex 保证各次输出按复制的先后顺序写入
+static int write_snapshot(metrics *m) {
+    MUTEX_LOCK(&m->write_mutex);
+    metrics_snapshot snapshot;
+    MUTEX_LOCK(&m->mutex);
+    memcpy(snapshot.converted, m->converted, sizeof(snapshot.converted));
+    memcpy(snapshot.failures, m->failures, sizeof(snapshot.failures));
+    snapshot.skipped = m->skipped;
+    snapshot.bytes_in = m->bytes_in;
+    snapshot.bytes_out = m->bytes_out;
+    memcpy(snapshot.stages, m->stages, sizeof(snapshot.stages));
+    MUTEX_UNLOCK(&m->mutex);
+    const int ok = write_textfile(m, &snapshot);
+    MUTEX_UNLOCK(&m->write_mutex);
+    return ok;
+}
+
+void metrics_maybe_write(metrics *m) {
+    if (!m->path) return;
+    const double now = monotonic_seconds();
+    MUTEX_LOCK(&m->mutex);
+    const int due = now - m->last_write >= m->interval;
+    if (due) m->last_write = now;
+    MUTEX_UNLOCK(&m->mutex);
+    if (due) write_snapshot(m);
+}
+
+// 等待 seconds 秒或被 metrics_stop_timer 唤醒，调用时持有 m->mutex
+static void timer_wait(metrics *m, const double seconds) {
+#ifdef _WIN32
+    SleepConditionVariableCS(&m->timer_cond, &m->mutex, (DWORD) (seconds * 1000) + 1);
+#else
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    const double end = (double) deadline.tv_sec + (double) deadline.tv_nsec / 1e9 + seconds;
+    deadline.tv_sec = (time_t) end;
+    deadline.tv_nsec = (long) ((end - (double) deadline.tv_sec) * 1e9);
+    pthread_cond_timedwait(&m->timer_cond, &m->mutex, &deadline);
+#endif
+}
+
+void metrics_run_timer(metrics *m) {
+    if (!m->path) return;
+    MUTEX_LOCK(&m->mutex);
+    while (!m->timer_stopping) {
+        // 其他线程通过 metrics_maybe_write 输出后 last_write 会后移，按最近一次输出计算下一次
+        const double elapsed = monotonic_seconds() - m->last_write;
+        if (elapsed < m->interval) {
+            timer_wait(m, m->interval - elapsed);
+            continue;
+        }
+        m->last_write = monotonic_seconds();
+        MUTEX_UNLOCK(&m->mutex);
+        write_snapshot(m);
+        MUTEX_LOCK(&m->mutex);
+    }
+    MUTEX_UNLOCK(&m->mutex);
+}
+
+void metrics_stop_timer(metrics *m) {
+    MUTEX_LOCK(&m->mutex);
+    m->timer_stopping = 1;
+    COND_BROADCAST(&m->timer_cond);
+    MUTEX_UNLOCK(&m->mutex);
+}
+
+int metrics_write(metrics *m) {
+    if (!m->path) return 1;
+    MUTEX_LOCK(&m->mutex);
+    m->last_write = monotonic_seconds();
+    MUTEX_UNLOCK(&m->mutex);
+    return write_snapshot(m);
+}
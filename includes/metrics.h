@@ -0,0 +1,77 @@
+#pragma once
+#include "cross_platform.h"
+#include "chart_format.h"
+
+// 批量转换的运行指标：计数器和各阶段耗时直方图，定期写成 Prometheus textfile，
+// 供 node exporter 的 textfile collector 读取
+
+// 失败原因
+typedef enum {
+    METRICS_FAIL_READ = 0, // 无法读取输入文件
+    METRICS_FAIL_ZIP_OPEN, // 无法打开 .mcz
+    METRICS_FAIL_ZIP_EXTRACT, // 无法解压 .mcz 中的谱面
+    METRICS_FAIL_JSON_PARSE,
+    METRICS_FAIL_MISSING_TIME,
+    METRICS_FAIL_NO_MEMORY,
+    METRICS_FAIL_SERIALIZE,
+    METRICS_FAIL_MKDIR,
+    METRICS_FAIL_WRITE,
+    METRICS_FAIL_TIMEOUT, // 超过单个任务的时间预算
+    METRICS_FAIL_BUDGET, // 超过单个任务的内存预算或压缩包解压上限
+    METRICS_FAIL_CRASH, // 隔离运行的子进程异常退出
+    METRICS_FAIL_COUNT
+} metrics_failure;
+
+// 统计的阶段数上限
+#define METRICS_STAGE_MAX 8
+// 直方图的桶数（不含 +Inf）
+#define METRICS_BUCKET_COUNT 12
+// 成功转换按来源统计：各谱面格式
+#define METRICS_FORMAT_COUNT (CHART_FORMAT_LANOTA + 1)
+
+typedef struct {
+    unsigned long long buckets[METRICS_BUCKET_COUNT + 1]; // 最后一个为 +Inf
+    unsigned long long count;
+    double sum;
+} metrics_histogram;
+
+typedef struct {
+    mutex_t mutex;
+    mutex_t write_mutex; // 串行化文件输出，写文件时不持有 mutex
+    const char *path; // 为 NULL 时只统计不输出
+    double interval; // 输出间隔（秒）
+    double last_write;
+    cond_t timer_cond; // 唤醒 metrics_run_timer 退出
+    int timer_stopping;
+    const char *const *stage_names;
+    int stage_count;
+
+    unsigned long long converted[METRICS_FORMAT_COUNT];
+    unsigned long long failures[METRICS_FAIL_COUNT];
+    unsigned long long skipped;
+    unsigned long long bytes_in;
+    unsigned long long bytes_out;
+    metrics_histogram stages[METRICS_STAGE_MAX];
+} metrics;
+
+// 单调时钟（秒）
+double monotonic_seconds(void);
+
+void metrics_init(metrics *m, const char *path, double interval, const char *const *stage_names, int stage_count);
+void metrics_destroy(metrics *m);
+
+void metrics_converted(metrics *m, chart_format format);
+void metrics_failed(metrics *m, metrics_failure reason);
+void metrics_skipped(metrics *m);
+void metrics_bytes(metrics *m, unsigned long long bytes_in, unsigned long long bytes_out);
+// 记录 count 个任务在某阶段的耗时，每个任务耗时 seconds
+void metrics_observe(metrics *m, int stage, double seconds, int count);
+
+// 距上次输出超过间隔时写入文件
+void metrics_maybe_write(metrics *m);
+// 定时输出：在单独的线程中运行，每隔 interval 写一次文件，流水线卡住时指标同样会刷新；
+// 直到 metrics_stop_timer 后返回
+void metrics_run_timer(metrics *m);
+void metrics_stop_timer(metrics *m);
+// 先写入同目录的临时文件再重命名，collector 不会读到写了一半的文件；成功返回 1
+int metrics_write(metrics *m);
@@ -0,0 +1,92 @@
+#include "schema_decode.h"
+
+static int skip_value(json_reader *r, const json_token_type token) {
+    return json_reader_skip(r, token) ? 0 : -1;
+}
+
+int schema_read_number(json_reader *r, const json_token_type token, double *value) {
+    if (token == JSON_TOKEN_NUMBER) {
+        *value = r->number;
+        return 1;
+    }
+    return skip_value(r, token);
+}
+
+int schema_read_string(json_reader *r, const json_token_type token, char **value) {
+    if (token != JSON_TOKEN_STRING) {
+        return skip_value(r, token);
+    }
+    char *copy = realloc(*value, r->str_len + 1);
+    if (!copy) {
+        LOG_ERROR(RED "==> 内存分配失败\n" RESET);
+        return -1;
+    }
+    memcpy(copy, r->str, r->str_len + 1);
+    *value = copy;
+    return 1;
+}
+
+int schema_read_numbers(json_reader *r, json_token_type token, double *values, const int count) {
+    if (token != JSON_TOKEN_ARRAY_START) {
+        return skip_value(r, token);
+    }
+    int read = 0;
+    while ((token = json_reader_next(r)) != JSON_TOKEN_ARRAY_END) {
+        if (token == JSON_TOKEN_ERROR || token == JSON_TOKEN_END) return -1;
+        if (read < count && token == JSON_TOKEN_NUMBER) {
+            values[read++] = r->number;
+        } else if (!json_reader_skip(r, token)) {
+            return -1;
+        }
+    }
+    return read;
+}
+
+int schema_read_object(json_reader *r, json_token_type token, const schema_key *table, const unsigned mask,
+                       void *ctx, const schema_field_fn field) {
+    if (token != JSON_TOKEN_OBJECT_START) {
+        return skip_value(r, token);
+    }
+    while ((token = json_reader_next(r)) == JSON_TOKEN_KEY) {
+        const int key = schema_key_lookup(table, mask, r->str, r->str_len);
+        token = json_reader_next(r);
+        const int result = key ? field(r, ctx, key, token) : skip_value(r, token);
+        if (result == SCHEMA_STOP) return SCHEMA_STOP;
+        if (result < 0) return -1;
+    }
+    return token == JSON_TOKEN_OBJECT_END ? 1 : -1;
+}
+
+int schema_read_array(json_reader *r, json_token_type token, void *ctx, const schema_item_fn item) {
+    if (token != JSON_TOKEN_ARRAY_START) {
+        return skip_value(r, token);
+    }
+    while ((token = json_reader_next(r)) != JSON_TOKEN_ARRAY_END) {
+        if (token == JSON_TOKEN_ERROR || token == JSON_TOKEN_END) return -1;
+        const int result = item(r, ctx, token);
+        if (result == SCHEMA_STOP) return SCHEMA_STOP;
+        if (result < 0) return -1;
+    }
+    return 1;
+}
+
+int schema_decode_document(json_reader *r, const schema_key *table, const unsigned mask, void *ctx,
+                           const schema_field_fn field) {
+    const json_token_type token = json_reader_next(r);
+    if (token != JSON_TOKEN_OBJECT_START) return 0;
+    const int result = schema_read_object(r, token, table, mask, ctx, field);
+    return result == 1 || result == SCHEMA_STOP;
+}
+
+int schema_array_reserve(void **items, int *capacity, const int count, const size_t item_size) {
+    if (count < *capacity) return 1;
+    const int new_capacity = *capacity ? *capacity * 2 : 16;
+    void *grown = realloc(*items, (size_t) new_capacity * item_size);
+    if (!grown) {
+        LOG_ERROR(RED "==> 内存分配失败\n" RESET);
+        return 0;
+    }
+    *items = grown;
+    *capacity = new_capacity;
+    return 1;
+}
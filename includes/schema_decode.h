@@ -0,0 +1,70 @@
+#pragma once
+#include "cross_platform.h"
+#include "json_reader.h"
+
+// 基于 schema 的谱面解码：用 json_reader 流式读取，已知键经完美哈希直接映射到字段编号，
+// 值写入各格式的结构体，未知键整体跳过，不构建 DOM
+
+// 键名与 cJSON_GetObjectItem 一样不区分 ASCII 大小写，键表中的键名一律写成小写
+#define SCHEMA_FOLD(c) ((c) >= 'A' && (c) <= 'Z' ? (c) - 'A' + 'a' : (c))
+
+// 键的哈希值由长度和（转为小写的）首尾字符组成，各格式的键表在编译期按哈希值放入对应槽位
+#define SCHEMA_KEY_HASH(len, first, last) \
+    ((unsigned) (len) * 31u + (unsigned) SCHEMA_FOLD((unsigned char) (first)) * 7u + \
+     (unsigned) SCHEMA_FOLD((unsigned char) (last)))
+
+// 两个键落在同一槽位时，后一个指定初始化器会覆盖前一个；把这种覆盖作为编译错误，哈希冲突在编译期报告
+#if defined(__clang__)
+#pragma clang diagnostic error "-Winitializer-overrides"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic error "-Woverride-init"
+#endif
+
+// 键表条目，id 为 0 的槽位为空
+typedef struct {
+    const char *name;
+    unsigned char len;
+    int id;
+} schema_key;
+
+// 声明键表条目，first/last 为键的首尾字符
+#define SCHEMA_KEY(mask, name, first, last, id) \
+    [SCHEMA_KEY_HASH(sizeof(name) - 1, first, last) & (mask)] = {name, sizeof(name) - 1, id}
+
+// 查找键对应的字段编号，未知键返回 0；只需一次哈希和一次比较
+static inline int schema_key_lookup(const schema_key *table, const unsigned mask, const char *key, const size_t len) {
+    if (len == 0) return 0;
+    const schema_key *entry = &table[SCHEMA_KEY_HASH(len, key[0], key[len - 1]) & mask];
+    if (entry->len != len) return 0;
+    for (size_t i = 0; i < len; i++) {
+        if (entry->name[i] != SCHEMA_FOLD((unsigned char) key[i])) return 0;
+    }
+    return entry->id;
+}
+
+// 以下读取函数成功返回 1，类型不符时跳过该值并返回 0，语法错误返回 -1
+// 回调返回 SCHEMA_STOP 时不再读取文档的剩余部分，逐层返回 SCHEMA_STOP，schema_decode_document 视为成功
+#define SCHEMA_STOP (-2)
+
+// 读取数值
+int schema_read_number(json_reader *r, json_token_type token, double *value);
+// 读取字符串并复制到 *value（替换原有内容）
+int schema_read_string(json_reader *r, json_token_type token, char **value);
+// 读取数值数组的前 count 个元素，其余元素跳过，返回读取的个数
+int schema_read_numbers(json_reader *r, json_token_type token, double *values, int count);
+
+// 对象字段回调，key 为键表中的字段编号（未知键已被跳过），token 为值的首个 token
+typedef int (*schema_field_fn)(json_reader *r, void *ctx, int key, json_token_type token);
+// 数组元素回调，token 为元素的首个 token
+typedef int (*schema_item_fn)(json_reader *r, void *ctx, json_token_type token);
+
+// 逐个读取对象的已知字段
+int schema_read_object(json_reader *r, json_token_type token, const schema_key *table, unsigned mask, void *ctx,
+                       schema_field_fn field);
+// 逐个读取数组元素
+int schema_read_array(json_reader *r, json_token_type token, void *ctx, schema_item_fn item);
+// 解码整个文档：顶层必须是对象，与 cJSON_Parse 一样不读取顶层值之后的内容，成功返回 1
+int schema_decode_document(json_reader *r, const schema_key *table, unsigned mask, void *ctx, schema_field_fn field);
+
+// 保证结构体数组至少能容纳 count + 1 个条目，失败返回 0
+int schema_array_reserve(void **items, int *capacity, int count, size_t item_size);
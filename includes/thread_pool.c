@@ -0,0 +1,175 @@
+#include "thread_pool.h"
+
+typedef struct thread_pool_task {
+    thread_pool_task_fn fn;
+    void *arg;
+    struct thread_pool_task *next;
+} thread_pool_task;
+
+struct thread_pool {
+    mutex_t mutex;
+    cond_t task_ready; // 有新任务或需要退出
+    cond_t all_done; // 所有任务已完成
+    thread_pool_task *head;
+    thread_pool_task *tail;
+    int pending; // 排队中与执行中的任务数
+    int shutdown;
+    int thread_count;
+#ifdef _WIN32
+    HANDLE *threads;
+#else
+    pthread_t *threads;
+#endif
+};
+
+int get_cpu_count() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int) info.dwNumberOfProcessors : 1;
+#else
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int) count : 1;
+#endif
+}
+
+static void thread_pool_run(thread_pool *pool) {
+    MUTEX_LOCK(&pool->mutex);
+    while (1) {
+        while (!pool->head && !pool->shutdown) {
+            COND_WAIT(&pool->task_ready, &pool->mutex);
+        }
+        if (!pool->head) {
+            break; // 已请求退出且队列为空
+        }
+
+        thread_pool_task *task = pool->head;
+        pool->head = task->next;
+        if (!pool->head) pool->tail = NULL;
+        MUTEX_UNLOCK(&pool->mutex);
+
+        task->fn(task->arg);
+        free(task);
+
+        MUTEX_LOCK(&pool->mutex);
+        if (--pool->pending == 0) {
+            COND_BROADCAST(&pool->all_done);
+        }
+    }
+    MUTEX_UNLOCK(&pool->mutex);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI thread_pool_worker(LPVOID arg) {
+    thread_pool_run(arg);
+    return 0;
+}
+#else
+static void *thread_pool_worker(void *arg) {
+    thread_pool_run(arg);
+    return NULL;
+}
+#endif
+
+thread_pool *thread_pool_create(int thread_count) {
+    if (thread_count <= 0) {
+        thread_count = get_cpu_count();
+    }
+
+    thread_pool *pool = calloc(1, sizeof(thread_pool));
+    if (!pool) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        return NULL;
+    }
+    pool->threads = calloc(thread_count, sizeof(pool->threads[0]));
+    if (!pool->threads) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        free(pool);
+        return NULL;
+    }
+
+    MUTEX_INIT(&pool->mutex);
+    COND_INIT(&pool->task_ready);
+    COND_INIT(&pool->all_done);
+
+    for (int i = 0; i < thread_count; i++) {
+#ifdef _WIN32
+        pool->threads[i] = CreateThread(NULL, 0, thread_pool_worker, pool, 0, NULL);
+        const int created = pool->threads[i] != NULL;
+#else
+        const int created = pthread_create(&pool->threads[i], NULL, thread_pool_worker, pool) == 0;
+#endif
+        if (!created) {
+            fprintf(stderr, RED "==> 无法创建工作线程\n" RESET);
+            break;
+        }
+        pool->thread_count++;
+    }
+
+    if (pool->thread_count == 0) {
+        thread_pool_destroy(pool);
+        return NULL;
+    }
+
+    DEBUG_PRINT("线程池已创建，线程数: %d\n", pool->thread_count);
+    return pool;
+}
+
+int thread_pool_submit(thread_pool *pool, const thread_pool_task_fn fn, void *arg) {
+    thread_pool_task *task = malloc(sizeof(thread_pool_task));
+    if (!task) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        return 0;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    task->next = NULL;
+
+    MUTEX_LOCK(&pool->mutex);
+    if (pool->tail) {
+        pool->tail->next = task;
+    } else {
+        pool->head = task;
+    }
+    pool->tail = task;
+    pool->pending++;
+    COND_SIGNAL(&pool->task_ready);
+    MUTEX_UNLOCK(&pool->mutex);
+    return 1;
+}
+
+void thread_pool_wait(thread_pool *pool) {
+    MUTEX_LOCK(&pool->mutex);
+    while (pool->pending > 0) {
+        COND_WAIT(&pool->all_done, &pool->mutex);
+    }
+    MUTEX_UNLOCK(&pool->mutex);
+}
+
+void thread_pool_destroy(thread_pool *pool) {
+    if (!pool) return;
+
+    MUTEX_LOCK(&pool->mutex);
+    pool->shutdown = 1;
+    COND_BROADCAST(&pool->task_ready);
+    MUTEX_UNLOCK(&pool->mutex);
+
+    for (int i = 0; i < pool->thread_count; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(pool->threads[i], INFINITE);
+        CloseHandle(pool->threads[i]);
+#else
+        pthread_join(pool->threads[i], NULL);
+#endif
+    }
+
+    MUTEX_DESTROY(&pool->mutex);
+    COND_DESTROY(&pool->task_ready);
+    COND_DESTROY(&pool->all_done);
+    free(pool->threads);
+    free(pool);
+}
+
+int thread_pool_size(const thread_pool *pool) {
+    return pool->thread_count;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "cross_platform.h"
+
+// 线程池任务函数
+typedef void (*thread_pool_task_fn)(void *arg);
+
+typedef struct thread_pool thread_pool;
+
+// 获取可用的 CPU 核心数
+int get_cpu_count();
+
+// 创建线程池，thread_count 为 0 时使用 CPU 核心数
+thread_pool *thread_pool_create(int thread_count);
+
+// 提交任务，成功返回 1
+int thread_pool_submit(thread_pool *pool, thread_pool_task_fn fn, void *arg);
+
+// 等待所有已提交的任务完成
+void thread_pool_wait(thread_pool *pool);
+
+// 等待任务完成并销毁线程池
+void thread_pool_destroy(thread_pool *pool);
+
+int thread_pool_size(const thread_pool *pool);
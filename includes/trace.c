@@ -0,0 +1,174 @@
+#include "trace.h"
+#include "file_utils.h"
+#include "metrics.h"
+
+typedef struct {
+    const char *name;
+    char *detail;
+    double start; // 微秒，相对于 trace_start
+    double duration;
+} trace_event;
+
+// 每个线程一个缓冲区，记录时不加锁；全部缓冲区串成链表，写入时统一输出
+typedef struct trace_buffer {
+    int tid;
+    const char *thread_name;
+    trace_event *events;
+    int count;
+    int capacity;
+    struct trace_buffer *next;
+} trace_buffer;
+
+int trace_active = 0;
+
+static mutex_t trace_mutex;
+static const char *trace_path;
+static trace_buffer *trace_buffers;
+static int trace_next_tid;
+static int trace_generation; // 每次 trace_start 递增，线程中残留的旧缓冲区指针随之失效
+static double trace_origin;
+static THREAD_LOCAL trace_buffer *local_buffer;
+static THREAD_LOCAL int local_generation;
+
+static void trace_at_exit(void) {
+    trace_finish();
+}
+
+int trace_start(const char *path) {
+    static int registered = 0;
+    if (trace_active) return 1;
+    if (!registered) {
+        MUTEX_INIT(&trace_mutex);
+        if (atexit(trace_at_exit) != 0) {
+            fprintf(stderr, RED "==> 无法注册时间线输出\n" RESET);
+            return 0;
+        }
+        registered = 1;
+    }
+    trace_path = path;
+    trace_generation++;
+    trace_origin = monotonic_seconds();
+    trace_active = 1;
+    return 1;
+}
+
+static trace_buffer *current_buffer(void) {
+    if (local_buffer && local_generation == trace_generation) return local_buffer;
+    trace_buffer *buffer = calloc(1, sizeof(trace_buffer));
+    if (!buffer) return NULL;
+    MUTEX_LOCK(&trace_mutex);
+    buffer->tid = ++trace_next_tid;
+    buffer->next = trace_buffers;
+    trace_buffers = buffer;
+    MUTEX_UNLOCK(&trace_mutex);
+    local_buffer = buffer;
+    local_generation = trace_generation;
+    return buffer;
+}
+
+void trace_thread_name(const char *name) {
+    if (!trace_active) return;
+    trace_buffer *buffer = current_buffer();
+    if (buffer) buffer->thread_name = name;
+}
+
+double trace_begin(void) {
+    return trace_active ? monotonic_seconds() : 0.0;
+}
+
+void trace_end(const char *name, const double start, const char *detail) {
+    if (!trace_active) return;
+    const double end = monotonic_seconds();
+    trace_buffer *buffer = current_buffer();
+    if (!buffer) return;
+    if (buffer->count == buffer->capacity) {
+        const int capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+        trace_event *events = realloc(buffer->events, sizeof(trace_event) * (size_t) capacity);
+        if (!events) return; // 内存不足时丢弃，不影响转换
+        buffer->events = events;
+        buffer->capacity = capacity;
+    }
+    trace_event *event = &buffer->events[buffer->count++];
+    event->name = name;
+    event->detail = detail ? strdup(detail) : NULL;
+    event->start = (start - trace_origin) * 1e6;
+    event->duration = (end - start) * 1e6;
+}
+
+// 输出 JSON 字符串，文件路径中的反斜杠、引号和控制字符需要转义
+static void write_string(FILE *file, const char *text) {
+    fputc('"', file);
+    for (const unsigned char *p = (const unsigned char *) text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', file);
+            fputc(*p, file);
+        } else if (*p < 0x20) {
+            fprintf(file, "\\u%04x", *p);
+        } else {
+            fputc(*p, file);
+        }
+    }
+    fputc('"', file);
+}
+
+static int write_trace(const char *path) {
+    char temp_path[1100];
+    FILE *file = atomic_file_open(path, temp_path, sizeof(temp_path));
+    if (!file) {
+        return 0;
+    }
+
+    const int pid = (int) GETPID();
+    int first = 1;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (const trace_buffer *buffer = trace_buffers; buffer; buffer = buffer->next) {
+        if (buffer->thread_name) {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+                    first ? "" : ",\n", pid, buffer->tid);
+            write_string(file, buffer->thread_name);
+            fprintf(file, "}}");
+            first = 0;
+        }
+        for (int i = 0; i < buffer->count; i++) {
+            const trace_event *event = &buffer->events[i];
+            fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"blophy\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"pid\":%d,\"tid\":%d", first ? "" : ",\n", event->name, event->start, event->duration, pid,
+                    buffer->tid);
+            if (event->detail) {
+                fprintf(file, ",\"args\":{\"file\":");
+                write_string(file, event->detail);
+                fputc('}', file);
+            }
+            fputc('}', file);
+            first = 0;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return atomic_file_commit(file, temp_path, path, 0);
+}
+
+int trace_finish(void) {
+    if (!trace_active) return 1;
+    trace_active = 0;
+
+    // 调用时其他线程已经结束，不再有新的记录
+    const int ok = write_trace(trace_path);
+    int events = 0;
+    while (trace_buffers) {
+        trace_buffer *buffer = trace_buffers;
+        trace_buffers = buffer->next;
+        for (int i = 0; i < buffer->count; i++) {
+            free(buffer->events[i].detail);
+        }
+        events += buffer->count;
+        free(buffer->events);
+        free(buffer);
+    }
+    trace_next_tid = 0;
+    if (ok) {
+        printf(BLUE " -> 时间线: %d 个区间, 已写入 %s\n" RESET, events, trace_path);
+    } else {
+        fprintf(stderr, RED "==> 无法写入时间线: %s\n" RESET, trace_path);
+    }
+    return ok;
+}
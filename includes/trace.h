@@ -0,0 +1,36 @@
+#pragma once
+#include "cross_platform.h"
+
+// 静态探针 (USDT/SDT)：系统提供 <sys/sdt.h> 时在读取、解压、解析、生成 bpmList 和输出 Chart.json 的边界埋点，
+// 每个探针只是一条 nop，没有 perf / bpftrace 挂载时没有开销。探针的提供者为 blophy，例如
+//   bpftrace -e 'usdt:./mtbc:blophy:parse_done { @[arg1] = count(); }'
+// 编译时定义 BLOPHY_NO_USDT 可去掉全部探针
+#if !defined(BLOPHY_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define BLOPHY_HAS_USDT 1
+#endif
+#endif
+
+#ifdef BLOPHY_HAS_USDT
+#define TRACE_PROBE1(name, a) DTRACE_PROBE1(blophy, name, a)
+#define TRACE_PROBE2(name, a, b) DTRACE_PROBE2(blophy, name, a, b)
+#else
+#define TRACE_PROBE1(name, a) ((void) 0)
+#define TRACE_PROBE2(name, a, b) ((void) 0)
+#endif
+
+// Chrome Trace Event 格式的时间线 (--trace)：开启后各线程把区间记录到自己的缓冲区，
+// 进程退出时写成 JSON，可在 Perfetto / chrome://tracing 中查看每个线程在处理哪个文件、在等待什么
+extern int trace_active;
+
+// 开始记录，进程退出时写入 path
+int trace_start(const char *path);
+// 当前线程在时间线上显示的名称（静态字符串）
+void trace_thread_name(const char *name);
+// 区间开始时间，未开启时返回 0
+double trace_begin(void);
+// 记录从 start 开始到现在的区间；name 为静态字符串，detail 会被复制，可为 NULL
+void trace_end(const char *name, double start, const char *detail);
+// 立即写入并停止记录，成功返回 1
+int trace_finish(void);
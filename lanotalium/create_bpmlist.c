@@ -1,73 +1,42 @@
 #include "create_bpmlist.h"
 
-// 用于获取最简分数的最大公约数
-int gcd(int a, int b) {
-    while (b != 0) {
-        const int temp = b;
-        b = a % b;
-        a = temp;
-    }
-    return a;
-}
-
-// 将 double 转换为近似的分数形式
-void double_to_fraction(const double value, int *main, int *molecule, int *denominator) {
-    // 获取整数部分
-    *main = (int) value;
-
-    // 获取小数部分
-    const double fractional_part = value - *main;
-
-    // 假设我们将小数部分转换为分母为 1000 的分数
-    const int precision = 1000;
-    const int num = (int) (fractional_part * precision); // 小数部分乘以1000
-    *denominator = precision;
-
-    // 最简分数
-    const int common_divisor = gcd(num, *denominator);
-    *molecule = num / common_divisor;
-    *denominator = *denominator / common_divisor;
-}
-
 // 生成 bpmList
-cJSON *create_bpm_list(const cJSON *bpm) {
-    if (!cJSON_IsArray(bpm)) {
-        fprintf(stderr, RED "==> time 字段不是数组\n" RESET);
-        return cJSON_CreateArray();
+int lanota_create_bpm_list(const lanota_chart *chart, chart_ir *ir) {
+    if (!chart->has_bpm) {
+        LOG_ERROR(RED "==> bpm 字段不是数组\n" RESET);
+        return 1;
     }
 
-    cJSON *bpm_list = cJSON_CreateArray();
-    const int count = cJSON_GetArraySize(bpm);
-
-    for (int i = 0; i < count; i++) {
-        if (!cJSON_IsArray(bpm)) {
-            fprintf(stderr, RED "==> Bpm 数组中的元素格式不正确\n" RESET);
-            continue;
-        }
-        const cJSON *entry = cJSON_GetArrayItem(bpm, i);
-        const cJSON *beat = cJSON_GetObjectItem(entry, "Timing");
-        const cJSON *bpm_value = cJSON_GetObjectItem(entry, "Bpm");
+    for (int i = 0; i < chart->bpm_count; i++) {
+        const lanota_bpm *entry = &chart->bpms[i];
 
         int a, b, c;
-        if (beat->valuedouble < 0) {
+        if (entry->timing < 0) {
             a = 0;
             b = 0;
-            c = 0;
+            c = 1;
         } else {
-            double_to_fraction(beat->valuedouble, &a, &b, &c);
+            double_to_fraction(entry->timing, &a, &b, &c);
         }
 
-        cJSON *bpm_entry = cJSON_CreateObject();
-        cJSON_AddNumberToObject(bpm_entry, "integer", a);
-        cJSON_AddNumberToObject(bpm_entry, "molecule", b);
-        cJSON_AddNumberToObject(bpm_entry, "denominator", c);
-        cJSON_AddNumberToObject(bpm_entry, "currentBPM", bpm_value->valuedouble);
-        cJSON_AddNumberToObject(bpm_entry, "ThisStartBPM", bpm_value->valuedouble);
-
-        cJSON_AddItemToArray(bpm_list, bpm_entry);
+        const chart_beat beat = {a, b, c, entry->bpm, entry->bpm};
+        if (!chart_ir_add_tempo(ir, &beat)) {
+            return 0;
+        }
     }
 
-    printf(GREEN "==> BPM List解析完成.\n");
+    LOG_INFO(GREEN "==> BPM List解析完成.\n");
 
-    return bpm_list;
+    return 1;
+}
+
+// 由解码后的 Lanota 谱面生成中间表示，offset 取 eos；失败时 ir 仍需 chart_ir_free
+int lanota_build_chart_ir(const lanota_chart *chart, chart_ir *ir) {
+    if (!chart->has_eos) {
+        LOG_ERROR(RED "==> 未找到有效的 eos 值\n" RESET);
+    }
+    const double offset = chart->eos;
+    const int built = chart_ir_init(ir, offset, -1.0, chart->bpm_count) && lanota_create_bpm_list(chart, ir);
+    LOG_INFO(GREEN "==> Offset: %f\n" RESET, offset);
+    return built;
 }
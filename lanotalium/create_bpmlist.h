@@ -1,6 +1,10 @@
 #pragma once
 #include "../includes/cross_platform.h"
 #include <stdbool.h>
+#include "lanota_decode.h"
+#include "../includes/chart_ir.h"
 
 // 生成 bpmList
-cJSON *create_bpm_list(const cJSON *bpm);
\ No newline at end of file
+int lanota_create_bpm_list(const lanota_chart *chart, chart_ir *ir);
+// 由解码后的谱面生成中间表示；失败时 ir 仍需 chart_ir_free
+int lanota_build_chart_ir(const lanota_chart *chart, chart_ir *ir);
@@ -0,0 +1,89 @@
+#include "lanota_decode.h"
+#include "../includes/trace.h"
+
+enum {
+    LANOTA_KEY_UNKNOWN = 0,
+    LANOTA_KEY_BPM_LIST,
+    LANOTA_KEY_EOS,
+    LANOTA_KEY_TIMING,
+    LANOTA_KEY_BPM,
+};
+
+#define LANOTA_KEY_MASK 7u
+
+// 顶层的 bpm 和条目中的 Bpm 不区分大小写时是同一个键，分成两张键表
+static const schema_key lanota_keys[LANOTA_KEY_MASK + 1] = {
+    SCHEMA_KEY(LANOTA_KEY_MASK, "bpm", 'b', 'm', LANOTA_KEY_BPM_LIST),
+    SCHEMA_KEY(LANOTA_KEY_MASK, "eos", 'e', 's', LANOTA_KEY_EOS),
+};
+
+static const schema_key lanota_bpm_keys[LANOTA_KEY_MASK + 1] = {
+    SCHEMA_KEY(LANOTA_KEY_MASK, "timing", 't', 'g', LANOTA_KEY_TIMING),
+    SCHEMA_KEY(LANOTA_KEY_MASK, "bpm", 'b', 'm', LANOTA_KEY_BPM),
+};
+
+static int decode_bpm_field(json_reader *r, void *ctx, const int key, const json_token_type token) {
+    lanota_bpm *bpm = ctx;
+    if (key == LANOTA_KEY_TIMING) {
+        return schema_read_number(r, token, &bpm->timing);
+    }
+    if (key == LANOTA_KEY_BPM) {
+        return schema_read_number(r, token, &bpm->bpm);
+    }
+    return json_reader_skip(r, token) ? 0 : -1;
+}
+
+static int decode_bpm(json_reader *r, void *ctx, const json_token_type token) {
+    lanota_chart *chart = ctx;
+    if (token != JSON_TOKEN_OBJECT_START) {
+        LOG_ERROR(RED "==> Bpm 数组中的元素格式不正确\n" RESET);
+        return json_reader_skip(r, token) ? 0 : -1;
+    }
+    if (!schema_array_reserve((void **) &chart->bpms, &chart->bpm_capacity, chart->bpm_count,
+                              sizeof(lanota_bpm))) {
+        return -1;
+    }
+    lanota_bpm *bpm = &chart->bpms[chart->bpm_count++];
+    bpm->timing = 0;
+    bpm->bpm = 0;
+    return schema_read_object(r, token, lanota_bpm_keys, LANOTA_KEY_MASK, bpm, decode_bpm_field);
+}
+
+static int decode_chart_field(json_reader *r, void *ctx, const int key, const json_token_type token) {
+    lanota_chart *chart = ctx;
+    if (key == LANOTA_KEY_BPM_LIST) {
+        chart->has_bpm = token == JSON_TOKEN_ARRAY_START;
+        return schema_read_array(r, token, chart, decode_bpm);
+    }
+    if (key == LANOTA_KEY_EOS) {
+        const int result = schema_read_number(r, token, &chart->eos);
+        chart->has_eos = result == 1;
+        return result;
+    }
+    return json_reader_skip(r, token) ? 0 : -1;
+}
+
+int lanota_decode(json_reader *r, lanota_chart *chart) {
+    memset(chart, 0, sizeof(*chart));
+    return schema_decode_document(r, lanota_keys, LANOTA_KEY_MASK, chart, decode_chart_field);
+}
+
+int lanota_decode_string(const char *json, const size_t len, lanota_chart *chart) {
+    TRACE_PROBE2(parse_start, "lanota", len);
+    const double trace_start_time = trace_begin();
+    json_reader r;
+    json_reader_init_mem(&r, json, len);
+    const int ok = lanota_decode(&r, chart);
+    TRACE_PROBE2(parse_done, "lanota", ok);
+    trace_end("decode", trace_start_time, NULL);
+    if (!ok && r.error) {
+        DEBUG_PRINT("JSON 解析失败: %s\n", r.error);
+    }
+    json_reader_free(&r);
+    return ok;
+}
+
+void lanota_chart_free(lanota_chart *chart) {
+    free(chart->bpms);
+    memset(chart, 0, sizeof(*chart));
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "../includes/schema_decode.h"
+
+// Lanota 谱面中转换所需的字段，由 schema 解码器直接填充
+
+typedef struct {
+    double timing;
+    double bpm;
+} lanota_bpm;
+
+typedef struct {
+    double eos;
+    int has_eos;
+
+    lanota_bpm *bpms;
+    int bpm_count;
+    int bpm_capacity;
+    int has_bpm; // bpm 字段存在且为数组
+} lanota_chart;
+
+// 解码 Lanota 谱面，成功返回 1；失败时 chart 中已解码的内容仍需 lanota_chart_free
+int lanota_decode(json_reader *r, lanota_chart *chart);
+int lanota_decode_string(const char *json, size_t len, lanota_chart *chart);
+void lanota_chart_free(lanota_chart *chart);
@@ -11,6 +11,12 @@ set(CMAKE_FIND_ROOT_PATH arm-toolchain)
 # 设置编译器选项，确保使用正确的架构
 set(CMAKE_C_FLAGS "-mcpu=cortex-a9 -mfpu=vfpv3 -mfloat-abi=hard")
 
+# 通过 qemu 运行交叉编译的程序，PGO 训练需要执行插桩后的 ARM 程序
+find_program(ARM_QEMU NAMES qemu-arm qemu-arm-static)
+if (ARM_QEMU)
+    set(CMAKE_CROSSCOMPILING_EMULATOR ${ARM_QEMU} -L /usr/arm-linux-gnueabihf)
+endif ()
+
 # 查找库时使用交叉编译根路径
 set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY BOTH)
 set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE BOTH)
@@ -0,0 +1,299 @@
+#include "tools.h"
+
+// 探测音频时长时单次读取的最大字节数
+#define AUDIO_PROBE_SIZE (64 * 1024)
+
+// 支持按偏移读取的音频数据源（压缩包条目或磁盘文件）
+typedef struct {
+    mz_uint64 size;
+    FILE *file;
+    mz_zip_archive *zip;
+    unsigned int file_index;
+    int stored; // 条目未压缩时可直接按偏移读取
+    mz_uint64 data_offset; // 未压缩条目的数据在压缩包中的偏移
+    mz_zip_reader_extract_iter_state *iter; // 压缩条目只能顺序解压
+    mz_uint64 iter_pos;
+} audio_source;
+
+static unsigned int read_u16_le(const unsigned char *p) {
+    return p[0] | (unsigned int) p[1] << 8;
+}
+
+static unsigned long read_u32_le(const unsigned char *p) {
+    return p[0] | (unsigned long) p[1] << 8 | (unsigned long) p[2] << 16 | (unsigned long) p[3] << 24;
+}
+
+static unsigned long read_u32_be(const unsigned char *p) {
+    return (unsigned long) p[0] << 24 | (unsigned long) p[1] << 16 | (unsigned long) p[2] << 8 | p[3];
+}
+
+// 从数据源的指定偏移读取，返回实际读取的字节数
+static size_t audio_read_at(audio_source *src, const mz_uint64 offset, void *buf, size_t n) {
+    if (offset >= src->size) return 0;
+    if (n > src->size - offset) n = (size_t) (src->size - offset);
+
+    if (src->file) {
+        if (fseek(src->file, (long) offset, SEEK_SET) != 0) return 0;
+        return fread(buf, 1, n, src->file);
+    }
+
+    if (src->stored) {
+        return src->zip->m_pRead(src->zip->m_pIO_opaque, src->data_offset + offset, buf, n);
+    }
+
+    // 压缩条目：向前读取时跳过中间数据，向后读取时重新开始解压
+    if (!src->iter || offset < src->iter_pos) {
+        if (src->iter) mz_zip_reader_extract_iter_free(src->iter);
+        src->iter = mz_zip_reader_extract_iter_new(src->zip, src->file_index, 0);
+        src->iter_pos = 0;
+        if (!src->iter) return 0;
+    }
+    char skip[4096];
+    while (src->iter_pos < offset) {
+        const mz_uint64 remaining = offset - src->iter_pos;
+        const size_t chunk = remaining < sizeof(skip) ? (size_t) remaining : sizeof(skip);
+        const size_t read_len = mz_zip_reader_extract_iter_read(src->iter, skip, chunk);
+        if (read_len == 0) return 0;
+        src->iter_pos += read_len;
+    }
+    const size_t read_len = mz_zip_reader_extract_iter_read(src->iter, buf, n);
+    src->iter_pos += read_len;
+    return read_len;
+}
+
+// Ogg：首页确定采样率，最后一页的 granule position 即总采样数
+static double probe_ogg_length(audio_source *src, const unsigned char *head, const size_t head_len) {
+    if (head_len < 28) return -1.0;
+    const size_t packet = 27 + head[26];
+    double rate = 0;
+    unsigned int pre_skip = 0;
+    if (head_len >= packet + 16 && memcmp(head + packet, "\x01vorbis", 7) == 0) {
+        rate = (double) read_u32_le(head + packet + 12);
+    } else if (head_len >= packet + 12 && memcmp(head + packet, "OpusHead", 8) == 0) {
+        rate = 48000.0; // Opus 的 granule position 固定以 48kHz 计
+        pre_skip = read_u16_le(head + packet + 10);
+    }
+    if (rate <= 0) return -1.0;
+
+    unsigned char *tail = malloc(AUDIO_PROBE_SIZE);
+    if (!tail) return -1.0;
+    const mz_uint64 tail_offset = src->size > AUDIO_PROBE_SIZE ? src->size - AUDIO_PROBE_SIZE : 0;
+    const size_t tail_len = audio_read_at(src, tail_offset, tail, AUDIO_PROBE_SIZE);
+
+    // 从后往前查找最后一个有效的 Ogg 页
+    double length = -1.0;
+    for (size_t i = tail_len >= 14 ? tail_len - 13 : 0; i-- > 0;) {
+        if (memcmp(tail + i, "OggS", 4) != 0 || tail[i + 4] != 0) continue;
+        const mz_uint64 granule = read_u32_le(tail + i + 6) | (mz_uint64) read_u32_le(tail + i + 10) << 32;
+        if (granule == (mz_uint64) -1) continue; // 该页没有结束的数据包
+        length = (double) (granule > pre_skip ? granule - pre_skip : 0) / rate;
+        break;
+    }
+    free(tail);
+    return length;
+}
+
+// MP3：优先读取 Xing/Info 或 VBRI 头中的总帧数，否则按恒定码率估算
+static double probe_mp3_length(audio_source *src, const unsigned char *head, size_t head_len) {
+    static const int bitrates[2][3][15] = {
+        {
+            // MPEG-1 Layer I/II/III
+            {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+            {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+            {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+        },
+        {
+            // MPEG-2/2.5 Layer I/II/III
+            {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+            {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+            {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+        },
+    };
+    static const int sample_rates[3] = {44100, 48000, 32000};
+
+    // 跳过 ID3v2 标签，封面图较大时需要从标签之后重新读取
+    mz_uint64 audio_start = 0;
+    unsigned char *buf = NULL;
+    if (head_len >= 10 && memcmp(head, "ID3", 3) == 0) {
+        audio_start = 10 + ((head[6] & 0x7f) << 21 | (head[7] & 0x7f) << 14 | (head[8] & 0x7f) << 7 | (head[9] & 0x7f));
+        if (head[5] & 0x10) audio_start += 10;
+        buf = malloc(AUDIO_PROBE_SIZE);
+        if (!buf) return -1.0;
+        head_len = audio_read_at(src, audio_start, buf, AUDIO_PROBE_SIZE);
+        head = buf;
+    }
+
+    double length = -1.0;
+    for (size_t i = 0; i + 4 <= head_len; i++) {
+        if (head[i] != 0xff || (head[i + 1] & 0xe0) != 0xe0) continue;
+        const unsigned long h = read_u32_be(head + i);
+        const int version = (int) (h >> 19 & 3); // 3: MPEG-1, 2: MPEG-2, 0: MPEG-2.5
+        const int layer = 3 - (int) (h >> 17 & 3); // 0: Layer I, 1: Layer II, 2: Layer III
+        const int bitrate_index = (int) (h >> 12 & 0xf);
+        const int rate_index = (int) (h >> 10 & 3);
+        if (version == 1 || layer == 3 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3) continue;
+
+        const int lsf = version != 3;
+        const int sample_rate = sample_rates[rate_index] >> (version == 0 ? 2 : lsf);
+        const int samples_per_frame = layer == 0 ? 384 : (layer == 1 || !lsf ? 1152 : 576);
+        const int mono = (h >> 6 & 3) == 3;
+
+        // 0xFFE 同步字在音频数据中也会偶然出现，要求下一帧位置紧接着一个版本、层和采样率都相同的帧头
+        const int bitrate = bitrates[lsf][layer][bitrate_index] * 1000;
+        const int padding = (int) (h >> 9 & 1);
+        const size_t frame_length = layer == 0
+                                        ? (size_t) (12 * bitrate / sample_rate + padding) * 4
+                                        : (size_t) ((layer == 2 && lsf ? 72 : 144) * bitrate / sample_rate + padding);
+        const size_t next = i + frame_length;
+        if (audio_start + next != src->size) {
+            if (next + 4 > head_len) continue;
+            const unsigned long next_h = read_u32_be(head + next);
+            const int next_bitrate_index = (int) (next_h >> 12 & 0xf);
+            if ((next_h & 0xfffe0c00) != (h & 0xfffe0c00) || next_bitrate_index == 0 || next_bitrate_index == 15) {
+                continue;
+            }
+        }
+
+        // Xing/Info 头位于 side info 之后，VBRI 头固定在帧头后 32 字节
+        const size_t xing = i + 4 + (lsf ? (mono ? 9 : 17) : (mono ? 17 : 32));
+        const size_t vbri = i + 4 + 32;
+        unsigned long frames = 0;
+        if (layer == 2 && xing + 12 <= head_len &&
+            (memcmp(head + xing, "Xing", 4) == 0 || memcmp(head + xing, "Info", 4) == 0) &&
+            (read_u32_be(head + xing + 4) & 1)) {
+            frames = read_u32_be(head + xing + 8);
+        } else if (vbri + 18 <= head_len && memcmp(head + vbri, "VBRI", 4) == 0) {
+            frames = read_u32_be(head + vbri + 14);
+        }
+
+        if (frames > 0) {
+            length = (double) frames * samples_per_frame / sample_rate;
+        } else {
+            const mz_uint64 audio_bytes = src->size - (audio_start + i);
+            length = (double) audio_bytes * 8 / bitrate;
+        }
+        break;
+    }
+    free(buf);
+    return length;
+}
+
+// WAV：data 块大小除以每秒字节数
+static double probe_wav_length(audio_source *src) {
+    unsigned long byte_rate = 0;
+    mz_uint64 offset = 12;
+    unsigned char chunk[20];
+    while (audio_read_at(src, offset, chunk, sizeof(chunk)) >= 8) {
+        const unsigned long chunk_size = read_u32_le(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            byte_rate = read_u32_le(chunk + 8 + 8);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            return byte_rate > 0 ? (double) chunk_size / byte_rate : -1.0;
+        }
+        offset += 8 + chunk_size + (chunk_size & 1);
+    }
+    return -1.0;
+}
+
+// 根据文件头判断格式并计算时长，无法识别时返回 -1
+static double probe_audio_length(audio_source *src) {
+    unsigned char *head = malloc(AUDIO_PROBE_SIZE);
+    if (!head) {
+        LOG_ERROR(RED "==> 内存分配失败\n" RESET);
+        return -1.0;
+    }
+    const size_t head_len = audio_read_at(src, 0, head, AUDIO_PROBE_SIZE);
+
+    double length = -1.0;
+    if (head_len >= 4 && memcmp(head, "OggS", 4) == 0) {
+        length = probe_ogg_length(src, head, head_len);
+    } else if (head_len >= 12 && memcmp(head, "RIFF", 4) == 0 && memcmp(head + 8, "WAVE", 4) == 0) {
+        length = probe_wav_length(src);
+    } else {
+        length = probe_mp3_length(src, head, head_len);
+    }
+
+    free(head);
+    if (src->iter) {
+        mz_zip_reader_extract_iter_free(src->iter);
+        src->iter = NULL;
+    }
+    return length;
+}
+
+// 计算压缩包中音频条目的时长，只读取文件头和文件尾
+double probe_zip_audio_length(mz_zip_archive *zip, const unsigned int file_index) {
+    mz_zip_archive_file_stat file_stat;
+    if (!mz_zip_reader_file_stat(zip, file_index, &file_stat) || file_stat.m_is_encrypted) {
+        return -1.0;
+    }
+
+    audio_source src = {0};
+    src.size = file_stat.m_uncomp_size;
+    src.zip = zip;
+    src.file_index = file_index;
+
+    if (file_stat.m_method == 0) {
+        // 未压缩条目：跳过本地文件头后直接按偏移读取
+        unsigned char local_header[MZ_ZIP_LOCAL_DIR_HEADER_SIZE];
+        if (zip->m_pRead(zip->m_pIO_opaque, file_stat.m_local_header_ofs, local_header, sizeof(local_header)) !=
+            sizeof(local_header) || read_u32_le(local_header) != 0x04034b50) {
+            return -1.0;
+        }
+        src.stored = 1;
+        src.data_offset = file_stat.m_local_header_ofs + MZ_ZIP_LOCAL_DIR_HEADER_SIZE +
+                          read_u16_le(local_header + 26) + read_u16_le(local_header + 28);
+    }
+
+    const double length = probe_audio_length(&src);
+    DEBUG_PRINT("音频时长: %s -> %lf 秒\n", file_stat.m_filename, length);
+    return length;
+}
+
+// 计算磁盘上音频文件的时长
+double probe_file_audio_length(const char *path) {
+    audio_source src = {0};
+    src.file = fopen(path, "rb");
+    if (!src.file) {
+        return -1.0;
+    }
+    fseek(src.file, 0, SEEK_END);
+    const long size = ftell(src.file);
+    src.size = size > 0 ? (mz_uint64) size : 0;
+
+    const double length = probe_audio_length(&src);
+    fclose(src.file);
+    DEBUG_PRINT("音频时长: %s -> %lf 秒\n", path, length);
+    return length;
+}
+
+// 在压缩包中查找谱面目录下的音频条目，sound 为空时取目录中的第一个音频文件
+int locate_chart_audio(mz_zip_archive *zip, const char *chart_dir, const char *sound) {
+    char name[BUFFER_SIZE];
+    if (sound) {
+        if (chart_dir[0] != '\0') {
+            snprintf(name, sizeof(name), "%s/%s", chart_dir, sound);
+        } else {
+            snprintf(name, sizeof(name), "%s", sound);
+        }
+        const int index = mz_zip_reader_locate_file(zip, name, NULL, 0);
+        if (index >= 0) return index;
+    }
+
+    const size_t dir_len = strlen(chart_dir);
+    const unsigned int num_files = mz_zip_reader_get_num_files(zip);
+    for (unsigned int i = 0; i < num_files; i++) {
+        mz_zip_reader_get_filename(zip, i, name, sizeof(name));
+        const char *base = name;
+        if (dir_len > 0) {
+            if (strncmp(name, chart_dir, dir_len) != 0 || name[dir_len] != '/') continue;
+            base = name + dir_len + 1;
+        }
+        const char *dot = strrchr(base, '.');
+        if (strchr(base, '/') || !dot) continue;
+        if (STRCASECMP(dot, ".ogg") == 0 || STRCASECMP(dot, ".mp3") == 0 || STRCASECMP(dot, ".wav") == 0) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,1840 @@
+#include "batch.h"
+#include "batch_crawl.h"
+#include "batch_journal.h"
+#include "batch_shard.h"
+#include "create_bpmlist.h"
+#include "tools.h"
+#include "../includes/chart_format.h"
+#include "../includes/file_utils.h"
+#include "../includes/metrics.h"
+#include "../includes/bounded_queue.h"
+#include "../includes/thread_pool.h"
+#include "../includes/trace.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#endif
+
+static const char *stage_names[BATCH_STAGE_COUNT] = {
+    "discover", "load", "parse", "convert", "serialize", "write"
+};
+
+// .mcz 文件在内存中的数据，由同一压缩包的所有谱面共享
+typedef struct {
+    char *data;
+    size_t size;
+    uint64_t id; // 隔离模式中辅助进程按编号缓存压缩包，只在换成其他压缩包时重新发送
+    int refs;
+    mutex_t mutex;
+} batch_archive;
+
+// 续跑时，上次中断时仍在处理的输入（嫌疑输入）单独处理：等流水线中的其他输入都结束后才写入 PENDING，
+// 处理期间不放入新的输入。再次中断时只有它处于 PENDING，尝试次数只计入确实处理到中断点的输入
+typedef struct {
+    mutex_t mutex;
+    cond_t cond;
+    int in_flight; // 已写入 PENDING、尚未写入结果的输入数
+    int waiting; // 等待单独处理的嫌疑输入数，此时其他输入暂不放入
+    int isolating; // 正在单独处理嫌疑输入
+} batch_gate;
+
+// 一个输入文件的处理进度，由它产生的所有任务共享，全部结束时写入日志
+typedef struct {
+    batch_journal *journal;
+    batch_gate *gate;
+    int suspect; // 上次中断时仍在处理，需要单独处理
+    int admitted; // 已通过 gate_enter，结束时需要 gate_leave
+    batch_manifest *manifest; // 分片运行时记录到清单，否则为 NULL
+    size_t output_base; // output 中相对输出目录部分的起始位置
+    batch_journal_entry entry; // rel_path 和 output 指向下面的缓冲区
+    char rel_path[1024];
+    char output[1024];
+    int refs;
+    int failed;
+    mutex_t mutex;
+} batch_source;
+
+// 流水线中流转的任务
+typedef struct {
+    char input_path[1024]; // 输入文件的绝对路径
+    char rel_path[1024]; // 相对输入目录的路径
+    char entry_name[512]; // .mcz 中 .mc 条目的名称
+    unsigned int entry_index; // .mc 条目在压缩包中的序号，content 为 NULL 时在解析阶段流式解压
+    char song[512]; // 谱面包中的歌曲目录，以 '/' 分隔，单首歌曲时为空
+    int depth; // 所在压缩包的嵌套层数
+    int is_mcz;
+    chart_format format;
+    char *content;
+    size_t size;
+    batch_archive *archive;
+    batch_source *source;
+    mc_chart mc;
+    int decoded;
+    chart_ir chart;
+    int has_chart;
+    chart_stats stats; // 统计模式中记录的 note 和统计结果
+    int has_stats;
+    char *chart_string;
+    size_t chart_size;
+    char output_path[1024];
+    double stage_start; // 当前阶段开始处理的时间
+    double busy; // 已完成阶段的处理时间之和，计入时间预算
+    int isolated; // 已在子进程中完成解析到序列化，转换和序列化阶段直接传递
+} batch_job;
+
+#ifndef _WIN32
+// 隔离模式的辅助进程：在流水线线程启动之前 fork，只有一个线程，可以安全地为每个任务再 fork 子进程
+typedef struct {
+    pid_t pid;
+    int fd; // 与辅助进程相连的 socket，发送任务、接收结果，辅助进程退出后为 -1
+    uint64_t archive_id; // 辅助进程中缓存的压缩包
+    int busy;
+} isolate_helper;
+
+typedef struct {
+    mutex_t mutex;
+    cond_t cond;
+    isolate_helper *helpers;
+    int count;
+    int alive;
+} isolate_pool;
+#endif
+
+typedef struct batch_context batch_context;
+
+// 阶段处理函数，处理完成的任务放入 out
+typedef void (*batch_stage_fn)(batch_context *ctx, batch_job *job, bounded_queue *out);
+// 批量处理函数，用于读取和写入阶段一次提交多个 I/O 请求
+typedef void (*batch_stage_many_fn)(batch_context *ctx, batch_job **jobs, int count, bounded_queue *out,
+                                    batch_io *io);
+
+typedef struct {
+    batch_context *ctx;
+    batch_stage_id id;
+    batch_stage_fn fn;
+    batch_stage_many_fn fn_many;
+    bounded_queue *in;
+    bounded_queue *out;
+    int remaining; // 尚未退出的线程数，最后一个线程负责关闭下游队列
+} batch_stage;
+
+struct batch_context {
+    const batch_options *options;
+    chart_skeleton skeleton; // 只读共享的默认 boxes 片段
+    metrics metrics;
+    batch_journal journal;
+    batch_gate gate;
+    batch_manifest manifest; // 分片运行时本分片的清单
+    // 合并检查时只列出输入的相对路径，不进入流水线
+    int listing;
+    char **listed;
+    int listed_count;
+    int listed_capacity;
+    bounded_queue queues[BATCH_STAGE_COUNT];
+    batch_stage stages[BATCH_STAGE_COUNT];
+    mutex_t mutex;
+    int converted;
+    int failed;
+    int skipped; // 无法识别格式的文件
+    int resumed; // 日志中已完成且未改动、本次跳过的输入
+    uint64_t archive_count; // 已展开的压缩包数，用作压缩包编号
+    FILE *report; // 统计模式的输出
+#ifndef _WIN32
+    isolate_pool isolation;
+#endif
+};
+
+void batch_options_init(batch_options *options) {
+    memset(options, 0, sizeof(batch_options));
+    const int cpu_count = get_cpu_count();
+    const int half = cpu_count / 2 > 0 ? cpu_count / 2 : 1;
+    options->workers[BATCH_STAGE_DISCOVER] = cpu_count < 8 ? cpu_count : 8; // 遍历目录的线程数
+    options->workers[BATCH_STAGE_LOAD] = 2;
+    options->workers[BATCH_STAGE_PARSE] = half;
+    options->workers[BATCH_STAGE_CONVERT] = half;
+    options->workers[BATCH_STAGE_SERIALIZE] = half;
+    options->workers[BATCH_STAGE_WRITE] = 2;
+    options->queue_depth = 64;
+    options->metrics_interval = 10.0;
+    options->fsync_outputs = 1;
+    options->io_backend = BATCH_IO_AUTO;
+    options->compression_level = MZ_DEFAULT_LEVEL;
+}
+
+int batch_parse_stage_workers(batch_options *options, const char *spec) {
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%s", spec);
+    for (char *item = strtok(buffer, ","); item; item = strtok(NULL, ",")) {
+        char *eq = strchr(item, '=');
+        int found = 0;
+        if (eq) {
+            *eq = '\0';
+            for (int i = 0; i < BATCH_STAGE_COUNT; i++) {
+                if (strcmp(item, stage_names[i]) == 0) {
+                    const int workers = atoi(eq + 1);
+                    if (workers < 1) break;
+                    options->workers[i] = workers;
+                    found = 1;
+                }
+            }
+        }
+        if (!found) {
+            fprintf(stderr, RED "==> 无效的阶段线程数配置: %s\n" RESET, spec);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void archive_release(batch_archive *archive) {
+    if (!archive) return;
+    MUTEX_LOCK(&archive->mutex);
+    const int refs = --archive->refs;
+    MUTEX_UNLOCK(&archive->mutex);
+    if (refs == 0) {
+        MUTEX_DESTROY(&archive->mutex);
+        free(archive->data);
+        free(archive);
+    }
+}
+
+static void source_retain(batch_source *source) {
+    MUTEX_LOCK(&source->mutex);
+    source->refs++;
+    MUTEX_UNLOCK(&source->mutex);
+}
+
+// 记录谱面转换结果：failed 为 1 时记一次失败，否则记一个输出
+static void source_record(batch_source *source, const int failed) {
+    MUTEX_LOCK(&source->mutex);
+    if (failed) {
+        source->failed = 1;
+    } else {
+        source->entry.outputs++;
+    }
+    MUTEX_UNLOCK(&source->mutex);
+}
+
+static void gate_enter(batch_gate *gate, const int suspect) {
+    MUTEX_LOCK(&gate->mutex);
+    if (suspect) {
+        gate->waiting++;
+        while (gate->isolating || gate->in_flight > 0) {
+            COND_WAIT(&gate->cond, &gate->mutex);
+        }
+        gate->waiting--;
+        gate->isolating = 1;
+    } else {
+        while (gate->isolating || gate->waiting > 0) {
+            COND_WAIT(&gate->cond, &gate->mutex);
+        }
+    }
+    gate->in_flight++;
+    MUTEX_UNLOCK(&gate->mutex);
+}
+
+static void gate_leave(batch_gate *gate, const int suspect) {
+    MUTEX_LOCK(&gate->mutex);
+    gate->in_flight--;
+    if (suspect) gate->isolating = 0;
+    if (suspect || (gate->in_flight == 0 && gate->waiting > 0)) {
+        COND_BROADCAST(&gate->cond);
+    }
+    MUTEX_UNLOCK(&gate->mutex);
+}
+
+// 最后一个任务结束时写入日志
+static void source_release(batch_source *source) {
+    if (!source) return;
+    MUTEX_LOCK(&source->mutex);
+    const int refs = --source->refs;
+    MUTEX_UNLOCK(&source->mutex);
+    if (refs == 0) {
+        source->entry.status = source->failed ? BATCH_JOURNAL_FAILED : BATCH_JOURNAL_DONE;
+        batch_journal_append(source->journal, &source->entry);
+        if (source->manifest) {
+            batch_manifest_add(source->manifest, source->rel_path, source->output + source->output_base,
+                               source->entry.outputs, source->entry.status);
+        }
+        if (source->admitted) gate_leave(source->gate, source->suspect);
+        MUTEX_DESTROY(&source->mutex);
+        free(source);
+    }
+}
+
+static void job_free(batch_job *job) {
+    free(job->content);
+    archive_release(job->archive);
+    source_release(job->source);
+    if (job->decoded) mc_chart_free(&job->mc);
+    if (job->has_chart) chart_ir_free(&job->chart);
+    if (job->has_stats) chart_stats_free(&job->stats);
+    free(job->chart_string);
+    free(job);
+}
+
+static void job_fail(batch_context *ctx, batch_job *job, const metrics_failure failure, const char *reason) {
+    fprintf(stderr, RED "==> 转换失败 %s%s%s: %s\n" RESET, job->rel_path, job->entry_name[0] ? ":" : "",
+            job->entry_name, reason);
+    metrics_failed(&ctx->metrics, failure);
+    if (job->source) source_record(job->source, 1);
+    MUTEX_LOCK(&ctx->mutex);
+    ctx->failed++;
+    MUTEX_UNLOCK(&ctx->mutex);
+    job_free(job);
+}
+
+// 任务当前持有的数据量：输入内容、解码结果、谱面对象和输出文本
+static size_t job_memory(const batch_job *job) {
+    size_t bytes = job->content ? job->size : 0;
+    if (job->decoded) bytes += (size_t) job->mc.time_capacity * sizeof(mc_time_point);
+    if (job->has_chart) bytes += chart_ir_memory(&job->chart);
+    if (job->has_stats) bytes += chart_stats_memory(&job->stats);
+    return bytes + job->chart_size;
+}
+
+// 阶段结束：计入本阶段的处理时间（在队列中等待的时间不计入），
+// 超出时间预算或持有的数据超出内存预算时按失败处理，否则推入下一阶段
+static void job_forward(batch_context *ctx, batch_job *job, bounded_queue *out) {
+    const batch_options *options = ctx->options;
+    job->busy += monotonic_seconds() - job->stage_start;
+    char reason[128];
+    if (options->job_timeout > 0 && job->busy > options->job_timeout) {
+        snprintf(reason, sizeof(reason), "超过时间预算（已用 %.1f 秒）", job->busy);
+        job_fail(ctx, job, METRICS_FAIL_TIMEOUT, reason);
+        return;
+    }
+    const size_t memory = job_memory(job);
+    if (options->job_memory_limit > 0 && memory > options->job_memory_limit) {
+        snprintf(reason, sizeof(reason), "超过内存预算（%llu 字节）", (unsigned long long) memory);
+        job_fail(ctx, job, METRICS_FAIL_BUDGET, reason);
+        return;
+    }
+    bounded_queue_push(out, job);
+}
+
+static void job_skip(batch_context *ctx, batch_job *job) {
+    printf(YELLOW "==> 跳过无法识别的文件: %s\n" RESET, job->rel_path);
+    metrics_skipped(&ctx->metrics);
+    MUTEX_LOCK(&ctx->mutex);
+    ctx->skipped++;
+    MUTEX_UNLOCK(&ctx->mutex);
+    job_free(job);
+}
+
+static int is_input_file(const batch_context *ctx, const char *name) {
+    if (has_extension(name, ".mc") || has_extension(name, ".mcz")) return 1;
+    return ctx->options->all_formats && (has_extension(name, ".json") || has_extension(name, ".txt"));
+}
+
+// 去掉路径的扩展名
+static void strip_extension(char *path) {
+    char *dot = strrchr(path, '.');
+    char *sep = strrchr(path, PATH_SEPARATOR);
+    if (dot && (!sep || dot > sep)) *dot = '\0';
+}
+
+// 输入文件对应的输出目录 <输出目录>/<去掉扩展名的相对路径>
+static void build_output_base(const batch_context *ctx, const char *rel_path, char *dir, const size_t size) {
+    snprintf(dir, size, "%s%c%s", ctx->options->output_dir, PATH_SEPARATOR, rel_path);
+    strip_extension(dir);
+}
+
+// 上一次运行已完成、输入大小和修改时间都没变、输出仍然存在时跳过
+static int journal_up_to_date(const batch_journal_entry *entry, const uint64_t size, const int64_t mtime) {
+    return entry && entry->status == BATCH_JOURNAL_DONE && entry->size == size && entry->mtime == mtime &&
+           (entry->outputs == 0 || get_file_info(entry->output, NULL, NULL));
+}
+
+// 没有进入流水线的输入直接记录到本分片的清单
+static void manifest_record(batch_context *ctx, const char *rel_path, const int outputs,
+                            const batch_journal_status status) {
+    if (ctx->options->shard_count > 0) {
+        char output[1024];
+        build_output_base(ctx, rel_path, output, sizeof(output));
+        batch_manifest_add(&ctx->manifest, rel_path, output + strlen(ctx->options->output_dir) + 1, outputs, status);
+    }
+}
+
+static void list_file(batch_context *ctx, const char *rel_path) {
+    char *copy = strdup(rel_path);
+    if (!copy) return;
+    MUTEX_LOCK(&ctx->mutex);
+    if (ctx->listed_count == ctx->listed_capacity) {
+        const int capacity = ctx->listed_capacity ? ctx->listed_capacity * 2 : 1024;
+        char **grown = realloc(ctx->listed, (size_t) capacity * sizeof(char *));
+        if (!grown) {
+            MUTEX_UNLOCK(&ctx->mutex);
+            free(copy);
+            return;
+        }
+        ctx->listed = grown;
+        ctx->listed_capacity = capacity;
+    }
+    ctx->listed[ctx->listed_count++] = copy;
+    MUTEX_UNLOCK(&ctx->mutex);
+}
+
+// 可在多个遍历线程中同时调用
+static void discover_file(batch_context *ctx, const char *path, const char *rel_path, const uint64_t size,
+                          const int64_t mtime, bounded_queue *out) {
+    if (ctx->listing) {
+        list_file(ctx, rel_path);
+        return;
+    }
+    // 不属于本分片的输入由其他机器处理
+    if (ctx->options->shard_count > 0 &&
+        batch_shard_of(rel_path, ctx->options->shard_count) != ctx->options->shard_index - 1) {
+        return;
+    }
+
+    const batch_journal_entry *previous = batch_journal_find(&ctx->journal, rel_path);
+    int attempts = 1;
+    int suspect = 0;
+    if (ctx->options->resume && previous) {
+        if (journal_up_to_date(previous, size, mtime)) {
+            manifest_record(ctx, rel_path, previous->outputs, BATCH_JOURNAL_DONE);
+            MUTEX_LOCK(&ctx->mutex);
+            ctx->resumed++;
+            MUTEX_UNLOCK(&ctx->mutex);
+            return;
+        }
+        if (previous->status == BATCH_JOURNAL_PENDING) {
+            suspect = 1;
+            attempts = previous->attempts + 1;
+            if (attempts > BATCH_JOURNAL_MAX_ATTEMPTS && ctx->options->retry_crashed) {
+                attempts = BATCH_JOURNAL_MAX_ATTEMPTS; // 重新单独处理一次，再次中断时仍然跳过
+            } else if (attempts > BATCH_JOURNAL_MAX_ATTEMPTS) {
+                // 单独处理时进程仍然中断，几乎可以确定是它导致崩溃
+                fprintf(stderr, YELLOW "==> 单独处理时进程中断，跳过: %s（加 --retry-crashed 续跑可重试）\n" RESET,
+                        rel_path);
+                manifest_record(ctx, rel_path, 0, BATCH_JOURNAL_FAILED);
+                MUTEX_LOCK(&ctx->mutex);
+                ctx->failed++;
+                MUTEX_UNLOCK(&ctx->mutex);
+                return;
+            }
+        }
+    }
+
+    batch_job *job = calloc(1, sizeof(batch_job));
+    batch_source *source = calloc(1, sizeof(batch_source));
+    if (!job || !source) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        free(job);
+        free(source);
+        return;
+    }
+    snprintf(job->input_path, sizeof(job->input_path), "%s", path);
+    snprintf(job->rel_path, sizeof(job->rel_path), "%s", rel_path);
+
+    source->journal = &ctx->journal;
+    source->gate = &ctx->gate;
+    source->suspect = suspect;
+    snprintf(source->rel_path, sizeof(source->rel_path), "%s", rel_path);
+    build_output_base(ctx, rel_path, source->output, sizeof(source->output));
+    source->output_base = strlen(ctx->options->output_dir) + 1;
+    source->manifest = ctx->options->shard_count > 0 && !ctx->options->analyze ? &ctx->manifest : NULL;
+    source->entry.rel_path = source->rel_path;
+    source->entry.output = source->output;
+    source->entry.size = size;
+    source->entry.mtime = mtime;
+    source->entry.attempts = attempts;
+    source->refs = 1;
+    MUTEX_INIT(&source->mutex);
+    job->source = source;
+
+    if (!bounded_queue_push(out, job)) {
+        job_free(job);
+    }
+}
+
+// 并行遍历的回调，可在多个遍历线程中同时调用
+typedef struct {
+    batch_context *ctx;
+    bounded_queue *out;
+} discover_target;
+
+static int crawl_filter(void *user, const char *name) {
+    const discover_target *target = user;
+    return is_input_file(target->ctx, name);
+}
+
+static void crawl_found(void *user, const char *path, const char *rel_path, const uint64_t size,
+                        const int64_t mtime) {
+    const discover_target *target = user;
+    discover_file(target->ctx, path, rel_path, size, mtime, target->out);
+}
+
+// 输入可以是目录或单个文件，单个文件不检查扩展名，按内容识别格式
+static void stage_discover(batch_context *ctx, batch_job *job, bounded_queue *out) {
+    (void) job;
+    for (int i = 0; i < ctx->options->input_count; i++) {
+        char root[1024];
+        if (!get_absolute_path(ctx->options->inputs[i], root)) {
+            metrics_failed(&ctx->metrics, METRICS_FAIL_READ);
+            MUTEX_LOCK(&ctx->mutex);
+            ctx->failed++;
+            MUTEX_UNLOCK(&ctx->mutex);
+            continue;
+        }
+        struct stat st;
+        if (stat(root, &st) == 0 && S_ISDIR(st.st_mode)) {
+            discover_target target = {ctx, out};
+            if (batch_crawl(root, ctx->options->workers[BATCH_STAGE_DISCOVER], crawl_filter, crawl_found,
+                            &target) < 0) {
+                metrics_failed(&ctx->metrics, METRICS_FAIL_READ);
+                MUTEX_LOCK(&ctx->mutex);
+                ctx->failed++;
+                MUTEX_UNLOCK(&ctx->mutex);
+            }
+        } else {
+            const char *name = strrchr(root, PATH_SEPARATOR);
+            uint64_t size = 0;
+            int64_t mtime = 0;
+            get_file_info(root, &size, &mtime);
+            discover_file(ctx, root, name ? name + 1 : root, size, mtime, out);
+        }
+    }
+}
+
+// 压缩包嵌套层数上限：谱面包中的 .mcz 为第 2 层
+#define BATCH_ARCHIVE_MAX_DEPTH 3
+
+// 展开压缩包得到的任务交给的下一步
+typedef void (*batch_sink_fn)(batch_context *ctx, batch_job *job, bounded_queue *out);
+
+static void sink_push(batch_context *ctx, batch_job *job, bounded_queue *out) {
+    (void) ctx;
+    if (!bounded_queue_push(out, job)) {
+        job_free(job);
+    }
+}
+
+// 条目所在目录的长度，位于根目录时为 0
+static int entry_dir_length(const char *name) {
+    const char *slash = strrchr(name, '/');
+    return slash ? (int) (slash - name) : 0;
+}
+
+// 去掉扩展名的条目路径会拼接到输出目录下：以 '/' 或 '\' 分隔的每一段都不能为空、"." 或 ".."，
+// 也不能含 ':'（盘符、NTFS 数据流），因此绝对路径和跳出输出目录的路径都会被拒绝
+static int is_safe_entry_path(const char *name, const size_t length) {
+    const char *end = name + length;
+    const char *segment = name;
+    for (const char *p = name;; p++) {
+        if (p < end && *p == ':') return 0;
+        if (p < end && *p != '/' && *p != '\\') continue;
+        const size_t segment_length = (size_t) (p - segment);
+        if (segment_length == 0 ||
+            (segment[0] == '.' && (segment_length == 1 || (segment_length == 2 && segment[1] == '.')))) {
+            return 0;
+        }
+        if (p == end) return 1;
+        segment = p + 1;
+    }
+}
+
+// 是否含有多个谱面目录，此时按谱面包处理，每个目录输出到单独的歌曲目录
+static int is_song_pack(mz_zip_archive *zip) {
+    char first_dir[512] = {0};
+    int found = 0;
+    const unsigned int num_files = mz_zip_reader_get_num_files(zip);
+    for (unsigned int i = 0; i < num_files; i++) {
+        mz_zip_archive_file_stat file_stat;
+        if (!mz_zip_reader_file_stat(zip, i, &file_stat) || file_stat.m_is_directory ||
+            !has_extension(file_stat.m_filename, ".mc")) {
+            continue;
+        }
+        const int dir_len = entry_dir_length(file_stat.m_filename);
+        if (!found) {
+            snprintf(first_dir, sizeof(first_dir), "%.*s", dir_len, file_stat.m_filename);
+            found = 1;
+        } else if ((int) strlen(first_dir) != dir_len || strncmp(first_dir, file_stat.m_filename, dir_len) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 压缩包中需要解压的条目（谱面和嵌套的 .mcz）解压后的总大小，按中央目录中记录的大小计算，不解压
+static uint64_t archive_inflated_size(mz_zip_archive *zip) {
+    uint64_t total = 0;
+    const unsigned int num_files = mz_zip_reader_get_num_files(zip);
+    for (unsigned int i = 0; i < num_files; i++) {
+        mz_zip_archive_file_stat file_stat;
+        if (mz_zip_reader_file_stat(zip, i, &file_stat) && !file_stat.m_is_directory &&
+            (has_extension(file_stat.m_filename, ".mc") || has_extension(file_stat.m_filename, ".mcz"))) {
+            total += file_stat.m_uncomp_size;
+        }
+    }
+    return total;
+}
+
+// 在内存中展开压缩包（获得 content 的所有权）：每个 .mc 条目生成一个任务，
+// 嵌套的 .mcz 整体解压到内存后作为一个任务，由 sink 继续处理。
+// 解压前按记录的大小检查压缩包上限和单个任务的内存预算，压缩炸弹不会被解压
+static void expand_archive(batch_context *ctx, batch_job *job, char *content, const size_t size,
+                           bounded_queue *out, const batch_sink_fn sink) {
+    batch_archive *archive = calloc(1, sizeof(batch_archive));
+    if (!archive) {
+        free(content);
+        job_fail(ctx, job, METRICS_FAIL_NO_MEMORY, "内存分配失败");
+        return;
+    }
+    archive->data = content;
+    archive->size = size;
+    archive->refs = 1; // 展开期间持有的引用
+    MUTEX_INIT(&archive->mutex);
+    MUTEX_LOCK(&ctx->mutex);
+    archive->id = ++ctx->archive_count;
+    MUTEX_UNLOCK(&ctx->mutex);
+
+    mz_zip_archive zip = {0};
+    if (!mz_zip_reader_init_mem(&zip, archive->data, archive->size, 0)) {
+        archive_release(archive);
+        job_fail(ctx, job, METRICS_FAIL_ZIP_OPEN, "无法打开 .mcz 文件");
+        return;
+    }
+    const uint64_t inflated = ctx->options->archive_limit > 0 ? archive_inflated_size(&zip) : 0;
+    if (inflated > ctx->options->archive_limit) {
+        char reason[128];
+        snprintf(reason, sizeof(reason), "解压后共 %llu 字节，超过压缩包上限", (unsigned long long) inflated);
+        mz_zip_reader_end(&zip);
+        archive_release(archive);
+        job_fail(ctx, job, METRICS_FAIL_BUDGET, reason);
+        return;
+    }
+
+    const int pack = is_song_pack(&zip);
+    int chart_count = 0;
+    const unsigned int num_files = mz_zip_reader_get_num_files(&zip);
+    for (unsigned int i = 0; i < num_files; i++) {
+        mz_zip_archive_file_stat file_stat;
+        if (!mz_zip_reader_file_stat(&zip, i, &file_stat) || file_stat.m_is_directory) {
+            continue;
+        }
+        const int is_chart = has_extension(file_stat.m_filename, ".mc");
+        const int is_nested = has_extension(file_stat.m_filename, ".mcz");
+        if (!is_chart && !is_nested) continue;
+        if (is_nested && job->depth + 1 >= BATCH_ARCHIVE_MAX_DEPTH) {
+            fprintf(stderr, YELLOW "==> 压缩包嵌套过深，跳过: %s:%s\n" RESET, job->rel_path, file_stat.m_filename);
+            continue;
+        }
+        chart_count++;
+        // .mc 条目在解析阶段从内存中的压缩包流式解压，不占用解压后的大小；只有嵌套的 .mcz 需要整体解压
+        if (is_nested && ctx->options->job_memory_limit > 0 &&
+            file_stat.m_uncomp_size > ctx->options->job_memory_limit) {
+            fprintf(stderr, RED "==> 转换失败 %s:%s: 解压后 %llu 字节，超过内存预算\n" RESET, job->rel_path,
+                    file_stat.m_filename, (unsigned long long) file_stat.m_uncomp_size);
+            metrics_failed(&ctx->metrics, METRICS_FAIL_BUDGET);
+            if (job->source) source_record(job->source, 1);
+            MUTEX_LOCK(&ctx->mutex);
+            ctx->failed++;
+            MUTEX_UNLOCK(&ctx->mutex);
+            continue;
+        }
+
+        const double trace_start_time = trace_begin();
+        batch_job *chart_job = calloc(1, sizeof(batch_job));
+        char *data = NULL;
+        int extracted = chart_job != NULL;
+        if (extracted && is_nested) {
+            data = malloc((size_t) file_stat.m_uncomp_size + 1);
+            extracted = data && mz_zip_reader_extract_to_mem(&zip, i, data, (size_t) file_stat.m_uncomp_size, 0);
+        }
+        if (!extracted) {
+            fprintf(stderr, RED "==> 解压文件失败: %s:%s\n" RESET, job->rel_path, file_stat.m_filename);
+            free(chart_job);
+            free(data);
+            metrics_failed(&ctx->metrics, METRICS_FAIL_ZIP_EXTRACT);
+            if (job->source) source_record(job->source, 1);
+            MUTEX_LOCK(&ctx->mutex);
+            ctx->failed++;
+            MUTEX_UNLOCK(&ctx->mutex);
+            continue;
+        }
+        if (is_nested) {
+            data[file_stat.m_uncomp_size] = '\0';
+            TRACE_PROBE2(inflate_done, job->rel_path, file_stat.m_filename);
+        }
+        if (is_nested && trace_active) {
+            char detail[1100];
+            snprintf(detail, sizeof(detail), "%s:%s", job->rel_path, file_stat.m_filename);
+            trace_end("inflate", trace_start_time, detail);
+        }
+
+        *chart_job = *job;
+        if (chart_job->source) source_retain(chart_job->source);
+        chart_job->content = data;
+        chart_job->size = (size_t) file_stat.m_uncomp_size;
+        chart_job->stage_start = monotonic_seconds(); // 每个谱面单独计算时间预算
+        chart_job->busy = 0;
+        snprintf(chart_job->entry_name, sizeof(chart_job->entry_name), "%s", file_stat.m_filename);
+        // 条目路径会成为歌曲目录和谱面目录名，不安全的路径不写出
+        if (!is_safe_entry_path(file_stat.m_filename, strlen(file_stat.m_filename) - (is_chart ? 3 : 4))) {
+            job_fail(ctx, chart_job, METRICS_FAIL_ZIP_EXTRACT, "压缩包条目路径不安全");
+            continue;
+        }
+        const char *separator = job->song[0] ? "/" : "";
+        if (is_chart) {
+            chart_job->entry_index = i;
+            if (pack) {
+                snprintf(chart_job->song, sizeof(chart_job->song), "%s%s%.*s", job->song, separator,
+                         entry_dir_length(file_stat.m_filename), file_stat.m_filename);
+            }
+            MUTEX_LOCK(&archive->mutex);
+            archive->refs++;
+            MUTEX_UNLOCK(&archive->mutex);
+            chart_job->archive = archive;
+        } else {
+            // 嵌套的 .mcz 是一首歌曲，以去掉扩展名的条目路径作为歌曲目录
+            chart_job->entry_name[0] = '\0';
+            snprintf(chart_job->song, sizeof(chart_job->song), "%s%s%.*s", job->song, separator,
+                     (int) (strlen(file_stat.m_filename) - 4), file_stat.m_filename);
+            chart_job->depth = job->depth + 1;
+        }
+        sink(ctx, chart_job, out);
+    }
+    mz_zip_reader_end(&zip);
+
+    if (chart_count == 0) {
+        fprintf(stderr, RED "==> 没有找到 .mc 文件: %s\n" RESET, job->rel_path);
+    }
+    archive_release(archive);
+    job_free(job);
+}
+
+// 处理已读取的文件，按 zip 文件头识别 .mcz 和谱面包
+static void load_job_content(batch_context *ctx, batch_job *job, char *content, const size_t size,
+                             bounded_queue *out) {
+    if (!content) {
+        job_fail(ctx, job, METRICS_FAIL_READ, "无法读取文件");
+        return;
+    }
+    metrics_bytes(&ctx->metrics, size, 0);
+
+    // 修改时间变了但内容没变时同样跳过，并记录新的修改时间
+    batch_source *source = job->source;
+    source->entry.hash = batch_journal_hash(content, size);
+    const batch_journal_entry *previous = batch_journal_find(&ctx->journal, job->rel_path);
+    if (ctx->options->resume && previous && previous->hash == source->entry.hash &&
+        journal_up_to_date(previous, source->entry.size, previous->mtime)) {
+        source->entry.outputs = previous->outputs;
+        MUTEX_LOCK(&ctx->mutex);
+        ctx->resumed++;
+        MUTEX_UNLOCK(&ctx->mutex);
+        free(content);
+        job_free(job);
+        return;
+    }
+    gate_enter(&ctx->gate, source->suspect);
+    source->admitted = 1;
+    batch_journal_entry pending = source->entry;
+    pending.status = BATCH_JOURNAL_PENDING;
+    batch_journal_append(&ctx->journal, &pending);
+
+    job->is_mcz = chart_format_is_zip(content, size);
+    if (!job->is_mcz) {
+        job->content = content;
+        job->size = size;
+        bounded_queue_push(out, job);
+        return;
+    }
+    expand_archive(ctx, job, content, size, out, sink_push);
+}
+
+// 一次提交整批读取请求，超过内存预算的文件不读取
+static void stage_load(batch_context *ctx, batch_job **jobs, const int count, bounded_queue *out, batch_io *io) {
+    const char *paths[BATCH_IO_DEPTH];
+    char *contents[BATCH_IO_DEPTH];
+    size_t sizes[BATCH_IO_DEPTH];
+    batch_job *loading[BATCH_IO_DEPTH];
+    int loading_count = 0;
+    for (int i = 0; i < count; i++) {
+        const size_t limit = ctx->options->job_memory_limit;
+        if (limit > 0 && jobs[i]->source->entry.size > limit) {
+            job_fail(ctx, jobs[i], METRICS_FAIL_BUDGET, "文件超过内存预算");
+            continue;
+        }
+        paths[loading_count] = jobs[i]->input_path;
+        loading[loading_count++] = jobs[i];
+    }
+    if (loading_count > 0) {
+        batch_io_read_files(io, loading_count, paths, contents, sizes);
+    }
+    for (int i = 0; i < loading_count; i++) {
+        load_job_content(ctx, loading[i], contents[i], sizes[i], out);
+    }
+}
+
+// 识别格式并解析：Malody 谱面只解码，音频时长在转换阶段探测；其他格式直接生成中间表示。
+// 统计模式中 Malody 谱面的 note 在解码时直接记录到 stats，预览模式中跳过预览窗口之后的 note。
+// 成功返回 1，解析失败返回 0，无法识别格式返回 -1
+static int parse_job(const batch_context *ctx, batch_job *job) {
+    if (ctx->options->analyze) {
+        chart_stats_init(&job->stats, CHART_FORMAT_UNKNOWN);
+        job->has_stats = 1;
+    }
+    const mc_note_fn on_note = job->has_stats ? mc_stats_add_note : NULL;
+    const double preview = ctx->options->preview_seconds;
+    if (!job->content) {
+        // 压缩包中的 .mc 条目：从内存中的压缩包分块解压，边解压边解析
+        job->format = CHART_FORMAT_MALODY;
+        job->decoded = 1;
+        mz_zip_archive zip = {0};
+        int ok = mz_zip_reader_init_mem(&zip, job->archive->data, job->archive->size, 0);
+        if (on_note) {
+            ok = ok && mc_analyze_zip_entry(&zip, job->entry_index, &job->mc, on_note, &job->stats);
+        } else {
+            ok = ok && mc_preview_zip_entry(&zip, job->entry_index, preview, &job->mc);
+        }
+        mz_zip_reader_end(&zip);
+        return ok;
+    }
+    job->format = chart_format_detect(job->content, job->size);
+    if (job->format == CHART_FORMAT_UNKNOWN && (job->archive || has_extension(job->input_path, ".mc"))) {
+        job->format = CHART_FORMAT_MALODY; // 按扩展名当作 .mc 解析，损坏的文件计为解析失败
+    }
+    int ok;
+    switch (job->format) {
+        case CHART_FORMAT_MALODY:
+            job->decoded = 1;
+            ok = on_note ? mc_analyze_string(job->content, job->size, &job->mc, on_note, &job->stats)
+                         : mc_preview_string(job->content, job->size, preview, &job->mc);
+            break;
+        case CHART_FORMAT_CYLHEIM:
+        case CHART_FORMAT_LANOTA:
+            job->has_chart = 1;
+            ok = chart_format_build(job->format, job->content, job->size, -1.0, preview, &job->chart);
+            break;
+        default:
+            return -1;
+    }
+    free(job->content);
+    job->content = NULL;
+    return ok;
+}
+
+// 计算谱面音频时长：.mcz 从内存中的压缩包读取，.mc 读取同目录下的文件
+static double probe_job_music_length(const batch_job *job, const char *sound) {
+    if (!job->archive) {
+        if (!sound) return -1.0;
+        char sound_path[1024];
+        const char *last_sep = strrchr(job->input_path, PATH_SEPARATOR);
+        snprintf(sound_path, sizeof(sound_path), "%.*s%c%s", (int) (last_sep - job->input_path), job->input_path,
+                 PATH_SEPARATOR, sound);
+        return probe_file_audio_length(sound_path);
+    }
+
+    char chart_dir[512];
+    snprintf(chart_dir, sizeof(chart_dir), "%s", job->entry_name);
+    char *last_slash = strrchr(chart_dir, '/');
+    if (last_slash) {
+        *last_slash = '\0';
+    } else {
+        chart_dir[0] = '\0';
+    }
+
+    double music_length = -1.0;
+    mz_zip_archive zip = {0};
+    if (mz_zip_reader_init_mem(&zip, job->archive->data, job->archive->size, 0)) {
+        const int audio_index = locate_chart_audio(&zip, chart_dir, sound);
+        if (audio_index >= 0) {
+            music_length = probe_zip_audio_length(&zip, audio_index);
+        }
+        mz_zip_reader_end(&zip);
+    }
+    return music_length;
+}
+
+// 统计模式：只生成 bpmList（不探测音频），按 bpmList 换算 note 时间并统计，之后不再需要谱面对象
+static int analyze_job(batch_job *job, metrics_failure *failure, const char **reason) {
+    if (job->format == CHART_FORMAT_MALODY) {
+        if (!job->mc.has_time) {
+            *failure = METRICS_FAIL_MISSING_TIME;
+            *reason = "缺少 time 字段";
+            return 0;
+        }
+        job->has_chart = 1;
+        if (!mc_build_chart_ir(&job->mc, -1.0, &job->chart)) {
+            *failure = METRICS_FAIL_NO_MEMORY;
+            *reason = "内存分配失败";
+            return 0;
+        }
+        mc_stats_take_meta(&job->mc, &job->stats);
+        mc_chart_free(&job->mc);
+        job->decoded = 0;
+        archive_release(job->archive);
+        job->archive = NULL;
+    }
+    job->stats.format = job->format;
+    chart_stats_finish(&job->stats, &job->chart);
+    chart_ir_free(&job->chart);
+    job->has_chart = 0;
+    return 1;
+}
+
+// 生成谱面对象，成功返回 1，失败时设置 failure 和 reason 并返回 0。
+// 预览模式不探测音频（省去解压音频），由 chart_ir_truncate 把 musicLength 定为预览长度
+static int convert_job(const batch_context *ctx, batch_job *job, metrics_failure *failure, const char **reason) {
+    if (job->has_stats) {
+        return analyze_job(job, failure, reason);
+    }
+    const double preview = ctx->options->preview_seconds;
+    if (job->format == CHART_FORMAT_MALODY) {
+        if (!job->mc.has_time) {
+            *failure = METRICS_FAIL_MISSING_TIME;
+            *reason = "缺少 time 字段";
+            return 0;
+        }
+
+        const double music_length = preview > 0 ? -1.0 : probe_job_music_length(job, extract_sound_file(&job->mc));
+        job->has_chart = 1;
+        if (!mc_build_chart_ir(&job->mc, music_length, &job->chart)) {
+            *failure = METRICS_FAIL_NO_MEMORY;
+            *reason = "内存分配失败";
+            return 0;
+        }
+        mc_chart_free(&job->mc);
+        job->decoded = 0;
+        archive_release(job->archive);
+        job->archive = NULL;
+    }
+    if (preview > 0) {
+        chart_ir_truncate(&job->chart, preview);
+    }
+    return 1;
+}
+
+// 时间线和统计结果中的任务名：输入的相对路径，压缩包中的谱面加上条目名
+static void job_trace_detail(const batch_job *job, char *detail, const size_t size) {
+    if (job->entry_name[0]) {
+        snprintf(detail, size, "%s:%s", job->rel_path, job->entry_name);
+    } else {
+        snprintf(detail, size, "%s", job->rel_path);
+    }
+}
+
+static int append_to_writer(void *user, const char *data, const size_t len) {
+    json_writer *out = user;
+    json_writer_raw(out, data, len);
+    return !out->failed;
+}
+
+// 边序列化边压缩，内存中只保留压缩后的输出
+static int serialize_compressed(const batch_context *ctx, batch_job *job) {
+    json_writer out;
+    if (!json_writer_init(&out, JSON_WRITER_FLUSH_SIZE, 0)) return 0;
+    deflate_stream stream;
+    int ok = deflate_stream_init(&stream, ctx->options->compression, ctx->options->compression_level,
+                                 append_to_writer, &out);
+    if (ok) {
+        ok = chart_ir_serialize_stream(&job->chart, 1, &ctx->skeleton, deflate_stream_write, &stream) &&
+             deflate_stream_write(&stream, "\n", 1);
+        ok = deflate_stream_finish(&stream) && ok;
+    }
+    job->chart_string = ok ? json_writer_finish(&out, &job->chart_size) : NULL;
+    if (!ok) json_writer_free(&out);
+    return job->chart_string != NULL;
+}
+
+// 输出带换行的 Chart.json 文本（或其压缩结果），统计模式中为一行统计结果，写入阶段直接按长度输出；
+// 返回值同 convert_job
+static int serialize_job(const batch_context *ctx, batch_job *job, metrics_failure *failure, const char **reason) {
+    if (job->has_stats) {
+        char name[1100];
+        job_trace_detail(job, name, sizeof(name));
+        job->chart_string = chart_stats_format(&job->stats, ctx->options->analyze, name, &job->chart_size);
+        chart_stats_free(&job->stats);
+        job->has_stats = 0;
+        *failure = METRICS_FAIL_SERIALIZE;
+        *reason = "统计结果格式化失败";
+        return job->chart_string != NULL;
+    }
+    if (ctx->options->compression != OUTPUT_COMPRESSION_NONE) {
+        const int ok = serialize_compressed(ctx, job);
+        chart_ir_free(&job->chart);
+        job->has_chart = 0;
+        *failure = METRICS_FAIL_SERIALIZE;
+        *reason = "JSON 格式化或压缩失败";
+        return ok;
+    }
+    job->chart_string = chart_ir_serialize_cached(&job->chart, 1, &ctx->skeleton, &job->chart_size);
+    chart_ir_free(&job->chart);
+    job->has_chart = 0;
+    if (!job->chart_string) {
+        *failure = METRICS_FAIL_SERIALIZE;
+        *reason = "JSON 格式化失败";
+        return 0;
+    }
+
+    char *with_newline = realloc(job->chart_string, job->chart_size + 2);
+    if (!with_newline) {
+        *failure = METRICS_FAIL_NO_MEMORY;
+        *reason = "内存分配失败";
+        return 0;
+    }
+    with_newline[job->chart_size++] = '\n';
+    with_newline[job->chart_size] = '\0';
+    job->chart_string = with_newline;
+    return 1;
+}
+
+#ifndef _WIN32
+// 子进程地址空间上限在 fork 时的虚拟内存之上额外留出的余量（分配器开销、栈等）
+#define BATCH_ISOLATE_SLACK ((size_t) 64 << 20)
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// 主进程发给辅助进程的任务头，之后是 archive_size 字节的压缩包（0 表示沿用缓存）和 content_size 字节的输入
+typedef struct {
+    int32_t has_content;
+    int32_t has_archive;
+    uint64_t content_size;
+    uint64_t archive_size;
+    uint32_t entry_index;
+    double timeout; // 剩余的时间预算，0 表示不限制
+    char input_path[1024];
+    char rel_path[1024];
+    char entry_name[512];
+} isolated_request;
+
+// 辅助进程返回的结果头，之后是 length 字节的输出文本。子进程崩溃、超限和超时都转换为失败结果
+typedef struct {
+    int32_t status; // 同 parse_job：1 成功，0 失败，-1 无法识别格式
+    int32_t failure;
+    int32_t format;
+    uint64_t length;
+    char reason[128];
+} isolated_result;
+
+// 当前进程的虚拟内存大小，读不到 /proc/self/statm 时返回 0（不限制地址空间）
+static size_t process_virtual_size(void) {
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (!file) return 0;
+    unsigned long pages = 0;
+    const int ok = fscanf(file, "%lu", &pages) == 1;
+    fclose(file);
+    return ok ? (size_t) pages * (size_t) sysconf(_SC_PAGESIZE) : 0;
+}
+
+// 写入 socket 或管道；对端已退出时返回 0，不会收到 SIGPIPE
+static int write_all(const int fd, const void *data, size_t size) {
+    const char *p = data;
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == ENOTSOCK) n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        size -= (size_t) n;
+    }
+    return 1;
+}
+
+// 读满 size 字节，对端关闭时返回 0；buffer 为 NULL 时丢弃读到的数据
+static int read_all(const int fd, void *buffer, size_t size) {
+    char discard[4096];
+    char *p = buffer;
+    while (size > 0) {
+        const size_t chunk = p ? size : (size < sizeof(discard) ? size : sizeof(discard));
+        const ssize_t n = read(fd, p ? p : discard, chunk);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        if (p) p += n;
+        size -= (size_t) n;
+    }
+    return 1;
+}
+
+// 子进程：限制地址空间和 CPU 时间后完成解析到序列化，把结果写入管道。
+// 子进程由单线程的辅助进程 fork，不输出日志、不写时间线
+static void isolated_child(const batch_context *ctx, batch_job *job, const int fd) {
+    const size_t base = ctx->options->job_memory_limit > 0 ? process_virtual_size() : 0;
+    if (base > 0) {
+        const size_t address_limit = base + ctx->options->job_memory_limit + BATCH_ISOLATE_SLACK;
+        const struct rlimit limit = {address_limit, address_limit};
+        setrlimit(RLIMIT_AS, &limit);
+    }
+    if (ctx->options->job_timeout > 0) {
+        const rlim_t seconds = (rlim_t) ctx->options->job_timeout + 1;
+        const struct rlimit limit = {seconds, seconds + 1};
+        setrlimit(RLIMIT_CPU, &limit);
+    }
+
+    isolated_result result;
+    memset(&result, 0, sizeof(result));
+    metrics_failure failure = METRICS_FAIL_JSON_PARSE;
+    const char *reason = "无法解析 JSON 数据";
+    result.status = parse_job(ctx, job);
+    if (result.status == 1 &&
+        (!convert_job(ctx, job, &failure, &reason) || !serialize_job(ctx, job, &failure, &reason))) {
+        result.status = 0;
+    }
+    // 子进程中的内存分配失败通常是触到了地址空间上限
+    if (result.status == 0 && failure == METRICS_FAIL_NO_MEMORY && base > 0) {
+        failure = METRICS_FAIL_BUDGET;
+        reason = "超过内存预算";
+    }
+    result.failure = failure;
+    result.format = job->format;
+    result.length = result.status == 1 ? job->chart_size : 0;
+    snprintf(result.reason, sizeof(result.reason), "%s", reason);
+    const int ok = write_all(fd, &result, sizeof(result)) &&
+                   (result.length == 0 || write_all(fd, job->chart_string, job->chart_size));
+    _exit(ok ? 0 : 1);
+}
+
+// 读满 size 字节，返回 1；子进程提前退出时返回 0，并把退出状态写入 status；超过 deadline 时返回 -1
+static int read_child(const pid_t pid, const int fd, void *buffer, size_t size, const double deadline,
+                      int *exited, int *status) {
+    char *p = buffer;
+    while (size > 0) {
+        int wait_ms = 100;
+        if (deadline > 0) {
+            const double remaining = deadline - monotonic_seconds();
+            if (remaining <= 0) return -1;
+            if (remaining * 1000 < wait_ms) wait_ms = (int) (remaining * 1000) + 1;
+        }
+        struct pollfd pfd = {fd, POLLIN, 0};
+        const int ready = poll(&pfd, 1, wait_ms);
+        if (ready < 0 && errno != EINTR) return 0;
+        if (ready <= 0) {
+            if (!*exited && waitpid(pid, status, WNOHANG) == pid) *exited = 1;
+            // 退出后管道中已没有数据
+            if (*exited && poll(&pfd, 1, 0) == 0) return 0;
+            continue;
+        }
+        const ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        size -= (size_t) n;
+    }
+    return 1;
+}
+
+static void isolated_fail(isolated_result *result, const metrics_failure failure, const char *reason) {
+    result->status = 0;
+    result->failure = failure;
+    result->length = 0;
+    snprintf(result->reason, sizeof(result->reason), "%s", reason);
+}
+
+// 在辅助进程中 fork 子进程处理任务：崩溃、超出 rlimit 或超时被结束都只影响这个任务。
+// 成功时返回输出文本，其他情况在 result 中记录失败原因
+static char *run_job_child(const batch_context *ctx, batch_job *job, const double timeout, isolated_result *result) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        isolated_fail(result, METRICS_FAIL_CRASH, "无法创建子进程");
+        return NULL;
+    }
+    const double deadline = timeout > 0 ? monotonic_seconds() + timeout : 0;
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        isolated_child(ctx, job, fds[1]);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        isolated_fail(result, METRICS_FAIL_CRASH, "无法创建子进程");
+        return NULL;
+    }
+
+    char *data = NULL;
+    int exited = 0;
+    int status = 0;
+    int state = read_child(pid, fds[0], result, sizeof(*result), deadline, &exited, &status);
+    if (state == 1 && result->status == 1) {
+        data = malloc(result->length + 1);
+        state = data ? read_child(pid, fds[0], data, result->length, deadline, &exited, &status) : 0;
+    }
+    close(fds[0]);
+    if (state < 0 && !exited) kill(pid, SIGKILL);
+    if (!exited) {
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+        }
+    }
+
+    if (state == 1) {
+        result->reason[sizeof(result->reason) - 1] = '\0';
+        return data;
+    }
+    free(data);
+    if (state < 0) {
+        isolated_fail(result, METRICS_FAIL_TIMEOUT, "超过时间预算，已结束子进程");
+    } else if (WIFSIGNALED(status) && WTERMSIG(status) == SIGXCPU) {
+        isolated_fail(result, METRICS_FAIL_TIMEOUT, "超过 CPU 时间预算");
+    } else if (WIFSIGNALED(status)) {
+        char reason[128];
+        snprintf(reason, sizeof(reason), "子进程异常退出（信号 %d）", WTERMSIG(status));
+        isolated_fail(result, METRICS_FAIL_CRASH, reason);
+    } else {
+        isolated_fail(result, METRICS_FAIL_CRASH, "子进程异常退出");
+    }
+    return NULL;
+}
+
+// 辅助进程：逐个接收任务并在新的子进程中处理，把结果转发给主进程，主进程关闭 socket 后退出。
+// 压缩包缓存到换成其他压缩包为止，同一压缩包中的谱面不重复发送
+static void isolate_helper_main(const batch_context *ctx, const int fd) {
+    log_quiet = 1;
+    trace_active = 0;
+    batch_archive archive;
+    memset(&archive, 0, sizeof(archive));
+    archive.refs = 2; // 子进程中释放引用时不释放缓存
+    MUTEX_INIT(&archive.mutex);
+
+    isolated_request request;
+    while (read_all(fd, &request, sizeof(request))) {
+        isolated_result result;
+        memset(&result, 0, sizeof(result));
+        int received = 1;
+        if (request.archive_size > 0) {
+            free(archive.data);
+            archive.size = (size_t) request.archive_size;
+            archive.data = malloc(archive.size);
+            received = read_all(fd, archive.data, archive.size);
+            if (!archive.data) archive.size = 0;
+        }
+        char *content = NULL;
+        if (request.has_content) {
+            content = malloc((size_t) request.content_size + 1);
+            received = read_all(fd, content, (size_t) request.content_size) && received;
+            if (content) content[request.content_size] = '\0';
+        }
+        if (!received) break;
+
+        char *data = NULL;
+        if ((request.has_content && !content) || (request.has_archive && !archive.data)) {
+            isolated_fail(&result, METRICS_FAIL_NO_MEMORY, "内存分配失败");
+        } else {
+            batch_job job;
+            memset(&job, 0, sizeof(job));
+            snprintf(job.input_path, sizeof(job.input_path), "%s", request.input_path);
+            snprintf(job.rel_path, sizeof(job.rel_path), "%s", request.rel_path);
+            snprintf(job.entry_name, sizeof(job.entry_name), "%s", request.entry_name);
+            job.entry_index = request.entry_index;
+            job.content = content;
+            job.size = (size_t) request.content_size;
+            job.archive = request.has_archive ? &archive : NULL;
+            data = run_job_child(ctx, &job, request.timeout, &result);
+        }
+        free(content);
+        const int sent = write_all(fd, &result, sizeof(result)) &&
+                         (result.status != 1 || write_all(fd, data, (size_t) result.length));
+        free(data);
+        if (!sent) break;
+    }
+    _exit(0);
+}
+
+// 在启动流水线线程之前 fork 辅助进程，之后多线程的主进程不再 fork
+static int isolate_pool_start(const batch_context *ctx, isolate_pool *pool, const int count) {
+    MUTEX_INIT(&pool->mutex);
+    COND_INIT(&pool->cond);
+    pool->helpers = calloc((size_t) count, sizeof(isolate_helper));
+    if (!pool->helpers) return 0;
+    for (int i = 0; i < count; i++) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) break;
+#ifdef SO_NOSIGPIPE
+        const int one = 1;
+        setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+        setsockopt(fds[1], SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        const pid_t pid = fork();
+        if (pid == 0) {
+            // 不持有其他辅助进程的 socket，主进程关闭时它们才能收到 EOF
+            for (int j = 0; j < i; j++) {
+                close(pool->helpers[j].fd);
+            }
+            close(fds[0]);
+            isolate_helper_main(ctx, fds[1]);
+        }
+        close(fds[1]);
+        if (pid < 0) {
+            close(fds[0]);
+            break;
+        }
+        pool->helpers[i].pid = pid;
+        pool->helpers[i].fd = fds[0];
+        pool->count = pool->alive = i + 1;
+    }
+    return pool->count > 0;
+}
+
+// 关闭 socket 让辅助进程退出并回收
+static void isolate_pool_stop(isolate_pool *pool) {
+    for (int i = 0; i < pool->count; i++) {
+        isolate_helper *helper = &pool->helpers[i];
+        if (helper->fd < 0) continue;
+        close(helper->fd);
+        while (waitpid(helper->pid, NULL, 0) < 0 && errno == EINTR) {
+        }
+    }
+    free(pool->helpers);
+    COND_DESTROY(&pool->cond);
+    MUTEX_DESTROY(&pool->mutex);
+}
+
+// 取一个空闲的辅助进程，都在忙时等待，全部异常退出时返回 NULL
+static isolate_helper *isolate_acquire(isolate_pool *pool) {
+    MUTEX_LOCK(&pool->mutex);
+    isolate_helper *helper = NULL;
+    while (!helper && pool->alive > 0) {
+        for (int i = 0; i < pool->count && !helper; i++) {
+            if (pool->helpers[i].fd >= 0 && !pool->helpers[i].busy) helper = &pool->helpers[i];
+        }
+        if (!helper) COND_WAIT(&pool->cond, &pool->mutex);
+    }
+    if (helper) helper->busy = 1;
+    MUTEX_UNLOCK(&pool->mutex);
+    return helper;
+}
+
+// 归还辅助进程；通信失败说明辅助进程已退出，不再使用
+static void isolate_release(isolate_pool *pool, isolate_helper *helper, const int ok) {
+    if (!ok) {
+        close(helper->fd);
+        kill(helper->pid, SIGKILL);
+        while (waitpid(helper->pid, NULL, 0) < 0 && errno == EINTR) {
+        }
+    }
+    MUTEX_LOCK(&pool->mutex);
+    helper->busy = 0;
+    if (!ok) {
+        helper->fd = -1;
+        pool->alive--;
+    }
+    COND_BROADCAST(&pool->cond);
+    MUTEX_UNLOCK(&pool->mutex);
+}
+
+// 把任务交给辅助进程处理，解析到序列化都在辅助进程 fork 的子进程中完成
+static void run_isolated(batch_context *ctx, batch_job *job, bounded_queue *out) {
+    const batch_options *options = ctx->options;
+    isolated_request request;
+    memset(&request, 0, sizeof(request));
+    if (options->job_timeout > 0) {
+        request.timeout = job->stage_start + options->job_timeout - job->busy - monotonic_seconds();
+        if (request.timeout <= 0) {
+            job_fail(ctx, job, METRICS_FAIL_TIMEOUT, "超过时间预算");
+            return;
+        }
+    }
+    isolate_helper *helper = isolate_acquire(&ctx->isolation);
+    if (!helper) {
+        job_fail(ctx, job, METRICS_FAIL_CRASH, "没有可用的辅助进程");
+        return;
+    }
+
+    request.has_content = job->content != NULL;
+    request.has_archive = job->archive != NULL;
+    request.content_size = job->content ? job->size : 0;
+    const int send_archive = job->archive && job->archive->id != helper->archive_id;
+    request.archive_size = send_archive ? job->archive->size : 0;
+    request.entry_index = job->entry_index;
+    snprintf(request.input_path, sizeof(request.input_path), "%s", job->input_path);
+    snprintf(request.rel_path, sizeof(request.rel_path), "%s", job->rel_path);
+    snprintf(request.entry_name, sizeof(request.entry_name), "%s", job->entry_name);
+    int ok = write_all(helper->fd, &request, sizeof(request)) &&
+             (!send_archive || write_all(helper->fd, job->archive->data, job->archive->size)) &&
+             (!job->content || write_all(helper->fd, job->content, job->size));
+    if (ok && send_archive) helper->archive_id = job->archive->id;
+
+    isolated_result result;
+    char *data = NULL;
+    ok = ok && read_all(helper->fd, &result, sizeof(result));
+    if (ok && result.status == 1) {
+        data = malloc(result.length + 1);
+        ok = read_all(helper->fd, data, result.length);
+    }
+    // 辅助进程中的内存分配失败可能丢掉了压缩包缓存，下次重新发送
+    if (ok && result.failure == METRICS_FAIL_NO_MEMORY) helper->archive_id = 0;
+    isolate_release(&ctx->isolation, helper, ok);
+
+    if (!ok) {
+        free(data);
+        job_fail(ctx, job, METRICS_FAIL_CRASH, "辅助进程异常退出");
+        return;
+    }
+    if (result.status == 1 && !data) {
+        job_fail(ctx, job, METRICS_FAIL_NO_MEMORY, "内存分配失败");
+        return;
+    }
+    if (result.status < 0) {
+        job_skip(ctx, job);
+        return;
+    }
+    if (result.status == 0) {
+        result.reason[sizeof(result.reason) - 1] = '\0';
+        job_fail(ctx, job, (metrics_failure) result.failure, result.reason);
+        return;
+    }
+
+    data[result.length] = '\0';
+    free(job->content);
+    job->content = NULL;
+    archive_release(job->archive);
+    job->archive = NULL;
+    job->format = (chart_format) result.format;
+    job->chart_string = data;
+    job->chart_size = (size_t) result.length;
+    job->isolated = 1;
+    job_forward(ctx, job, out);
+}
+#endif
+
+// 谱面包中嵌套的 .mcz 在这里展开，分散到各个解析线程
+static void stage_parse(batch_context *ctx, batch_job *job, bounded_queue *out) {
+    if (job->content && chart_format_is_zip(job->content, job->size)) {
+        char *content = job->content;
+        job->content = NULL;
+        expand_archive(ctx, job, content, job->size, out, stage_parse);
+        return;
+    }
+#ifndef _WIN32
+    if (ctx->options->isolate) {
+        run_isolated(ctx, job, out);
+        return;
+    }
+#endif
+    const int result = parse_job(ctx, job);
+    if (result < 0) {
+        job_skip(ctx, job);
+        return;
+    }
+    if (!result) {
+        job_fail(ctx, job, METRICS_FAIL_JSON_PARSE, "无法解析 JSON 数据");
+        return;
+    }
+    job_forward(ctx, job, out);
+}
+
+static void stage_convert(batch_context *ctx, batch_job *job, bounded_queue *out) {
+    metrics_failure failure;
+    const char *reason;
+    if (!job->isolated && !convert_job(ctx, job, &failure, &reason)) {
+        job_fail(ctx, job, failure, reason);
+        return;
+    }
+    job_forward(ctx, job, out);
+}
+
+static void stage_serialize(batch_context *ctx, batch_job *job, bounded_queue *out) {
+    metrics_failure failure;
+    const char *reason;
+    if (!job->isolated && !serialize_job(ctx, job, &failure, &reason)) {
+        job_fail(ctx, job, failure, reason);
+        return;
+    }
+    job_forward(ctx, job, out);
+}
+
+// 输出到 <输出目录>/<相对路径>/[<歌曲目录>/][<谱面名>/]Chart.json（压缩输出时追加 .gz / .zz）
+static void build_job_output_path(const batch_context *ctx, batch_job *job) {
+    char dir[1024];
+    build_output_base(ctx, job->rel_path, dir, sizeof(dir));
+    if (job->song[0]) {
+        size_t len = strlen(dir);
+        snprintf(dir + len, sizeof(dir) - len, "%c%s", PATH_SEPARATOR, job->song);
+        for (char *p = dir + len + 1; *p; p++) {
+            if (*p == '/') *p = PATH_SEPARATOR;
+        }
+    }
+    if (job->entry_name[0]) {
+        const char *slash = strrchr(job->entry_name, '/');
+        char chart_name[512];
+        snprintf(chart_name, sizeof(chart_name), "%s", slash ? slash + 1 : job->entry_name);
+        char *dot = strrchr(chart_name, '.');
+        if (dot) *dot = '\0';
+        const size_t len = strlen(dir);
+        snprintf(dir + len, sizeof(dir) - len, "%c%s", PATH_SEPARATOR, chart_name);
+    }
+    snprintf(job->output_path, sizeof(job->output_path), "%s%cChart.json%s", dir, PATH_SEPARATOR,
+             output_compression_extension(ctx->options->compression));
+}
+
+// 统计模式：各谱面的结果按完成顺序追加到同一个输出
+static void write_report(batch_context *ctx, batch_job **jobs, const int count) {
+    for (int i = 0; i < count; i++) {
+        batch_job *job = jobs[i];
+        MUTEX_LOCK(&ctx->mutex);
+        const int written = fwrite(job->chart_string, 1, job->chart_size, ctx->report) == job->chart_size;
+        if (written) ctx->converted++;
+        MUTEX_UNLOCK(&ctx->mutex);
+        if (!written) {
+            job_fail(ctx, job, METRICS_FAIL_WRITE, "写入统计结果失败");
+            continue;
+        }
+        metrics_converted(&ctx->metrics, job->is_mcz ? CHART_FORMAT_MCZ : job->format);
+        metrics_bytes(&ctx->metrics, 0, job->chart_size);
+        source_record(job->source, 0);
+        job_free(job);
+    }
+    metrics_maybe_write(&ctx->metrics);
+}
+
+// 一次提交整批写入请求：先写入临时文件，整批落盘一次后再逐个重命名到输出路径，
+// 崩溃时输出目录中只会有完整的 Chart.json
+static void stage_write(batch_context *ctx, batch_job **jobs, const int count, bounded_queue *out, batch_io *io) {
+    (void) out;
+    if (ctx->report) {
+        write_report(ctx, jobs, count);
+        return;
+    }
+    char temp_paths[BATCH_IO_DEPTH][1100];
+    const char *paths[BATCH_IO_DEPTH];
+    const char *data[BATCH_IO_DEPTH];
+    size_t sizes[BATCH_IO_DEPTH];
+    int results[BATCH_IO_DEPTH];
+    batch_job *ready[BATCH_IO_DEPTH];
+    int ready_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        batch_job *job = jobs[i];
+        build_job_output_path(ctx, job);
+
+        char dir[1024];
+        snprintf(dir, sizeof(dir), "%s", job->output_path);
+        *strrchr(dir, PATH_SEPARATOR) = '\0';
+        if (!create_directories(dir)) {
+            job_fail(ctx, job, METRICS_FAIL_MKDIR, "无法创建输出目录");
+            continue;
+        }
+        atomic_temp_path(job->output_path, temp_paths[ready_count], sizeof(temp_paths[ready_count]));
+        paths[ready_count] = temp_paths[ready_count];
+        data[ready_count] = job->chart_string;
+        sizes[ready_count] = job->chart_size;
+        ready[ready_count++] = job;
+    }
+
+    batch_io_write_files(io, ready_count, paths, data, sizes, results);
+
+    const char *written[BATCH_IO_DEPTH];
+    int written_count = 0;
+    for (int i = 0; i < ready_count; i++) {
+        if (results[i]) written[written_count++] = paths[i];
+    }
+    if (ctx->options->fsync_outputs && written_count > 0 && !sync_files(written, written_count)) {
+        fprintf(stderr, YELLOW "==> 输出文件落盘失败\n" RESET);
+    }
+
+    const char *renamed[BATCH_IO_DEPTH];
+    int renamed_count = 0;
+    for (int i = 0; i < ready_count; i++) {
+        if (!results[i] || !REPLACE_FILE(paths[i], ready[i]->output_path)) {
+            REMOVE_FILE(paths[i]);
+            job_fail(ctx, ready[i], METRICS_FAIL_WRITE, "写入输出文件失败");
+            ready[i] = NULL;
+            continue;
+        }
+        renamed[renamed_count++] = ready[i]->output_path;
+    }
+    // 重命名产生的目录项落盘后再记为完成
+    if (ctx->options->fsync_outputs && renamed_count > 0 &&
+        !sync_parent_directories(renamed, renamed_count, ctx->options->output_dir)) {
+        fprintf(stderr, YELLOW "==> 输出目录落盘失败\n" RESET);
+    }
+
+    for (int i = 0; i < ready_count; i++) {
+        if (!ready[i]) continue;
+        MUTEX_LOCK(&ctx->mutex);
+        ctx->converted++;
+        MUTEX_UNLOCK(&ctx->mutex);
+        metrics_converted(&ctx->metrics, ready[i]->is_mcz ? CHART_FORMAT_MCZ : ready[i]->format);
+        metrics_bytes(&ctx->metrics, 0, ready[i]->chart_size);
+        source_record(ready[i]->source, 0);
+        printf(GREEN "==> 转换完成: %s\n" RESET, ready[i]->output_path);
+        job_free(ready[i]);
+    }
+    metrics_maybe_write(&ctx->metrics);
+}
+
+// 阶段线程：从上游队列取任务处理，直到上游关闭。
+// 开启时间线时记录每个任务的处理区间和等待上游的区间（wait），任务可能在处理中被释放，名称需要提前取出
+static void batch_stage_worker(void *arg) {
+    batch_stage *stage = arg;
+    const char *stage_name = stage_names[stage->id];
+    trace_thread_name(stage_name);
+    // 前端的逐谱面进度信息在多个线程中交错输出，没有意义；失败只通过 job_fail 报告
+    log_quiet = 1;
+    char detail[1100];
+    if (stage->fn_many) {
+        // 每个 I/O 线程使用独立的后端实例，创建失败时按标准库读写
+        batch_io *io = batch_io_create(stage->ctx->options->io_backend);
+        batch_job *jobs[BATCH_IO_DEPTH];
+        int count;
+        double wait_start = trace_begin();
+        while ((count = bounded_queue_pop_many(stage->in, (void **) jobs, BATCH_IO_DEPTH)) > 0) {
+            trace_end("wait", wait_start, NULL);
+            if (trace_active) {
+                job_trace_detail(jobs[0], detail, sizeof(detail));
+                const size_t len = strlen(detail);
+                if (count > 1) snprintf(detail + len, sizeof(detail) - len, " 等 %d 个", count);
+            }
+            TRACE_PROBE2(batch_stage_start, stage_name, count);
+            const double start = monotonic_seconds();
+            stage->fn_many(stage->ctx, jobs, count, stage->out, io);
+            metrics_observe(&stage->ctx->metrics, stage->id, (monotonic_seconds() - start) / count, count);
+            TRACE_PROBE2(batch_stage_done, stage_name, count);
+            trace_end(stage_name, start, detail);
+            wait_start = trace_begin();
+        }
+        batch_io_destroy(io);
+    } else if (stage->in) {
+        batch_job *job;
+        double wait_start = trace_begin();
+        while ((job = bounded_queue_pop(stage->in)) != NULL) {
+            trace_end("wait", wait_start, NULL);
+            if (trace_active) job_trace_detail(job, detail, sizeof(detail));
+            TRACE_PROBE2(batch_stage_start, stage_name, 1);
+            const double start = monotonic_seconds();
+            job->stage_start = start;
+            stage->fn(stage->ctx, job, stage->out);
+            metrics_observe(&stage->ctx->metrics, stage->id, monotonic_seconds() - start, 1);
+            TRACE_PROBE2(batch_stage_done, stage_name, 1);
+            trace_end(stage_name, start, detail);
+            wait_start = trace_begin();
+        }
+    } else {
+        stage->fn(stage->ctx, NULL, stage->out);
+    }
+
+    MUTEX_LOCK(&stage->ctx->mutex);
+    const int last = --stage->remaining == 0;
+    MUTEX_UNLOCK(&stage->ctx->mutex);
+    if (last && stage->out) {
+        bounded_queue_close(stage->out);
+    }
+    DEBUG_PRINT("阶段 %s 线程退出\n", stage_names[stage->id]);
+}
+
+static void metrics_timer_worker(void *arg) {
+    trace_thread_name("metrics");
+    metrics_run_timer(arg);
+}
+
+// 统计结果的输出："-" 为标准输出，之后的进度信息改写到标准错误；CSV 先写表头
+static FILE *open_report(const batch_options *options) {
+    FILE *report;
+    if (strcmp(options->analyze_path, "-") == 0) {
+        fflush(stdout);
+        const int fd = DUP(FILENO(stdout));
+        report = fd >= 0 ? FDOPEN(fd, "w") : NULL;
+        if (report) DUP2(FILENO(stderr), FILENO(stdout));
+    } else {
+        report = fopen(options->analyze_path, "wb");
+    }
+    if (!report) {
+        fprintf(stderr, RED "==> 无法打开统计输出: %s\n" RESET, options->analyze_path);
+        return NULL;
+    }
+    if (options->analyze == ANALYSIS_CSV) {
+        fputs(chart_stats_csv_header(), report);
+    }
+    return report;
+}
+
+int run_batch(const batch_options *options) {
+    static const batch_stage_fn stage_fns[BATCH_STAGE_COUNT] = {
+        stage_discover, NULL, stage_parse, stage_convert, stage_serialize, NULL
+    };
+    static const batch_stage_many_fn stage_many_fns[BATCH_STAGE_COUNT] = {
+        NULL, stage_load, NULL, NULL, NULL, stage_write
+    };
+
+    batch_context *ctx = calloc(1, sizeof(batch_context));
+    if (!ctx) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        return 0;
+    }
+    ctx->options = options;
+    // 统计模式不写入输出目录，也不使用任务日志
+    const int analyze = options->analyze != ANALYSIS_NONE;
+    if (analyze && !(ctx->report = open_report(options))) {
+        free(ctx);
+        return 0;
+    }
+    if (!analyze && !create_directories(options->output_dir)) {
+        fprintf(stderr, RED "==> 无法创建目录: %s\n" RESET, options->output_dir);
+        free(ctx);
+        return 0;
+    }
+    // 日志默认放在输出目录中，续跑时使用同一个输出目录即可；
+    // 分片运行时各分片使用各自的日志，多台机器可以共用一个输出目录
+    char journal_path[1024];
+    if (options->journal_path) {
+        snprintf(journal_path, sizeof(journal_path), "%s", options->journal_path);
+    } else if (options->shard_count > 0) {
+        snprintf(journal_path, sizeof(journal_path), "%s%c%s-%d-of-%d", options->output_dir, PATH_SEPARATOR,
+                 BATCH_JOURNAL_NAME, options->shard_index, options->shard_count);
+    } else {
+        snprintf(journal_path, sizeof(journal_path), "%s%c%s", options->output_dir, PATH_SEPARATOR,
+                 BATCH_JOURNAL_NAME);
+    }
+    // 预览输出不完整，使用单独的日志，之后在同一目录完整续跑时不会当作已完成
+    if (options->preview_seconds > 0 && !options->journal_path) {
+        const size_t len = strlen(journal_path);
+        snprintf(journal_path + len, sizeof(journal_path) - len, "-preview");
+    }
+    if (!analyze && !batch_journal_open(&ctx->journal, journal_path, options->resume)) {
+        free(ctx);
+        return 0;
+    }
+    batch_manifest_init(&ctx->manifest);
+    if (options->shard_count > 0) {
+        printf(BLUE " -> 分片 %d/%d\n" RESET, options->shard_index, options->shard_count);
+    }
+    if (options->preview_seconds > 0) {
+        printf(BLUE " -> 预览: 只输出前 %g 秒\n" RESET, options->preview_seconds);
+    }
+    if (options->job_timeout > 0 || options->job_memory_limit > 0 || options->archive_limit > 0) {
+        printf(BLUE " -> 单个任务预算: 时间 %g 秒, 内存 %.1f MB, 压缩包 %.1f MB（0 表示不限制）\n" RESET,
+               options->job_timeout, options->job_memory_limit / 1048576.0, options->archive_limit / 1048576.0);
+    }
+    if (options->compression != OUTPUT_COMPRESSION_NONE) {
+        printf(BLUE " -> 输出压缩: Chart.json%s, 级别 %d\n" RESET, output_compression_extension(options->compression),
+               options->compression_level);
+    }
+    if (analyze) {
+        printf(BLUE " -> 统计: 每个谱面输出一行 %s 到 %s\n" RESET, options->analyze == ANALYSIS_CSV ? "CSV" : "JSON",
+               strcmp(options->analyze_path, "-") == 0 ? "标准输出" : options->analyze_path);
+    }
+    if (options->isolate) {
+#ifdef _WIN32
+        fprintf(stderr, YELLOW "==> Windows 不支持子进程隔离，在当前进程中处理\n" RESET);
+#else
+        printf(BLUE " -> 隔离: 每个谱面在子进程中解析到序列化，%d 个辅助进程\n" RESET,
+               options->workers[BATCH_STAGE_PARSE]);
+#endif
+    }
+    // 缓存创建失败时按完整流程序列化
+    chart_skeleton_init(&ctx->skeleton, 1);
+    metrics_init(&ctx->metrics, options->metrics_path, options->metrics_interval, stage_names, BATCH_STAGE_COUNT);
+    MUTEX_INIT(&ctx->mutex);
+    MUTEX_INIT(&ctx->gate.mutex);
+    COND_INIT(&ctx->gate.cond);
+    int ready = 1;
+#ifndef _WIN32
+    // 辅助进程复制此时的上下文，必须在创建任何线程之前 fork
+    if (options->isolate && !isolate_pool_start(ctx, &ctx->isolation, options->workers[BATCH_STAGE_PARSE])) {
+        fprintf(stderr, RED "==> 无法创建辅助进程\n" RESET);
+        ready = 0;
+    }
+#endif
+
+    // queues[i] 为第 i 阶段的输入队列，发现阶段没有输入
+    int total_workers = 0;
+    for (int i = 0; i < BATCH_STAGE_COUNT; i++) {
+        if (i > 0) bounded_queue_init(&ctx->queues[i], options->queue_depth);
+        batch_stage *stage = &ctx->stages[i];
+        stage->ctx = ctx;
+        stage->id = i;
+        stage->fn = stage_fns[i];
+        stage->fn_many = stage_many_fns[i];
+        stage->in = i > 0 ? &ctx->queues[i] : NULL;
+        stage->out = i + 1 < BATCH_STAGE_COUNT ? &ctx->queues[i + 1] : NULL;
+        stage->remaining = i == BATCH_STAGE_DISCOVER ? 1 : options->workers[i];
+        total_workers += stage->remaining;
+        printf(BLUE " -> 阶段 %s: %d 线程\n" RESET, stage_names[i],
+               i == BATCH_STAGE_DISCOVER ? options->workers[i] : stage->remaining);
+    }
+
+    int ok = 0;
+    thread_pool *pool = ready ? thread_pool_create(total_workers) : NULL;
+    if (pool) {
+        // 指标由单独的线程定时输出，不依赖流水线中有任务完成；创建失败时只在任务完成时输出
+        thread_pool *timer = options->metrics_path ? thread_pool_create(1) : NULL;
+        if (timer) thread_pool_submit(timer, metrics_timer_worker, &ctx->metrics);
+        for (int i = 0; i < BATCH_STAGE_COUNT; i++) {
+            for (int w = ctx->stages[i].remaining; w > 0; w--) {
+                thread_pool_submit(pool, batch_stage_worker, &ctx->stages[i]);
+            }
+        }
+        thread_pool_destroy(pool);
+        metrics_stop_timer(&ctx->metrics);
+        thread_pool_destroy(timer);
+        // Linux 上让最后一批重命名产生的目录项落盘，其他 POSIX 平台在写入阶段已逐个目录同步
+        if (!analyze && options->fsync_outputs && !sync_directory(options->output_dir)) {
+            fprintf(stderr, YELLOW "==> 输出目录落盘失败: %s\n" RESET, options->output_dir);
+        }
+        ok = ctx->failed == 0;
+    }
+#ifndef _WIN32
+    if (options->isolate) isolate_pool_stop(&ctx->isolation);
+#endif
+
+    if (ctx->report && fclose(ctx->report) != 0) {
+        fprintf(stderr, RED "==> 写入统计输出失败: %s\n" RESET, options->analyze_path);
+        ok = 0;
+    }
+    const char *summary = analyze ? "统计完成" : "批量转换完成";
+    printf(ok ? GREEN "==> %s: 成功 %d, 失败 %d\n" RESET : RED "==> %s: 成功 %d, 失败 %d\n" RESET, summary,
+           ctx->converted, ctx->failed);
+    if (ctx->skipped > 0) {
+        printf(YELLOW "==> 跳过 %d 个无法识别的文件\n" RESET, ctx->skipped);
+    }
+    if (ctx->resumed > 0) {
+        printf(BLUE "==> 跳过 %d 个上次已完成的输入\n" RESET, ctx->resumed);
+    }
+
+    for (int i = 1; i < BATCH_STAGE_COUNT; i++) {
+        bounded_queue_destroy(&ctx->queues[i]);
+    }
+    if (!metrics_write(&ctx->metrics)) {
+        ok = 0;
+    }
+    if (!analyze && options->shard_count > 0) {
+        char manifest_path[1024];
+        batch_manifest_path(options->output_dir, options->shard_index, options->shard_count, manifest_path,
+                            sizeof(manifest_path));
+        if (!batch_manifest_write(&ctx->manifest, manifest_path, options->shard_index, options->shard_count)) {
+            ok = 0;
+        }
+    }
+    batch_manifest_free(&ctx->manifest);
+    metrics_destroy(&ctx->metrics);
+    batch_journal_close(&ctx->journal);
+    chart_skeleton_free(&ctx->skeleton);
+    COND_DESTROY(&ctx->gate.cond);
+    MUTEX_DESTROY(&ctx->gate.mutex);
+    MUTEX_DESTROY(&ctx->mutex);
+    free(ctx);
+    return ok;
+}
+
+int batch_merge_shards(const batch_options *options) {
+    if (options->input_count == 0) {
+        return batch_manifest_merge(options->output_dir, NULL, 0);
+    }
+    // 重新列出输入，检查没有输入被所有分片遗漏
+    batch_context *ctx = calloc(1, sizeof(batch_context));
+    if (!ctx) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        return 0;
+    }
+    ctx->options = options;
+    ctx->listing = 1;
+    MUTEX_INIT(&ctx->mutex);
+    stage_discover(ctx, NULL, NULL);
+    const int ok = ctx->failed == 0 &&
+                   batch_manifest_merge(options->output_dir, (const char *const *) ctx->listed, ctx->listed_count);
+    for (int i = 0; i < ctx->listed_count; i++) {
+        free(ctx->listed[i]);
+    }
+    free(ctx->listed);
+    MUTEX_DESTROY(&ctx->mutex);
+    free(ctx);
+    return ok;
+}
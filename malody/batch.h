@@ -0,0 +1,57 @@
+#pragma once
+#include "../includes/cross_platform.h"
+#include "batch_io.h"
+#include "../includes/chart_stats.h"
+#include "../includes/deflate_stream.h"
+
+// 批量转换流水线的各个阶段
+typedef enum {
+    BATCH_STAGE_DISCOVER, // 查找输入文件
+    BATCH_STAGE_LOAD, // 读取文件、在内存中解压 .mcz
+    BATCH_STAGE_PARSE, // 识别格式、解析 JSON
+    BATCH_STAGE_CONVERT, // 生成谱面对象
+    BATCH_STAGE_SERIALIZE, // 格式化 JSON
+    BATCH_STAGE_WRITE, // 写入输出文件
+    BATCH_STAGE_COUNT
+} batch_stage_id;
+
+// 默认的任务日志文件名
+#define BATCH_JOURNAL_NAME ".blophy-journal"
+
+typedef struct {
+    const char **inputs; // 输入目录或单个谱面文件
+    int input_count;
+    const char *output_dir;
+    int workers[BATCH_STAGE_COUNT]; // 各阶段的线程数，discover 为并行遍历目录的线程数
+    int queue_depth; // 阶段之间队列的容量
+    batch_io_backend io_backend; // 读取和写入阶段使用的 I/O 后端
+    int all_formats; // 目录中同时查找 .json/.txt（Cylheim、Lanota 谱面），否则只查找 .mc/.mcz
+    const char *metrics_path; // Prometheus textfile 输出路径，NULL 时不输出
+    double metrics_interval; // 运行期间输出指标的间隔（秒）
+    int fsync_outputs; // 每批输出重命名前落盘一次（默认开启）
+    const char *journal_path; // 任务日志路径，NULL 时为 <输出目录>/BATCH_JOURNAL_NAME
+    int resume; // 跳过日志中已完成且未改动的输入
+    int retry_crashed; // 续跑时重试因单独处理时中断而跳过的输入
+    int shard_index; // 分片序号，从 1 开始
+    int shard_count; // 分片总数，0 表示不分片
+    double preview_seconds; // 大于 0 时只输出开头这么多秒的预览谱面，不探测音频时长
+    // 单个任务的预算，0 表示不限制；超出的任务记为失败，不影响其他任务
+    double job_timeout; // 从读取完成到序列化结束的时间（秒），在各阶段开始时检查
+    size_t job_memory_limit; // 输入、解压后的谱面和各阶段数据的字节数
+    size_t archive_limit; // 压缩包中谱面解压后的总字节数，解压前按目录中记录的大小检查
+    int isolate; // 在子进程中解析、转换和序列化每个谱面，用 rlimit 限制内存和 CPU 时间（仅 POSIX）
+    output_compression compression; // 输出 Chart.json.gz / Chart.json.zz，序列化时直接压缩
+    int compression_level; // 0-9，默认 MZ_DEFAULT_LEVEL
+    // 不为 ANALYSIS_NONE 时只统计谱面（--analyze），每个谱面向 analyze_path 输出一行，
+    // 不写入输出目录，也不使用任务日志和分片清单
+    analysis_format analyze;
+    const char *analyze_path; // "-" 为标准输出
+} batch_options;
+
+void batch_options_init(batch_options *options);
+// 解析 "parse=4,write=2" 形式的阶段线程数配置
+int batch_parse_stage_workers(batch_options *options, const char *spec);
+// 执行批量转换，全部成功返回 1
+int run_batch(const batch_options *options);
+// 检查输出目录中各分片的清单；指定了输入时同时检查每个输入都已分配，全部通过返回 1
+int batch_merge_shards(const batch_options *options);
@@ -0,0 +1,242 @@
+#include "batch_crawl.h"
+#include "../includes/file_utils.h"
+#include "../includes/thread_pool.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
+
+// 路径缓冲区，按需增长，不限制路径长度
+typedef struct {
+    char *data;
+    size_t capacity;
+} path_buffer;
+
+static const char *join_path(path_buffer *buffer, const char *dir, const char *name) {
+    const size_t dir_len = strlen(dir);
+    const size_t need = dir_len + strlen(name) + 2;
+    if (need > buffer->capacity) {
+        char *data = realloc(buffer->data, need * 2);
+        if (!data) return NULL;
+        buffer->data = data;
+        buffer->capacity = need * 2;
+    }
+    memcpy(buffer->data, dir, dir_len);
+    buffer->data[dir_len] = PATH_SEPARATOR;
+    strcpy(buffer->data + dir_len + 1, name);
+    return buffer->data;
+}
+
+#ifdef _WIN32
+// Windows 没有 openat，串行遍历，文件信息与单个文件输入一样通过 get_file_info 获取
+static int crawl_windows(const char *dir, const size_t root_length, const batch_crawl_filter_fn filter,
+                         const batch_crawl_file_fn on_file, void *user) {
+    path_buffer buffer = {0};
+    const char *search_path = join_path(&buffer, dir, "*");
+    WIN32_FIND_DATAA find_data;
+    HANDLE hFind = search_path ? FindFirstFileA(search_path, &find_data) : INVALID_HANDLE_VALUE;
+    if (hFind == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, RED "==> 无法打开目录: %s\n" RESET, dir);
+        free(buffer.data);
+        return -1;
+    }
+    int found = 0;
+    do {
+        const char *name = find_data.cFileName;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+        const int is_dir = (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        if (!is_dir && !filter(user, name)) continue;
+        const char *path = join_path(&buffer, dir, name);
+        if (!path) continue;
+        if (is_dir) {
+            char *child = strdup(path);
+            const int child_found = child ? crawl_windows(child, root_length, filter, on_file, user) : -1;
+            if (child_found > 0) found += child_found;
+            free(child);
+            continue;
+        }
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        get_file_info(path, &size, &mtime);
+        on_file(user, path, path + root_length + 1, size, mtime);
+        found++;
+    } while (FindNextFileA(hFind, &find_data) != 0);
+    FindClose(hFind);
+    free(buffer.data);
+    return found;
+}
+#else
+
+// 等待遍历的目录，fd 为 -1 时按路径打开
+typedef struct crawl_dir {
+    int fd;
+    char *path;
+    struct crawl_dir *next;
+} crawl_dir;
+
+typedef struct {
+    mutex_t mutex;
+    cond_t ready; // 栈中有目录，或遍历结束
+    crawl_dir *stack; // 后进先出，先深入子目录，排队的目录数较少
+    int busy; // 正在读取目录的线程数
+    int open_fds; // 栈中目录持有的 fd 数
+    int found;
+    size_t root_length;
+    batch_crawl_filter_fn filter;
+    batch_crawl_file_fn on_file;
+    void *user;
+} crawl_state;
+
+// 子目录入栈：fd 未达上限时相对父目录 fd 打开，否则只保存路径
+static void push_directory(crawl_state *state, const int parent_fd, const char *path, const char *name) {
+    crawl_dir *dir = malloc(sizeof(crawl_dir));
+    char *copy = strdup(path);
+    if (!dir || !copy) {
+        fprintf(stderr, RED "==> 内存分配失败，跳过目录: %s\n" RESET, path);
+        free(dir);
+        free(copy);
+        return;
+    }
+    dir->path = copy;
+    dir->fd = -1;
+
+    MUTEX_LOCK(&state->mutex);
+    const int reserve_fd = state->open_fds < BATCH_CRAWL_MAX_FDS;
+    if (reserve_fd) state->open_fds++;
+    MUTEX_UNLOCK(&state->mutex);
+    if (reserve_fd) {
+        dir->fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+
+    MUTEX_LOCK(&state->mutex);
+    if (reserve_fd && dir->fd < 0) state->open_fds--;
+    dir->next = state->stack;
+    state->stack = dir;
+    COND_SIGNAL(&state->ready);
+    MUTEX_UNLOCK(&state->mutex);
+}
+
+static void crawl_directory(crawl_state *state, crawl_dir *dir) {
+    const int fd = dir->fd >= 0 ? dir->fd : open(dir->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *d = fd >= 0 ? fdopendir(fd) : NULL;
+    if (!d) {
+        fprintf(stderr, RED "==> 无法打开目录: %s\n" RESET, dir->path);
+        if (fd >= 0) close(fd);
+        return;
+    }
+
+    const int dir_fd = dirfd(d);
+    path_buffer buffer = {0};
+    int found = 0;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        const char *name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+
+        // 部分文件系统（网络文件系统、旧版 XFS 等）不填 d_type，需要 fstatat 判断
+        int type = entry->d_type;
+        struct stat st;
+        int have_stat = 0;
+        if (type == DT_UNKNOWN) {
+            if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+            have_stat = 1;
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : S_ISLNK(st.st_mode) ? DT_LNK : 0;
+        }
+        if (type == DT_DIR) {
+            const char *path = join_path(&buffer, dir->path, name);
+            if (path) push_directory(state, dir_fd, path, name);
+            continue;
+        }
+        if ((type != DT_REG && type != DT_LNK) || !state->filter(state->user, name)) continue;
+
+        // 符号链接按指向的文件计算大小和修改时间
+        if ((!have_stat || type == DT_LNK) && fstatat(dir_fd, name, &st, 0) != 0) continue;
+        if (!S_ISREG(st.st_mode)) continue;
+        const char *path = join_path(&buffer, dir->path, name);
+        if (!path) continue;
+        state->on_file(state->user, path, path + state->root_length + 1, (uint64_t) st.st_size,
+                       (int64_t) st.st_mtime);
+        found++;
+    }
+    closedir(d);
+    free(buffer.data);
+
+    MUTEX_LOCK(&state->mutex);
+    state->found += found;
+    MUTEX_UNLOCK(&state->mutex);
+}
+
+// 遍历线程：栈空且没有线程在读取目录时结束
+static void crawl_worker(void *arg) {
+    crawl_state *state = arg;
+    MUTEX_LOCK(&state->mutex);
+    while (1) {
+        while (!state->stack && state->busy > 0) {
+            COND_WAIT(&state->ready, &state->mutex);
+        }
+        crawl_dir *dir = state->stack;
+        if (!dir) break;
+        state->stack = dir->next;
+        if (dir->fd >= 0) state->open_fds--;
+        state->busy++;
+        MUTEX_UNLOCK(&state->mutex);
+
+        crawl_directory(state, dir);
+        free(dir->path);
+        free(dir);
+
+        MUTEX_LOCK(&state->mutex);
+        if (--state->busy == 0 && !state->stack) {
+            COND_BROADCAST(&state->ready);
+        }
+    }
+    MUTEX_UNLOCK(&state->mutex);
+}
+#endif
+
+int batch_crawl(const char *root, int threads, const batch_crawl_filter_fn filter, const batch_crawl_file_fn on_file,
+                void *user) {
+#ifdef _WIN32
+    (void) threads;
+    return crawl_windows(root, strlen(root), filter, on_file, user);
+#else
+    crawl_dir *first = malloc(sizeof(crawl_dir));
+    char *path = strdup(root);
+    const int fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (!first || !path || fd < 0) {
+        fprintf(stderr, RED "==> 无法打开目录: %s\n" RESET, root);
+        free(first);
+        free(path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    *first = (crawl_dir) {fd, path, NULL};
+
+    crawl_state state = {0};
+    MUTEX_INIT(&state.mutex);
+    COND_INIT(&state.ready);
+    state.stack = first;
+    state.open_fds = 1;
+    state.root_length = strlen(root);
+    state.filter = filter;
+    state.on_file = on_file;
+    state.user = user;
+
+    if (threads <= 0) {
+        threads = get_cpu_count() < 8 ? get_cpu_count() : 8;
+    }
+    thread_pool *pool = threads > 1 ? thread_pool_create(threads) : NULL;
+    if (pool) {
+        for (int i = 0; i < threads; i++) {
+            thread_pool_submit(pool, crawl_worker, &state);
+        }
+        thread_pool_destroy(pool);
+    }
+    // 单线程或线程池创建失败时在当前线程遍历；全部提交失败时也在这里处理剩下的目录
+    crawl_worker(&state);
+
+    MUTEX_DESTROY(&state.mutex);
+    COND_DESTROY(&state.ready);
+    return state.found;
+#endif
+}
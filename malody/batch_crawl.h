@@ -0,0 +1,21 @@
+#pragma once
+#include "../includes/cross_platform.h"
+#include <stdint.h>
+
+// 批量模式的并行目录遍历：多个线程从共享的目录栈取目录，用 openat/fdopendir 相对目录 fd 读取，
+// d_type 未知时用 fstatat 判断类型。每找到一个输入文件立即回调，回调中推入流水线，
+// 遍历尚未结束时转换就已开始。符号链接指向的目录不进入，避免循环
+
+// 同时保持打开的目录 fd 上限，超过后排队的目录只保存路径，取出时再打开
+#define BATCH_CRAWL_MAX_FDS 256
+
+// 文件名是否为需要的输入，只看名称，不访问文件
+typedef int (*batch_crawl_filter_fn)(void *user, const char *name);
+// 找到输入文件：path 为完整路径，rel_path 为相对遍历根目录的路径；可在多个线程中同时调用
+typedef void (*batch_crawl_file_fn)(void *user, const char *path, const char *rel_path, uint64_t size,
+                                    int64_t mtime);
+
+// 遍历 root 下的所有子目录，threads 为 0 时使用 CPU 核心数（最多 8 个）。
+// 返回找到的文件数，无法打开 root 时返回 -1
+int batch_crawl(const char *root, int threads, batch_crawl_filter_fn filter, batch_crawl_file_fn on_file,
+                void *user);
@@ -0,0 +1,217 @@
+#include "batch_io.h"
+#include "../includes/file_utils.h"
+
+#ifdef HAVE_LIBURING
+#include <fcntl.h>
+#include <liburing.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+// 注册缓冲区的单个槽位大小，小于该大小的文件使用 READ_FIXED 读取
+#define BATCH_IO_SLOT_SIZE (256 * 1024)
+#endif
+
+struct batch_io {
+    batch_io_backend backend;
+#ifdef HAVE_LIBURING
+    struct io_uring ring;
+    char *slots; // BATCH_IO_DEPTH 个已注册的缓冲区
+    int fixed_buffers;
+#endif
+};
+
+batch_io *batch_io_create(const batch_io_backend backend) {
+    batch_io *io = calloc(1, sizeof(batch_io));
+    if (!io) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        return NULL;
+    }
+    io->backend = BATCH_IO_STDIO;
+
+#ifdef HAVE_LIBURING
+    if (backend != BATCH_IO_STDIO) {
+        const int ret = io_uring_queue_init(BATCH_IO_DEPTH, &io->ring, 0);
+        if (ret < 0) {
+            // 内核不支持或被禁用时回退到标准库
+            DEBUG_PRINT("io_uring 初始化失败 (%d)，使用标准库\n", ret);
+        } else {
+            io->backend = BATCH_IO_URING;
+            io->slots = malloc((size_t) BATCH_IO_DEPTH * BATCH_IO_SLOT_SIZE);
+            if (io->slots) {
+                struct iovec iov[BATCH_IO_DEPTH];
+                for (int i = 0; i < BATCH_IO_DEPTH; i++) {
+                    iov[i].iov_base = io->slots + (size_t) i * BATCH_IO_SLOT_SIZE;
+                    iov[i].iov_len = BATCH_IO_SLOT_SIZE;
+                }
+                io->fixed_buffers = io_uring_register_buffers(&io->ring, iov, BATCH_IO_DEPTH) == 0;
+            }
+        }
+    }
+#else
+    if (backend == BATCH_IO_URING) {
+        fprintf(stderr, YELLOW "==> 未编译 io_uring 支持，使用标准库\n" RESET);
+    }
+#endif
+    return io;
+}
+
+void batch_io_destroy(batch_io *io) {
+    if (!io) return;
+#ifdef HAVE_LIBURING
+    if (io->backend == BATCH_IO_URING) {
+        io_uring_queue_exit(&io->ring);
+    }
+    free(io->slots);
+#endif
+    free(io);
+}
+
+const char *batch_io_name(const batch_io *io) {
+    return io && io->backend == BATCH_IO_URING ? "io_uring" : "stdio";
+}
+
+static void stdio_read_files(const int count, const char **paths, char **contents, size_t *sizes) {
+    for (int i = 0; i < count; i++) {
+        contents[i] = read_file_sized(paths[i], &sizes[i]);
+    }
+}
+
+static void stdio_write_files(const int count, const char **paths, const char **data, const size_t *sizes,
+                              int *results) {
+    for (int i = 0; i < count; i++) {
+        FILE *file = fopen(paths[i], "wb");
+        results[i] = 0;
+        if (!file) continue;
+        const int ok = fwrite(data[i], 1, sizes[i], file) == sizes[i];
+        results[i] = fclose(file) == 0 && ok;
+    }
+}
+
+#ifdef HAVE_LIBURING
+// 等待 count 个请求完成，results[i] 为请求 i 的返回值
+static void uring_wait_all(batch_io *io, const int count, int *results) {
+    for (int done = 0; done < count; done++) {
+        struct io_uring_cqe *cqe;
+        if (io_uring_wait_cqe(&io->ring, &cqe) < 0) break;
+        results[(uintptr_t) io_uring_cqe_get_data(cqe)] = cqe->res;
+        io_uring_cqe_seen(&io->ring, cqe);
+    }
+}
+
+static void uring_read_files(batch_io *io, const int count, const char **paths, char **contents, size_t *sizes) {
+    int fds[BATCH_IO_DEPTH];
+    int results[BATCH_IO_DEPTH];
+    int submitted = 0;
+
+    for (int i = 0; i < count; i++) {
+        contents[i] = NULL;
+        results[i] = -1;
+        fds[i] = open(paths[i], O_RDONLY);
+        struct stat st;
+        if (fds[i] < 0 || fstat(fds[i], &st) != 0) {
+            fprintf(stderr, RED "==> 无法打开文件: %s\n" RESET, paths[i]);
+            continue;
+        }
+        sizes[i] = (size_t) st.st_size;
+        contents[i] = malloc(sizes[i] + 1);
+        if (!contents[i]) {
+            fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+            continue;
+        }
+
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&io->ring);
+        if (io->fixed_buffers && sizes[i] <= BATCH_IO_SLOT_SIZE) {
+            io_uring_prep_read_fixed(sqe, fds[i], io->slots + (size_t) i * BATCH_IO_SLOT_SIZE,
+                                     (unsigned) sizes[i], 0, i);
+        } else {
+            io_uring_prep_read(sqe, fds[i], contents[i], (unsigned) sizes[i], 0);
+        }
+        io_uring_sqe_set_data(sqe, (void *) (uintptr_t) i);
+        submitted++;
+    }
+
+    // 一次系统调用提交整批读取请求
+    io_uring_submit(&io->ring);
+    uring_wait_all(io, submitted, results);
+
+    for (int i = 0; i < count; i++) {
+        if (contents[i]) {
+            size_t done = results[i] > 0 ? (size_t) results[i] : 0;
+            if (results[i] >= 0 && io->fixed_buffers && sizes[i] <= BATCH_IO_SLOT_SIZE) {
+                memcpy(contents[i], io->slots + (size_t) i * BATCH_IO_SLOT_SIZE, done);
+            }
+            // 读取不完整时用 pread 补齐
+            while (results[i] >= 0 && done < sizes[i]) {
+                const ssize_t n = pread(fds[i], contents[i] + done, sizes[i] - done, (off_t) done);
+                if (n <= 0) break;
+                done += (size_t) n;
+            }
+            if (results[i] < 0 || done != sizes[i]) {
+                fprintf(stderr, RED "==> 读取文件失败: %s\n" RESET, paths[i]);
+                free(contents[i]);
+                contents[i] = NULL;
+            } else {
+                contents[i][sizes[i]] = '\0';
+            }
+        }
+        if (fds[i] >= 0) close(fds[i]);
+    }
+}
+
+static void uring_write_files(batch_io *io, const int count, const char **paths, const char **data,
+                              const size_t *sizes, int *results) {
+    int fds[BATCH_IO_DEPTH];
+    int submitted = 0;
+
+    for (int i = 0; i < count; i++) {
+        results[i] = -1;
+        fds[i] = open(paths[i], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fds[i] < 0) continue;
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&io->ring);
+        io_uring_prep_write(sqe, fds[i], data[i], (unsigned) sizes[i], 0);
+        io_uring_sqe_set_data(sqe, (void *) (uintptr_t) i);
+        submitted++;
+    }
+
+    io_uring_submit(&io->ring);
+    uring_wait_all(io, submitted, results);
+
+    for (int i = 0; i < count; i++) {
+        if (fds[i] < 0) {
+            results[i] = 0;
+            continue;
+        }
+        size_t done = results[i] > 0 ? (size_t) results[i] : 0;
+        // 写入不完整时用 pwrite 补齐
+        while (results[i] >= 0 && done < sizes[i]) {
+            const ssize_t n = pwrite(fds[i], data[i] + done, sizes[i] - done, (off_t) done);
+            if (n <= 0) break;
+            done += (size_t) n;
+        }
+        results[i] = close(fds[i]) == 0 && done == sizes[i];
+    }
+}
+#endif
+
+void batch_io_read_files(batch_io *io, const int count, const char **paths, char **contents, size_t *sizes) {
+#ifdef HAVE_LIBURING
+    if (io && io->backend == BATCH_IO_URING) {
+        uring_read_files(io, count, paths, contents, sizes);
+        return;
+    }
+#endif
+    (void) io;
+    stdio_read_files(count, paths, contents, sizes);
+}
+
+void batch_io_write_files(batch_io *io, const int count, const char **paths, const char **data, const size_t *sizes,
+                          int *results) {
+#ifdef HAVE_LIBURING
+    if (io && io->backend == BATCH_IO_URING) {
+        uring_write_files(io, count, paths, data, sizes, results);
+        return;
+    }
+#endif
+    (void) io;
+    stdio_write_files(count, paths, data, sizes, results);
+}
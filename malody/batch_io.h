@@ -0,0 +1,25 @@
+#pragma once
+#include "../includes/cross_platform.h"
+
+// 批量模式的文件读写后端：Linux 上可使用 io_uring 同时提交多个请求，否则使用标准库
+typedef enum {
+    BATCH_IO_AUTO,
+    BATCH_IO_STDIO,
+    BATCH_IO_URING,
+} batch_io_backend;
+
+// 一次最多同时提交的请求数
+#define BATCH_IO_DEPTH 32
+
+typedef struct batch_io batch_io;
+
+// 每个工作线程各自创建，io_uring 不可用时自动回退到标准库
+batch_io *batch_io_create(batch_io_backend backend);
+void batch_io_destroy(batch_io *io);
+const char *batch_io_name(const batch_io *io);
+
+// 批量读取文件（count 不超过 BATCH_IO_DEPTH），失败的文件 contents[i] 为 NULL
+void batch_io_read_files(batch_io *io, int count, const char **paths, char **contents, size_t *sizes);
+// 批量写入文件，results[i] 为 1 表示成功
+void batch_io_write_files(batch_io *io, int count, const char **paths, const char **data, const size_t *sizes,
+                          int *results);
@@ -0,0 +1,181 @@
+#include "batch_journal.h"
+#include "../includes/file_utils.h"
+
+#include <inttypes.h>
+
+static const char *status_names[] = {"pending", "done", "failed"};
+
+uint64_t batch_journal_hash(const void *data, const size_t size) {
+    const unsigned char *bytes = data;
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static size_t path_slot(const batch_journal *journal, const char *rel_path) {
+    return (size_t) batch_journal_hash(rel_path, strlen(rel_path)) & (journal->slot_count - 1);
+}
+
+static void entry_free(batch_journal_entry *entry) {
+    free(entry->rel_path);
+    free(entry->output);
+}
+
+static int grow_slots(batch_journal *journal) {
+    const size_t old_count = journal->slot_count;
+    batch_journal_entry *old_slots = journal->slots;
+    const size_t new_count = old_count ? old_count * 2 : 1024;
+    batch_journal_entry *slots = calloc(new_count, sizeof(batch_journal_entry));
+    if (!slots) return 0;
+    journal->slots = slots;
+    journal->slot_count = new_count;
+    for (size_t i = 0; i < old_count; i++) {
+        if (!old_slots[i].rel_path) continue;
+        size_t slot = path_slot(journal, old_slots[i].rel_path);
+        while (slots[slot].rel_path) slot = (slot + 1) & (new_count - 1);
+        slots[slot] = old_slots[i];
+    }
+    free(old_slots);
+    return 1;
+}
+
+// 记录回放表，同一路径后出现的行覆盖先出现的行（接管 entry 中字符串的所有权）
+static int replay_put(batch_journal *journal, batch_journal_entry *entry) {
+    if ((journal->entry_count + 1) * 2 > journal->slot_count && !grow_slots(journal)) {
+        return 0;
+    }
+    size_t slot = path_slot(journal, entry->rel_path);
+    while (journal->slots[slot].rel_path && strcmp(journal->slots[slot].rel_path, entry->rel_path) != 0) {
+        slot = (slot + 1) & (journal->slot_count - 1);
+    }
+    if (journal->slots[slot].rel_path) {
+        entry_free(&journal->slots[slot]);
+    } else {
+        journal->entry_count++;
+    }
+    journal->slots[slot] = *entry;
+    return 1;
+}
+
+// 解析一行，字段不全时返回 0
+static int parse_line(char *line, batch_journal_entry *entry) {
+    // 最后一个字段（输出目录）取到行尾
+    char *fields[8];
+    fields[0] = line;
+    for (int i = 1; i < 8; i++) {
+        char *tab = strchr(fields[i - 1], '\t');
+        if (!tab) return 0;
+        *tab = '\0';
+        fields[i] = tab + 1;
+    }
+
+    int status = -1;
+    for (int i = 0; i < (int) (sizeof(status_names) / sizeof(status_names[0])); i++) {
+        if (strcmp(fields[0], status_names[i]) == 0) status = i;
+    }
+    if (status < 0) return 0;
+    entry->status = (batch_journal_status) status;
+    entry->hash = strtoull(fields[1], NULL, 16);
+    entry->size = strtoull(fields[2], NULL, 10);
+    entry->mtime = strtoll(fields[3], NULL, 10);
+    entry->attempts = atoi(fields[4]);
+    entry->outputs = atoi(fields[5]);
+    entry->rel_path = strdup(fields[6]);
+    entry->output = strdup(fields[7]);
+    if (!entry->rel_path || !entry->output) {
+        entry_free(entry);
+        return 0;
+    }
+    return 1;
+}
+
+// 回放已有日志，torn 返回末尾是否有写了一半的行
+static int replay(batch_journal *journal, const char *path, int *torn) {
+    if (!get_file_info(path, NULL, NULL)) {
+        return 1; // 第一次运行，没有日志
+    }
+    size_t size;
+    char *content = read_file_sized(path, &size);
+    if (!content) return 0;
+
+    int lines = 0;
+    char *line = content;
+    char *newline;
+    // 没有换行结尾的最后一行是中断时写了一半的记录
+    while ((newline = memchr(line, '\n', size - (size_t) (line - content))) != NULL) {
+        *newline = '\0';
+        batch_journal_entry entry = {0};
+        if (parse_line(line, &entry)) {
+            if (!replay_put(journal, &entry)) {
+                entry_free(&entry);
+                free(content);
+                fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+                return 0;
+            }
+            lines++;
+        } else if (*line) {
+            fprintf(stderr, YELLOW "==> 忽略无法解析的日志行: %.80s\n" RESET, line);
+        }
+        line = newline + 1;
+    }
+    *torn = line != content + size;
+    free(content);
+    printf(BLUE " -> 回放日志: %d 行, %zu 个输入\n" RESET, lines, journal->entry_count);
+    return 1;
+}
+
+int batch_journal_open(batch_journal *journal, const char *path, const int resume) {
+    memset(journal, 0, sizeof(batch_journal));
+    int torn = 0;
+    if (resume && !replay(journal, path, &torn)) {
+        batch_journal_close(journal);
+        return 0;
+    }
+    journal->file = fopen(path, resume ? "ab" : "wb");
+    if (!journal->file) {
+        fprintf(stderr, RED "==> 无法打开日志文件: %s\n" RESET, path);
+        batch_journal_close(journal);
+        return 0;
+    }
+    if (torn) {
+        fputc('\n', journal->file); // 结束残缺的行，避免与新记录拼在一起
+    }
+    MUTEX_INIT(&journal->mutex);
+    return 1;
+}
+
+void batch_journal_close(batch_journal *journal) {
+    if (journal->file) {
+        fclose(journal->file);
+        MUTEX_DESTROY(&journal->mutex);
+    }
+    for (size_t i = 0; i < journal->slot_count; i++) {
+        if (journal->slots[i].rel_path) entry_free(&journal->slots[i]);
+    }
+    free(journal->slots);
+    memset(journal, 0, sizeof(batch_journal));
+}
+
+const batch_journal_entry *batch_journal_find(const batch_journal *journal, const char *rel_path) {
+    if (journal->entry_count == 0) return NULL;
+    size_t slot = path_slot(journal, rel_path);
+    while (journal->slots[slot].rel_path) {
+        if (strcmp(journal->slots[slot].rel_path, rel_path) == 0) return &journal->slots[slot];
+        slot = (slot + 1) & (journal->slot_count - 1);
+    }
+    return NULL;
+}
+
+void batch_journal_append(batch_journal *journal, const batch_journal_entry *entry) {
+    if (!journal->file) return; // 未打开日志（统计模式）时不记录
+    MUTEX_LOCK(&journal->mutex);
+    // 整行一次写出再刷新，进程被杀时最多留下一行不完整的记录
+    fprintf(journal->file, "%s\t%016" PRIx64 "\t%" PRIu64 "\t%" PRId64 "\t%d\t%d\t%s\t%s\n",
+            status_names[entry->status], entry->hash, entry->size, entry->mtime, entry->attempts, entry->outputs,
+            entry->rel_path, entry->output ? entry->output : "");
+    fflush(journal->file);
+    MUTEX_UNLOCK(&journal->mutex);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "../includes/cross_platform.h"
+#include <stdint.h>
+
+// 批量模式的任务日志：每个输入文件处理完成后追加一行，中断后用 --resume 跳过已完成且未改动的输入。
+// 每行以制表符分隔: 状态 内容哈希 大小 修改时间 尝试次数 输出数 相对路径 输出目录
+// 同一输入以最后一行为准，末尾写了一半的行在回放时忽略
+
+// 开始读取某个输入时记一次 PENDING。续跑时上次仍为 PENDING 的输入单独处理，
+// 尝试次数超过 1 说明单独处理时进程也中断了；达到这个次数的输入视为会导致崩溃，续跑时跳过
+#define BATCH_JOURNAL_MAX_ATTEMPTS 2
+
+typedef enum {
+    BATCH_JOURNAL_PENDING, // 已开始处理，尚未完成
+    BATCH_JOURNAL_DONE, // 全部谱面转换成功（或没有需要转换的谱面）
+    BATCH_JOURNAL_FAILED, // 至少一个谱面转换失败，续跑时重试
+} batch_journal_status;
+
+typedef struct {
+    char *rel_path;
+    batch_journal_status status;
+    uint64_t hash;
+    uint64_t size;
+    int64_t mtime;
+    int attempts;
+    int outputs;
+    char *output;
+} batch_journal_entry;
+
+typedef struct {
+    FILE *file;
+    mutex_t mutex;
+    // 回放得到的记录，按相对路径开放寻址；打开后只读，多线程查询不需要加锁
+    batch_journal_entry *slots;
+    size_t slot_count;
+    size_t entry_count;
+} batch_journal;
+
+// 打开日志：resume 为 1 时先回放已有记录再追加，否则清空重新开始
+int batch_journal_open(batch_journal *journal, const char *path, int resume);
+void batch_journal_close(batch_journal *journal);
+// 查找输入上一次运行的记录，没有时返回 NULL
+const batch_journal_entry *batch_journal_find(const batch_journal *journal, const char *rel_path);
+// 追加一行并刷新到系统缓冲区
+void batch_journal_append(batch_journal *journal, const batch_journal_entry *entry);
+// 输入内容的哈希 (FNV-1a 64)
+uint64_t batch_journal_hash(const void *data, size_t size);
@@ -0,0 +1,367 @@
+#include "batch_shard.h"
+#include "../includes/file_utils.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+#define MANIFEST_PREFIX ".blophy-shard-"
+#define MANIFEST_SUFFIX ".manifest"
+
+int batch_parse_shard(const char *spec, int *index, int *count) {
+    int i, n;
+    char extra;
+    if (sscanf(spec, "%d/%d%c", &i, &n, &extra) != 2 || n < 1 || i < 1 || i > n) {
+        fprintf(stderr, RED "==> 无效的分片配置: %s（格式为 i/N，1 <= i <= N）\n" RESET, spec);
+        return 0;
+    }
+    *index = i;
+    *count = n;
+    return 1;
+}
+
+int batch_shard_of(const char *rel_path, const int shard_count) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char *) rel_path; *p; p++) {
+        hash ^= *p == '\\' ? '/' : *p;
+        hash *= 1099511628211ULL;
+    }
+    return (int) (hash % (uint64_t) shard_count);
+}
+
+void batch_manifest_path(const char *output_dir, const int index, const int count, char *path, const size_t size) {
+    snprintf(path, size, "%s%c" MANIFEST_PREFIX "%d-of-%d" MANIFEST_SUFFIX, output_dir, PATH_SEPARATOR, index, count);
+}
+
+void batch_manifest_init(batch_manifest *manifest) {
+    memset(manifest, 0, sizeof(batch_manifest));
+    MUTEX_INIT(&manifest->mutex);
+}
+
+static void entries_free(batch_manifest_entry *entries, const int count) {
+    for (int i = 0; i < count; i++) {
+        free(entries[i].rel_path);
+        free(entries[i].output);
+    }
+    free(entries);
+}
+
+void batch_manifest_free(batch_manifest *manifest) {
+    entries_free(manifest->entries, manifest->count);
+    MUTEX_DESTROY(&manifest->mutex);
+    memset(manifest, 0, sizeof(batch_manifest));
+}
+
+// 复制路径并把分隔符统一为 '/'
+static char *portable_path(const char *path) {
+    char *copy = strdup(path);
+    if (copy) {
+        for (char *p = copy; *p; p++) {
+            if (*p == '\\') *p = '/';
+        }
+    }
+    return copy;
+}
+
+int batch_manifest_add(batch_manifest *manifest, const char *rel_path, const char *output, const int outputs,
+                       const batch_journal_status status) {
+    batch_manifest_entry entry = {portable_path(rel_path), portable_path(output), outputs, status};
+    if (!entry.rel_path || !entry.output) {
+        free(entry.rel_path);
+        free(entry.output);
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        return 0;
+    }
+    MUTEX_LOCK(&manifest->mutex);
+    if (manifest->count == manifest->capacity) {
+        const int capacity = manifest->capacity ? manifest->capacity * 2 : 256;
+        batch_manifest_entry *grown = realloc(manifest->entries, (size_t) capacity * sizeof(batch_manifest_entry));
+        if (!grown) {
+            MUTEX_UNLOCK(&manifest->mutex);
+            free(entry.rel_path);
+            free(entry.output);
+            fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+            return 0;
+        }
+        manifest->entries = grown;
+        manifest->capacity = capacity;
+    }
+    manifest->entries[manifest->count++] = entry;
+    MUTEX_UNLOCK(&manifest->mutex);
+    return 1;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const batch_manifest_entry *) a)->rel_path, ((const batch_manifest_entry *) b)->rel_path);
+}
+
+int batch_manifest_write(batch_manifest *manifest, const char *path, const int index, const int count) {
+    qsort(manifest->entries, (size_t) manifest->count, sizeof(batch_manifest_entry), compare_entries);
+    char temp_path[1100];
+    FILE *file = atomic_file_open(path, temp_path, sizeof(temp_path));
+    if (!file) {
+        fprintf(stderr, RED "==> 无法写入分片清单: %s\n" RESET, path);
+        return 0;
+    }
+    fprintf(file, "# blophy shard %d/%d\n", index, count);
+    for (int i = 0; i < manifest->count; i++) {
+        const batch_manifest_entry *entry = &manifest->entries[i];
+        fprintf(file, "%s\t%d\t%s\t%s\n", entry->status == BATCH_JOURNAL_DONE ? "done" : "failed", entry->outputs,
+                entry->rel_path, entry->output);
+    }
+    if (!atomic_file_commit(file, temp_path, path, 1)) {
+        fprintf(stderr, RED "==> 无法写入分片清单: %s\n" RESET, path);
+        return 0;
+    }
+    printf(BLUE "==> 分片 %d/%d 清单: %s (%d 个输入)\n" RESET, index, count, path, manifest->count);
+    return 1;
+}
+
+// 合并时读到的一条记录
+typedef struct {
+    batch_manifest_entry entry;
+    int shard;
+} merge_entry;
+
+typedef struct {
+    merge_entry *entries;
+    int count;
+    int capacity;
+    int shard_count; // 第一份清单的 N，各清单必须一致
+    int *seen_shards; // 每个分片出现的清单数
+    int errors;
+} merge_state;
+
+static int merge_add(merge_state *state, const char *line, const int shard) {
+    char *copy = strdup(line);
+    if (!copy) return 0;
+    char *fields[4];
+    fields[0] = copy;
+    for (int i = 1; i < 4; i++) {
+        char *tab = strchr(fields[i - 1], '\t');
+        if (!tab) {
+            free(copy);
+            return -1;
+        }
+        *tab = '\0';
+        fields[i] = tab + 1;
+    }
+    if (state->count == state->capacity) {
+        const int capacity = state->capacity ? state->capacity * 2 : 1024;
+        merge_entry *grown = realloc(state->entries, (size_t) capacity * sizeof(merge_entry));
+        if (!grown) {
+            free(copy);
+            return 0;
+        }
+        state->entries = grown;
+        state->capacity = capacity;
+    }
+    merge_entry *entry = &state->entries[state->count];
+    entry->entry.status = strcmp(fields[0], "done") == 0 ? BATCH_JOURNAL_DONE : BATCH_JOURNAL_FAILED;
+    entry->entry.outputs = atoi(fields[1]);
+    entry->entry.rel_path = strdup(fields[2]);
+    entry->entry.output = strdup(fields[3]);
+    entry->shard = shard;
+    free(copy);
+    if (!entry->entry.rel_path || !entry->entry.output) {
+        free(entry->entry.rel_path);
+        free(entry->entry.output);
+        return 0;
+    }
+    state->count++;
+    return 1;
+}
+
+static int merge_read(merge_state *state, const char *path) {
+    size_t size;
+    char *content = read_file_sized(path, &size);
+    if (!content) return 0;
+
+    int index, count;
+    char *line = content;
+    char *newline = strchr(line, '\n');
+    if (!newline || sscanf(line, "# blophy shard %d/%d", &index, &count) != 2 || index < 1 || index > count) {
+        fprintf(stderr, RED "==> 无效的分片清单: %s\n" RESET, path);
+        free(content);
+        return 0;
+    }
+    if (state->shard_count == 0) {
+        state->shard_count = count;
+        state->seen_shards = calloc((size_t) count, sizeof(int));
+        if (!state->seen_shards) {
+            free(content);
+            return 0;
+        }
+    } else if (count != state->shard_count) {
+        fprintf(stderr, RED "==> 分片数量不一致: %s 为 %d，其他清单为 %d\n" RESET, path, count, state->shard_count);
+        free(content);
+        return 0;
+    }
+    state->seen_shards[index - 1]++;
+
+    for (line = newline + 1; (newline = strchr(line, '\n')) != NULL; line = newline + 1) {
+        *newline = '\0';
+        const int added = merge_add(state, line, index - 1);
+        if (added == 0) {
+            fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+            free(content);
+            return 0;
+        }
+        if (added < 0) {
+            fprintf(stderr, RED "==> 无效的清单行: %s: %.80s\n" RESET, path, line);
+            state->errors++;
+        }
+    }
+    free(content);
+    return 1;
+}
+
+static int is_manifest_name(const char *name) {
+    const size_t len = strlen(name);
+    const size_t prefix = strlen(MANIFEST_PREFIX), suffix = strlen(MANIFEST_SUFFIX);
+    return len > prefix + suffix && strncmp(name, MANIFEST_PREFIX, prefix) == 0 &&
+           strcmp(name + len - suffix, MANIFEST_SUFFIX) == 0;
+}
+
+// 读取输出目录中的全部清单
+static int merge_read_all(merge_state *state, const char *output_dir) {
+    int found = 0;
+#ifdef _WIN32
+    WIN32_FIND_DATAA find_data;
+    char search_path[1024];
+    snprintf(search_path, sizeof(search_path), "%s%c" MANIFEST_PREFIX "*", output_dir, PATH_SEPARATOR);
+    HANDLE hFind = FindFirstFileA(search_path, &find_data);
+    if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+            const char *name = find_data.cFileName;
+#else
+    DIR *d = opendir(output_dir);
+    if (d) {
+        struct dirent *dir_entry;
+        while ((dir_entry = readdir(d)) != NULL) {
+            const char *name = dir_entry->d_name;
+#endif
+            if (!is_manifest_name(name)) continue;
+            char path[1024];
+            snprintf(path, sizeof(path), "%s%c%s", output_dir, PATH_SEPARATOR, name);
+            if (!merge_read(state, path)) {
+                state->errors++;
+            }
+            found++;
+#ifdef _WIN32
+        } while (FindNextFileA(hFind, &find_data) != 0);
+        FindClose(hFind);
+    }
+#else
+        }
+        closedir(d);
+    }
+#endif
+    return found;
+}
+
+static int compare_merge_entries(const void *a, const void *b) {
+    return compare_entries(&((const merge_entry *) a)->entry, &((const merge_entry *) b)->entry);
+}
+
+static int compare_strings(const void *a, const void *b) {
+    return strcmp(*(const char *const *) a, *(const char *const *) b);
+}
+
+// 检查排序后的记录：重复、分片归属、失败和缺失的输出
+static void merge_check_entries(merge_state *state, const char *output_dir) {
+    for (int i = 0; i < state->count; i++) {
+        const merge_entry *entry = &state->entries[i];
+        if (i > 0 && strcmp(entry->entry.rel_path, state->entries[i - 1].entry.rel_path) == 0) {
+            fprintf(stderr, RED "==> 输入被转换了多次: %s (分片 %d 和 %d)\n" RESET, entry->entry.rel_path,
+                    state->entries[i - 1].shard + 1, entry->shard + 1);
+            state->errors++;
+            continue;
+        }
+        const int expected = batch_shard_of(entry->entry.rel_path, state->shard_count);
+        if (expected != entry->shard) {
+            fprintf(stderr, RED "==> 输入不属于所在分片: %s (分片 %d，应为 %d)\n" RESET, entry->entry.rel_path,
+                    entry->shard + 1, expected + 1);
+            state->errors++;
+        }
+        if (entry->entry.status != BATCH_JOURNAL_DONE) {
+            fprintf(stderr, RED "==> 输入转换失败: %s (分片 %d)\n" RESET, entry->entry.rel_path, entry->shard + 1);
+            state->errors++;
+            continue;
+        }
+        if (entry->entry.outputs > 0) {
+            char path[1024];
+            snprintf(path, sizeof(path), "%s%c%s", output_dir, PATH_SEPARATOR, entry->entry.output);
+            for (char *p = path; *p; p++) {
+                if (*p == '/') *p = PATH_SEPARATOR;
+            }
+            if (!get_file_info(path, NULL, NULL)) {
+                fprintf(stderr, RED "==> 缺少输出: %s (分片 %d)\n" RESET, path, entry->shard + 1);
+                state->errors++;
+            }
+        }
+    }
+}
+
+// 检查每个输入都出现在某个清单中
+static void merge_check_inputs(merge_state *state, const char *const *inputs, const int input_count) {
+    char **sorted = malloc((size_t) (input_count > 0 ? input_count : 1) * sizeof(char *));
+    if (!sorted) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        state->errors++;
+        return;
+    }
+    int count = 0;
+    for (int i = 0; i < input_count; i++) {
+        if ((sorted[count] = portable_path(inputs[i])) != NULL) count++;
+    }
+    qsort(sorted, (size_t) count, sizeof(char *), compare_strings);
+    // 两个有序序列归并比较
+    int e = 0;
+    for (int i = 0; i < count; i++) {
+        int cmp = -1;
+        while (e < state->count && (cmp = strcmp(state->entries[e].entry.rel_path, sorted[i])) < 0) e++;
+        if (e >= state->count || cmp != 0) {
+            fprintf(stderr, RED "==> 输入没有被任何分片转换: %s (应属于分片 %d)\n" RESET, sorted[i],
+                    batch_shard_of(sorted[i], state->shard_count) + 1);
+            state->errors++;
+        }
+    }
+    for (int i = 0; i < count; i++) free(sorted[i]);
+    free(sorted);
+}
+
+int batch_manifest_merge(const char *output_dir, const char *const *inputs, const int input_count) {
+    merge_state state = {0};
+    const int found = merge_read_all(&state, output_dir);
+    if (found == 0) {
+        fprintf(stderr, RED "==> 输出目录中没有分片清单: %s\n" RESET, output_dir);
+        return 0;
+    }
+    for (int i = 0; i < state.shard_count; i++) {
+        if (state.seen_shards[i] != 1) {
+            fprintf(stderr, RED "==> 分片 %d/%d 的清单%s\n" RESET, i + 1, state.shard_count,
+                    state.seen_shards[i] == 0 ? "缺失" : "重复");
+            state.errors++;
+        }
+    }
+
+    qsort(state.entries, (size_t) state.count, sizeof(merge_entry), compare_merge_entries);
+    merge_check_entries(&state, output_dir);
+    if (inputs) {
+        merge_check_inputs(&state, inputs, input_count);
+    }
+
+    int outputs = 0;
+    for (int i = 0; i < state.count; i++) {
+        outputs += state.entries[i].entry.outputs;
+        free(state.entries[i].entry.rel_path);
+        free(state.entries[i].entry.output);
+    }
+    printf(state.errors == 0 ? GREEN "==> 合并检查完成: %d 个分片, %d 个输入, %d 个输出, %d 个问题\n" RESET
+                             : RED "==> 合并检查完成: %d 个分片, %d 个输入, %d 个输出, %d 个问题\n" RESET,
+           state.shard_count, state.count, outputs, state.errors);
+    free(state.entries);
+    free(state.seen_shards);
+    return state.errors == 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "../includes/cross_platform.h"
+#include "batch_journal.h"
+
+// 多台机器分片批量转换：按相对路径的哈希把输入分到 N 个分片，各分片互不通信。
+// 每个分片结束时在输出目录写一份清单，列出本分片的输入、输出目录和结果，
+// 合并检查读取全部清单，确认每个输入恰好由一个分片转换成功
+
+typedef struct {
+    char *rel_path; // 以 '/' 分隔
+    char *output; // 相对输出目录，以 '/' 分隔
+    int outputs; // 生成的 Chart.json 数量
+    batch_journal_status status;
+} batch_manifest_entry;
+
+typedef struct {
+    mutex_t mutex;
+    batch_manifest_entry *entries;
+    int count;
+    int capacity;
+} batch_manifest;
+
+// 解析 "i/N"，i 从 1 开始
+int batch_parse_shard(const char *spec, int *index, int *count);
+// 输入所属的分片（从 0 开始），路径分隔符统一按 '/' 计算，不同平台结果相同
+int batch_shard_of(const char *rel_path, int shard_count);
+// 清单文件路径 <输出目录>/.blophy-shard-<i>-of-<N>.manifest
+void batch_manifest_path(const char *output_dir, int index, int count, char *path, size_t size);
+
+void batch_manifest_init(batch_manifest *manifest);
+void batch_manifest_free(batch_manifest *manifest);
+// 记录一个输入的结果，可多线程调用
+int batch_manifest_add(batch_manifest *manifest, const char *rel_path, const char *output, int outputs,
+                       batch_journal_status status);
+// 按相对路径排序后原子写入
+int batch_manifest_write(batch_manifest *manifest, const char *path, int index, int count);
+
+// 合并检查输出目录中的全部清单：分片齐全、每个输入只出现一次、全部成功且输出存在；
+// inputs 不为 NULL 时还检查每个输入都出现在某个清单中。全部通过返回 1
+int batch_manifest_merge(const char *output_dir, const char *const *inputs, int input_count);
@@ -1,78 +1,49 @@
 #include "../includes/cross_platform.h"
 #include "convert.h"
+#include "../includes/thread_pool.h"
+#include "../includes/chart_validate.h"
+#include "../includes/trace.h"
+#include "batch.h"
+#include "batch_shard.h"
 
 // 帮助信息
 void print_help(const char *program_name) {
     printf("用法: %s [选项]\n", program_name);
     printf("选项:\n");
     printf("  -f <文件路径>       指定输入的 .mc 文件路径\n");
-    printf("  -o <输出路径>       指定输出的 Chart.json 文件路径\n");
-    printf("  -z                  指定处理 .mcz 文件（将解压并处理其中的 .mc 文件）\n");
+    printf("  -o <输出路径>       指定输出的 Chart.json 文件路径，\"-\" 表示标准输出\n");
+    printf("  -z                  指定处理 .mcz 文件（将解压并处理其中的 .mc 文件，配合 -p 时不解压）\n");
+    printf("  -j <线程数>         指定解压 .mcz 使用的线程数（默认为 CPU 核心数）\n");
+    printf("  -b <输入路径>       批量转换目录下所有 .mc/.mcz 文件或单个谱面包，输出到 -o 指定的目录\n");
+    printf("  --stage-workers <配置>  批量模式各阶段线程数，如 load=2,parse=4,convert=4,serialize=2,write=2；\n");
+    printf("                          discover 为并行遍历输入目录的线程数\n");
+    printf("  --queue-depth <数量>    批量模式阶段之间队列的容量（默认 64）\n");
+    printf("  --io <后端>         批量模式的读写后端: auto、stdio 或 uring（默认 auto）\n");
+    printf("  --metrics <文件>    批量模式定期把运行指标写成 Prometheus textfile\n");
+    printf("  --metrics-interval <秒>  指标输出间隔（默认 10 秒）\n");
+    printf("  --trace <文件>      把各线程处理每个文件的时间线写成 Chrome Trace JSON（可用 Perfetto 查看）\n");
+    printf("  --no-fsync          批量模式不等待输出落盘（仍使用临时文件加重命名）\n");
+    printf("  --resume            批量模式跳过任务日志中已完成且未改动的输入\n");
+    printf("  --retry-crashed     同 --resume，并重试之前单独处理时进程中断而跳过的输入（保留任务日志）\n");
+    printf("  --journal <文件>    批量模式的任务日志（默认为输出目录下的 %s）\n", BATCH_JOURNAL_NAME);
+    printf("  --shard <i/N>       批量模式只转换第 i 个分片（共 N 个），结束时在输出目录写入分片清单\n");
+    printf("  --merge-shards      检查 -o 目录中各分片的清单；指定 -b 时同时检查每个输入都已转换\n");
+    printf("  -p <包路径>         同时生成 Blophy 谱面包（需配合 -z，音频和图片直接从 .mcz 复制）\n");
+    printf("  -n                  NDJSON 模式：标准输入每行一个谱面，按顺序输出到编号文件，\n");
+    printf("                      -o - 时逐行写入标准输出（解析失败的行输出 null）\n");
+    printf("  --preview <秒>      只输出开头这么多秒的预览谱面（完整 bpmList 和 offset），不探测音频时长\n");
+    printf("  --job-timeout <秒>  批量模式单个谱面的处理时间预算，超出时记为失败\n");
+    printf("  --job-memory <MB>   批量模式单个谱面的内存预算（输入、解压后的谱面和中间数据）\n");
+    printf("  --archive-limit <MB>  批量模式 .mcz 中谱面解压后的总大小上限，解压前检查\n");
+    printf("  --isolate           批量模式在子进程中处理每个谱面，用 rlimit 限制内存和 CPU 时间，崩溃只影响该谱面\n");
+    printf("  --compress <格式>   输出 gzip 或 zlib 压缩的 Chart.json（文件名追加 .gz / .zz），序列化时直接压缩\n");
+    printf("  --compress-level <级别>  压缩级别 0-9（默认 %d）\n", MZ_DEFAULT_LEVEL);
+    printf("  --analyze <格式>    只统计 -b 或 -f 指定的谱面（note 数量、BPM、时长、密度峰值和谱面信息），\n");
+    printf("                      不输出 Chart.json；每个谱面输出一行 json 或 csv 到 -o 指定的文件（默认标准输出）\n");
+    printf("  --validate <文件>   校验 Chart.json 文件后退出\n");
     printf("  -h                  显示帮助信息\n");
 }
 
-// ANSI 颜色支持在 Windows 上
-#ifdef _WIN32
-void enable_ansi_colors() {
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    if (hOut == INVALID_HANDLE_VALUE) return;
-
-    DWORD dwMode = 0;
-    if (!GetConsoleMode(hOut, &dwMode)) return;
-
-    dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-    SetConsoleMode(hOut, dwMode);
-}
-#else
-void enable_ansi_colors() {
-}
-#endif
-
-// 读取文件内容
-char *read_file(const char *filename) {
-    DEBUG_PRINT("读取文件: %s\n", filename);
-    FILE *file = fopen(filename, "rb"); // Open in binary mode for cross-platform compatibility
-    if (!file) {
-        fprintf(stderr, RED "==> 无法打开文件: %s\n" RESET, filename);
-        return NULL;
-    }
-
-    fseek(file, 0, SEEK_END);
-    long length = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    char *content = malloc(length + 1);
-    if (!content) {
-        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
-        fclose(file);
-        return NULL;
-    }
-
-    size_t read_len = fread(content, 1, length, file);
-    if (read_len != length) {
-        fprintf(stderr, RED "==> 读取文件失败: %s\n" RESET, filename);
-        free(content);
-        fclose(file);
-        return NULL;
-    }
-
-    content[length] = '\0';
-    fclose(file);
-
-    DEBUG_PRINT("文件读取成功，大小: %ld 字节\n", length);
-    return content;
-}
-
-// 获取绝对路径
-int get_absolute_path(const char *path, char *abs_path) {
-    DEBUG_PRINT("获取绝对路径: %s\n", path);
-    if (!GET_ABS_PATH(path, abs_path)) {
-        fprintf(stderr, RED "==> 无法获取绝对路径: %s\n" RESET, path);
-        return 0;
-    }
-    return 1;
-}
-
 // 创建目录
 int create_directory_if_not_exists(const char *path) {
     struct stat st = {0};
@@ -88,9 +59,71 @@ int create_directory_if_not_exists(const char *path) {
     return 1;
 }
 
-// 解压 .mcz 文件
-int unzip_mcz(const char *mcz_path, const char *output_dir) {
+// 待解压的文件条目
+typedef struct {
+    unsigned int index;
+    mz_uint64 size;
+    char output_path[1024];
+} unzip_entry;
+
+// 多线程解压的共享状态
+typedef struct {
+    const char *mcz_path;
+    unzip_entry *entries;
+    int entry_count;
+    int next_entry;
+    int failed;
+    mutex_t mutex;
+} unzip_job;
+
+// 按解压后大小从大到小排序，先分配大文件
+static int compare_unzip_entry(const void *a, const void *b) {
+    const mz_uint64 size_a = ((const unzip_entry *) a)->size;
+    const mz_uint64 size_b = ((const unzip_entry *) b)->size;
+    return (size_a < size_b) - (size_a > size_b);
+}
+
+// 解压线程：每个线程使用独立的 mz_zip_archive 读取器
+static void unzip_worker(void *arg) {
+    unzip_job *job = arg;
+    mz_zip_archive zip_archive = {0};
+    if (!mz_zip_reader_init_file(&zip_archive, job->mcz_path, 0)) {
+        fprintf(stderr, RED "==> 无法打开 .mcz 文件: %s\n" RESET, job->mcz_path);
+        MUTEX_LOCK(&job->mutex);
+        job->failed = 1;
+        MUTEX_UNLOCK(&job->mutex);
+        return;
+    }
+
+    while (1) {
+        MUTEX_LOCK(&job->mutex);
+        if (job->failed || job->next_entry >= job->entry_count) {
+            MUTEX_UNLOCK(&job->mutex);
+            break;
+        }
+        const unzip_entry *entry = &job->entries[job->next_entry++];
+        MUTEX_UNLOCK(&job->mutex);
+
+        const double trace_start_time = trace_begin();
+        if (!mz_zip_reader_extract_to_file(&zip_archive, entry->index, entry->output_path, 0)) {
+            fprintf(stderr, RED "==> 解压文件失败: %s\n" RESET, entry->output_path);
+            MUTEX_LOCK(&job->mutex);
+            job->failed = 1;
+            MUTEX_UNLOCK(&job->mutex);
+            break;
+        }
+        trace_end("inflate", trace_start_time, entry->output_path);
+
+        DEBUG_PRINT("解压文件: %s\n", entry->output_path);
+    }
+
+    mz_zip_reader_end(&zip_archive);
+}
+
+// 解压 .mcz 文件，thread_count 为 0 时使用 CPU 核心数
+int unzip_mcz(const char *mcz_path, const char *output_dir, int thread_count) {
     DEBUG_PRINT("解压 .mcz 文件: %s 到目录: %s\n", mcz_path, output_dir);
+    TRACE_PROBE1(unzip_start, mcz_path);
     char abs_output_dir[1024];
     if (!create_directory_if_not_exists(output_dir)) {
         return 0; // 如果无法创建目录，返回失败
@@ -101,7 +134,7 @@ int unzip_mcz(const char *mcz_path, const char *output_dir) {
         return 0; // 获取绝对路径失败
     }
 
-    // 使用 miniz 解压
+    // 使用 miniz 读取目录结构
     mz_zip_archive zip_archive = {0};
 
     if (!mz_zip_reader_init_file(&zip_archive, mcz_path, 0)) {
@@ -110,10 +143,20 @@ int unzip_mcz(const char *mcz_path, const char *output_dir) {
     }
 
     const unsigned int num_files = mz_zip_reader_get_num_files(&zip_archive);
-    for (int i = 0; i < num_files; i++) {
+    unzip_entry *entries = malloc(sizeof(unzip_entry) * (num_files > 0 ? num_files : 1));
+    if (!entries) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        mz_zip_reader_end(&zip_archive);
+        return 0;
+    }
+    int entry_count = 0;
+
+    // 先串行创建目录结构，再并行解压文件
+    for (unsigned int i = 0; i < num_files; i++) {
         mz_zip_archive_file_stat file_stat;
         if (!mz_zip_reader_file_stat(&zip_archive, i, &file_stat)) {
-            fprintf(stderr, RED "==> 无法获取文件信息: %d\n" RESET, i);
+            fprintf(stderr, RED "==> 无法获取文件信息: %u\n" RESET, i);
+            free(entries);
             mz_zip_reader_end(&zip_archive);
             return 0;
         }
@@ -121,7 +164,7 @@ int unzip_mcz(const char *mcz_path, const char *output_dir) {
         // 构建输出文件路径
         char output_file_path[1024];
         char normalized_filename[1024];
-        strcpy(normalized_filename, file_stat.m_filename);
+        snprintf(normalized_filename, sizeof(normalized_filename), "%s", file_stat.m_filename);
         for (char *p = normalized_filename; *p; p++) {
             if (*p == '/' || *p == '\\') {
                 *p = PATH_SEPARATOR;
@@ -134,6 +177,7 @@ int unzip_mcz(const char *mcz_path, const char *output_dir) {
         if (mz_zip_reader_is_file_a_directory(&zip_archive, i)) {
             // 创建目录
             if (!create_directory_if_not_exists(output_file_path)) {
+                free(entries);
                 mz_zip_reader_end(&zip_archive);
                 return 0;
             }
@@ -147,22 +191,65 @@ int unzip_mcz(const char *mcz_path, const char *output_dir) {
         if (last_sep) {
             *last_sep = '\0';
             if (!create_directory_if_not_exists(parent_dir)) {
+                free(entries);
                 mz_zip_reader_end(&zip_archive);
                 return 0;
             }
         }
 
-        // 解压文件
-        if (!mz_zip_reader_extract_to_file(&zip_archive, i, output_file_path, 0)) {
-            fprintf(stderr, RED "==> 解压文件失败: %s\n" RESET, output_file_path);
-            mz_zip_reader_end(&zip_archive);
-            return 0;
+        entries[entry_count].index = i;
+        entries[entry_count].size = file_stat.m_uncomp_size;
+        strcpy(entries[entry_count].output_path, output_file_path);
+        entry_count++;
+    }
+
+    if (thread_count <= 0) {
+        thread_count = get_cpu_count();
+    }
+    if (thread_count > entry_count) {
+        thread_count = entry_count;
+    }
+
+    int ok = 1;
+    if (thread_count <= 1) {
+        // 单个文件时直接在当前线程解压
+        for (int i = 0; i < entry_count; i++) {
+            const double trace_start_time = trace_begin();
+            if (!mz_zip_reader_extract_to_file(&zip_archive, entries[i].index, entries[i].output_path, 0)) {
+                fprintf(stderr, RED "==> 解压文件失败: %s\n" RESET, entries[i].output_path);
+                ok = 0;
+                break;
+            }
+            trace_end("inflate", trace_start_time, entries[i].output_path);
+            DEBUG_PRINT("解压文件: %s\n", entries[i].output_path);
         }
+        mz_zip_reader_end(&zip_archive);
+    } else {
+        mz_zip_reader_end(&zip_archive);
+        qsort(entries, entry_count, sizeof(unzip_entry), compare_unzip_entry);
+
+        unzip_job job = {.mcz_path = mcz_path, .entries = entries, .entry_count = entry_count};
+        MUTEX_INIT(&job.mutex);
+        thread_pool *pool = thread_pool_create(thread_count);
+        if (!pool) {
+            ok = 0;
+        } else {
+            for (int i = 0; i < thread_count; i++) {
+                thread_pool_submit(pool, unzip_worker, &job);
+            }
+            thread_pool_destroy(pool);
+            ok = !job.failed;
+        }
+        MUTEX_DESTROY(&job.mutex);
+        DEBUG_PRINT("并行解压完成，线程数: %d\n", thread_count);
+    }
 
-        DEBUG_PRINT("解压文件: %s\n", output_file_path);
+    free(entries);
+    TRACE_PROBE2(unzip_done, mcz_path, ok);
+    if (!ok) {
+        return 0;
     }
 
-    mz_zip_reader_end(&zip_archive);
     printf(GREEN "==> 解压成功到: %s\n" RESET, abs_output_dir);
     return 1;
 }
@@ -209,246 +296,328 @@ char *choose_mc_file(char **mc_files, int mc_file_count) {
     return mc_files[choice - 1];
 }
 
-// 读取标准输入
+// 读取标准输入（按块读取直到 EOF）
 char *read_stdin_custom() {
-    size_t buffer_size = 1024;
-    char *buffer = malloc(buffer_size);
+    size_t buffer_size = STDIN_BLOCK_SIZE;
+    char *buffer = malloc(buffer_size + 1);
     if (!buffer) {
         fprintf(stderr, RED "==> 内存分配失败\n" RESET);
         return NULL;
     }
 
-    size_t index = 0;
-    int ch;
-
-    // 从标准输入读取字符直到遇到换行符或者缓冲区已满
-    while ((ch = getchar()) != EOF && ch != '\n') {
-        buffer[index++] = (char) ch;
+    size_t length = 0;
+    size_t read_len;
+    while ((read_len = fread(buffer + length, 1, buffer_size - length, stdin)) > 0) {
+        length += read_len;
 
         // 如果缓冲区满了，扩展缓冲区
-        if (index >= buffer_size - 1) {
-            size_t new_buffer_size = buffer_size * 2;
-            char *new_buffer = realloc(buffer, new_buffer_size);
+        if (length == buffer_size) {
+            const size_t new_buffer_size = buffer_size * 2;
+            char *new_buffer = realloc(buffer, new_buffer_size + 1);
             if (!new_buffer) {
                 fprintf(stderr, RED "==> 内存扩展失败\n" RESET);
-                free(buffer); // 释放原来的内存
+                free(buffer);
                 return NULL;
             }
-            buffer = new_buffer; // 更新指针
-            buffer_size = new_buffer_size; // 更新缓冲区大小
+            buffer = new_buffer;
+            buffer_size = new_buffer_size;
         }
     }
 
-    buffer[index] = '\0'; // 添加字符串结束符
+    if (ferror(stdin)) {
+        fprintf(stderr, RED "==> 读取标准输入失败\n" RESET);
+        free(buffer);
+        return NULL;
+    }
+
+    buffer[length] = '\0'; // 添加字符串结束符
+    DEBUG_PRINT("标准输入读取完成，大小: %zu 字节\n", length);
     return buffer;
 }
 
-// 提取最后的 offset 值并处理
-double extract_last_offset(const cJSON *notes) {
-    if (!cJSON_IsArray(notes)) {
-        fprintf(stderr, RED "==> note 字段不是数组\n" RESET);
-        return 0;
+// 获取用于输出谱面的标准输出流，进度信息随后改写到标准错误
+static FILE *get_chart_stdout() {
+    static FILE *chart_stdout = NULL;
+    if (chart_stdout) {
+        return chart_stdout;
     }
 
-    const int note_count = cJSON_GetArraySize(notes);
-    if (note_count == 0) {
-        fprintf(stderr, RED "==> note 数组为空\n" RESET);
-        return 0;
+    fflush(stdout);
+    const int fd = DUP(FILENO(stdout));
+    if (fd < 0 || !(chart_stdout = FDOPEN(fd, "w"))) {
+        fprintf(stderr, RED "==> 无法打开标准输出\n" RESET);
+        return NULL;
     }
+    DUP2(FILENO(stderr), FILENO(stdout));
+    return chart_stdout;
+}
 
-    const cJSON *last_note = cJSON_GetArrayItem(notes, note_count - 1);
-    const cJSON *offset = cJSON_GetObjectItem(last_note, "offset");
-    if (!cJSON_IsNumber(offset)) {
-        fprintf(stderr, RED "==> 未找到有效的 offset 值\n" RESET);
-        return 0;
+// 根据序号生成输出路径，例如 Chart.json -> Chart_3.json
+void build_numbered_output_path(const char *output_path, const int index, char *numbered_path, const size_t size) {
+    const char *last_sep = strrchr(output_path, PATH_SEPARATOR);
+    const char *dot = strrchr(output_path, '.');
+    if (!dot || (last_sep && dot < last_sep)) {
+        snprintf(numbered_path, size, "%s_%d", output_path, index);
+        return;
     }
+    snprintf(numbered_path, size, "%.*s_%d%s", (int) (dot - output_path), output_path, index, dot);
+}
 
-    const double result = offset->valuedouble;
-
-    printf(BLUE "  -> Offset: %lf\n", result);
+// 转换一个已解码的 .mc 谱面，返回 Chart.json 文本；preview_seconds 大于 0 时输出预览谱面
+char *convert_mc_json(const mc_chart *mc, const int formatted, const double preview_seconds) {
+    chart_ir ir;
+    if (!mc_build_chart_ir(mc, -1.0, &ir)) {
+        chart_ir_free(&ir);
+        return NULL;
+    }
+    if (preview_seconds > 0) {
+        chart_ir_truncate(&ir, preview_seconds);
+    }
 
-    return result; // 将 offset 除以 1000
+    char *json_string = create_chart_string(&ir, formatted);
+    chart_ir_free(&ir);
+    return json_string;
 }
 
-// 生成 bpmList
-cJSON *create_bpm_list(const cJSON *time) {
-    if (!cJSON_IsArray(time)) {
-        fprintf(stderr, RED "==> time 字段不是数组\n" RESET);
-        return cJSON_CreateArray();
+// NDJSON 模式：标准输入每行一个谱面，按顺序输出到编号文件或标准输出
+int process_ndjson_stdin(const char *output_path, const double preview_seconds) {
+    const int to_stdout = strcmp(output_path, "-") == 0;
+    FILE *out = to_stdout ? get_chart_stdout() : NULL;
+    if (to_stdout && !out) {
+        return 0;
     }
 
-    cJSON *bpm_list = cJSON_CreateArray();
-    const int time_count = cJSON_GetArraySize(time);
-
-    for (int i = 0; i < time_count; i++) {
-        const cJSON *entry = cJSON_GetArrayItem(time, i);
-        const cJSON *beat = cJSON_GetObjectItem(entry, "beat");
-        const cJSON *bpm = cJSON_GetObjectItem(entry, "bpm");
+    size_t buffer_size = STDIN_BLOCK_SIZE;
+    char *buffer = malloc(buffer_size);
+    if (!buffer) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        return 0;
+    }
 
-        if (!cJSON_IsArray(beat) || !cJSON_IsNumber(bpm)) {
-            fprintf(stderr, RED "==> time 数组中的元素格式不正确\n" RESET);
+    // buffer 中 [offset, length) 为尚未处理的数据，只在读取下一块之前把它移到开头
+    size_t offset = 0;
+    size_t length = 0;
+    int line_number = 0;
+    int chart_index = 0;
+    int failures = 0;
+    int at_eof = 0;
+
+    while (!at_eof || offset < length) {
+        // 按块读取，直到缓冲区中出现完整的一行或到达 EOF
+        char *line = buffer + offset;
+        char *newline = memchr(line, '\n', length - offset);
+        if (!newline && !at_eof) {
+            if (offset > 0) {
+                memmove(buffer, line, length - offset);
+                length -= offset;
+                offset = 0;
+            }
+            if (length == buffer_size) {
+                char *new_buffer = realloc(buffer, buffer_size * 2);
+                if (!new_buffer) {
+                    fprintf(stderr, RED "==> 内存扩展失败\n" RESET);
+                    free(buffer);
+                    return 0;
+                }
+                buffer = new_buffer;
+                buffer_size *= 2;
+            }
+            const size_t read_len = fread(buffer + length, 1, buffer_size - length, stdin);
+            if (read_len == 0) {
+                if (ferror(stdin)) {
+                    fprintf(stderr, RED "==> 读取标准输入失败\n" RESET);
+                    free(buffer);
+                    return 0;
+                }
+                at_eof = 1;
+            }
+            length += read_len;
             continue;
         }
 
-        const int a = cJSON_GetArrayItem(beat, 0)->valueint;
-        const int b = cJSON_GetArrayItem(beat, 1)->valueint;
-        const int c = cJSON_GetArrayItem(beat, 2)->valueint;
-
-        const double e = (c != 0) ? a + (double) b / c : a;
+        const size_t line_len = newline ? (size_t) (newline - line) : length - offset;
+        line_number++;
 
-        cJSON *bpm_entry = cJSON_CreateObject();
-        cJSON_AddNumberToObject(bpm_entry, "integer", a);
-        cJSON_AddNumberToObject(bpm_entry, "molecule", b);
-        cJSON_AddNumberToObject(bpm_entry, "denominator", c);
-        cJSON_AddNumberToObject(bpm_entry, "currentBPM", bpm->valuedouble);
-        cJSON_AddNumberToObject(bpm_entry, "ThisStartBPM", e);
+        // 跳过空行
+        size_t start = 0;
+        while (start < line_len && (line[start] == ' ' || line[start] == '\t' || line[start] == '\r')) {
+            start++;
+        }
+        if (start < line_len) {
+            chart_index++;
+            char *chart_string = NULL;
+            mc_chart mc;
+            if (!mc_preview_string(line + start, line_len - start, preview_seconds, &mc)) {
+                fprintf(stderr, RED "==> 第 %d 行无法解析 JSON 数据\n" RESET, line_number);
+            } else {
+                chart_string = convert_mc_json(&mc, !to_stdout, preview_seconds);
+            }
+            mc_chart_free(&mc);
+
+            if (to_stdout) {
+                // 解析失败时输出 null，保持输出行与输入谱面一一对应
+                fprintf(out, "%s\n", chart_string ? chart_string : "null");
+            } else if (chart_string) {
+                char numbered_path[BUFFER_SIZE];
+                build_numbered_output_path(output_path, chart_index, numbered_path, sizeof(numbered_path));
+                if (!write_chart_string(chart_string, numbered_path)) {
+                    failures++;
+                }
+            }
+            if (!chart_string) {
+                failures++;
+            }
+            free(chart_string);
+        }
 
-        cJSON_AddItemToArray(bpm_list, bpm_entry);
+        offset += newline ? line_len + 1 : line_len;
     }
 
-    printf(BLUE "  -> BPM List解析完成.\n");
+    free(buffer);
+    if (to_stdout) {
+        fflush(out);
+    }
 
-    return bpm_list;
+    printf(GREEN "==> NDJSON 处理完成: %d 个谱面, %d 个失败\n" RESET, chart_index, failures);
+    return failures == 0;
 }
 
-cJSON *createBeatObject(const double startBPM, const double endBPM) {
-    cJSON *beats = cJSON_CreateObject();
-    cJSON_AddNumberToObject(beats, "integer", 0);
-    cJSON_AddNumberToObject(beats, "molecule", 0);
-    cJSON_AddNumberToObject(beats, "denominator", 1);
-    cJSON_AddNumberToObject(beats, "currentBPM", startBPM);
-    cJSON_AddNumberToObject(beats, "ThisStartBPM", endBPM);
-    return beats;
+// 生成 Chart.json 文本
+char *create_chart_string(const chart_ir *ir, const int formatted) {
+    return chart_ir_serialize(ir, formatted, NULL);
 }
 
-void add_boxes_to_chart(cJSON *chart) {
-    // 创建 "boxes" 数组
-    cJSON *boxes = cJSON_CreateArray();
-
-    // 创建 box
-    cJSON *box = cJSON_CreateObject();
-    cJSON *boxEvents = cJSON_CreateObject();
-
-    // 添加 boxEvents 的各个子项
-    cJSON *speed = cJSON_CreateArray();
-    cJSON *moveX = cJSON_CreateArray();
-    cJSON *moveY = cJSON_CreateArray();
-    cJSON *rotate = cJSON_CreateArray();
-    cJSON *alpha = cJSON_CreateArray();
-    cJSON *scaleX = cJSON_CreateArray();
-    cJSON *scaleY = cJSON_CreateArray();
-    cJSON *centerX = cJSON_CreateArray();
-    cJSON *centerY = cJSON_CreateArray();
-    cJSON *lineAlpha = cJSON_CreateArray();
-
-    // 添加 "speed" 数组的示例项
-    cJSON *speedObject = cJSON_CreateObject();
-    cJSON_AddItemToObject(speedObject, "startBeats", createBeatObject(0.0, 0.0));
-    cJSON_AddItemToObject(speedObject, "endBeats", createBeatObject(1.0, 1.0));
-    cJSON_AddNumberToObject(speedObject, "startValue", 3.0);
-    cJSON_AddNumberToObject(speedObject, "endValue", 3.0);
-    cJSON_AddNumberToObject(speedObject, "curveIndex", 0);
-    cJSON_AddBoolToObject(speedObject, "IsSelected", 0);
-    cJSON_AddItemToArray(speed, speedObject);
-
-    // 其它数组（moveX、moveY、rotate 等）可以使用类似的方法添加数据
-    cJSON_AddItemToObject(boxEvents, "speed", speed);
-    cJSON_AddItemToObject(boxEvents, "moveX", moveX);
-    cJSON_AddItemToObject(boxEvents, "moveY", moveY);
-    cJSON_AddItemToObject(boxEvents, "rotate", rotate);
-    cJSON_AddItemToObject(boxEvents, "alpha", alpha);
-    cJSON_AddItemToObject(boxEvents, "scaleX", scaleX);
-    cJSON_AddItemToObject(boxEvents, "scaleY", scaleY);
-    cJSON_AddItemToObject(boxEvents, "centerX", centerX);
-    cJSON_AddItemToObject(boxEvents, "centerY", centerY);
-    cJSON_AddItemToObject(boxEvents, "lineAlpha", lineAlpha);
-
-    // 添加其它字段（LengthSpeed 等）
-    cJSON_AddNumberToObject(boxEvents, "LengthSpeed", 1);
-    cJSON_AddNumberToObject(boxEvents, "LengthMoveX", 1);
-    cJSON_AddNumberToObject(boxEvents, "LengthMoveY", 1);
-    cJSON_AddNumberToObject(boxEvents, "LengthRotate", 1);
-    cJSON_AddNumberToObject(boxEvents, "LengthAlpha", 1);
-    cJSON_AddNumberToObject(boxEvents, "LengthScaleX", 1);
-    cJSON_AddNumberToObject(boxEvents, "LengthScaleY", 1);
-    cJSON_AddNumberToObject(boxEvents, "LengthCenterX", 1);
-    cJSON_AddNumberToObject(boxEvents, "LengthCenterY", 1);
-    cJSON_AddNumberToObject(boxEvents, "LengthLineAlpha", 1);
-
-    cJSON_AddItemToObject(box, "boxEvents", boxEvents);
-
-    // 添加 "lines" 数组
-    cJSON *lines = cJSON_CreateArray();
-    for (int i = 0; i < 5; i++) {
-        cJSON *line = cJSON_CreateObject();
-        cJSON_AddItemToObject(line, "onlineNotes", cJSON_CreateArray());
-        cJSON_AddItemToObject(line, "onlineNotesLength", cJSON_CreateNumber(0));
-        cJSON_AddItemToObject(line, "offlineNotes", cJSON_CreateArray());
-        cJSON_AddItemToObject(line, "offlineNotesLength", cJSON_CreateNumber(0));
-        cJSON_AddItemToArray(lines, line);
-    }
-
-    cJSON_AddItemToObject(box, "lines", lines);
-
-    // 将 box 添加到 boxes 数组中
-    cJSON_AddItemToArray(boxes, box);
-
-    // 将 boxes 添加到 chart 对象中
-    cJSON_AddItemToObject(chart, "boxes", boxes);
-}
+// 将 Chart.json 文本写入文件，路径为 "-" 时写入标准输出
+int write_chart_string(const char *json_string, const char *output_path) {
+    if (strcmp(output_path, "-") == 0) {
+        FILE *out = get_chart_stdout();
+        if (!out) {
+            return 0;
+        }
+        fprintf(out, "%s\n", json_string);
+        fflush(out);
+        return 1;
+    }
 
-void create_chart_json(const double offset, cJSON *bpm_list, const char *output_path) {
-    cJSON *chart = cJSON_CreateObject();
+    // 写入同目录的临时文件后重命名，失败时不会留下不完整的 Chart.json
+    char temp_path[BUFFER_SIZE];
+    FILE *file = atomic_file_open(output_path, temp_path, sizeof(temp_path));
+    if (!file) {
+        return 0;
+    }
 
-    cJSON_AddNumberToObject(chart, "yScale", 6.0);
-    cJSON_AddNumberToObject(chart, "beatSubdivision", 4);
-    cJSON_AddNumberToObject(chart, "verticalSubdivision", 16);
-    cJSON_AddNumberToObject(chart, "eventVerticalSubdivision", 10);
-    cJSON_AddNumberToObject(chart, "playSpeed", 1.0);
-    cJSON_AddNumberToObject(chart, "offset", offset / 1000);
-    cJSON_AddNumberToObject(chart, "musicLength", -1.0);
-    cJSON_AddBoolToObject(chart, "loopPlayBack", 1);
-    cJSON_AddItemToObject(chart, "bpmList", bpm_list);
+    fprintf(file, "%s\n", json_string);
+    if (!atomic_file_commit(file, temp_path, output_path, 1)) {
+        return 0;
+    }
 
-    add_boxes_to_chart(chart);
+    printf(GREEN "==> 保存成功, 文件位于: %s\n" RESET, output_path);
 
-    printf(BLUE " -> 文件初始化完成.\n" RESET);
+#ifdef DEBUG
+    // 调试构建下校验生成的谱面
+    validate_chart_string(json_string, strlen(json_string), output_path);
+#endif
+    return 1;
+}
 
-    // 写入文件
-    FILE *file = fopen(output_path, "w");
-    if (!file) {
-        fprintf(stderr, RED "==> 无法创建文件: %s\n" RESET, output_path);
-        cJSON_Delete(chart);
-        return;
+// 压缩输出时边序列化边压缩写入，不生成完整的文本；成功返回 1
+int create_chart_json(const chart_ir *ir, const char *output_path, const output_compression compression,
+                      const int level) {
+    if (compression != OUTPUT_COMPRESSION_NONE) {
+        const double trace_start_time = trace_begin();
+        const int written = chart_ir_write_file_compressed(ir, output_path, compression, level);
+        trace_end("write", trace_start_time, output_path);
+        return written;
     }
 
-    char *json_string = cJSON_Print(chart);
+    char *json_string = create_chart_string(ir, 1);
     if (!json_string) {
-        fprintf(stderr, RED "==> JSON 格式化失败\n" RESET);
-        fclose(file);
-        cJSON_Delete(chart);
-        return;
+        return 0;
     }
 
-    fprintf(file, "%s\n", json_string);
-    fclose(file);
-
-    printf(GREEN "==> 保存成功, 文件位于: %s\n" RESET, output_path);
+    const double trace_start_time = trace_begin();
+    const int written = write_chart_string(json_string, output_path);
+    trace_end("write", trace_start_time, output_path);
 
     // 清理内存
     free(json_string);
-    cJSON_Delete(chart);
-
-    printf(GREEN "==> 临时文件已删除\n" RESET);
+    return written;
 }
 
 
+// -p 模式：不解压到磁盘，在压缩包中取第一个 .mc 条目所在的目录为谱面目录，
+// 从该目录（含子目录）下的 .mc 条目中选择一个并直接分块解码。成功返回 1，mc 总需 mc_chart_free
+static int decode_archive_chart(const char *mcz_path, const double preview_seconds, mc_chart *mc, char *chart_dir,
+                                const size_t size) {
+    memset(mc, 0, sizeof(mc_chart));
+    mz_zip_archive zip = {0};
+    if (!mz_zip_reader_init_file(&zip, mcz_path, 0)) {
+        fprintf(stderr, RED "==> 无法打开 .mcz 文件: %s\n" RESET, mcz_path);
+        return 0;
+    }
+
+    const unsigned int num_files = mz_zip_reader_get_num_files(&zip);
+    char **names = calloc(num_files > 0 ? num_files : 1, sizeof(char *));
+    unsigned int *indices = calloc(num_files > 0 ? num_files : 1, sizeof(unsigned int));
+    int count = 0;
+    size_t dir_len = 0;
+    int ok = names && indices;
+    if (!ok) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+    }
+    for (unsigned int i = 0; ok && i < num_files; i++) {
+        mz_zip_archive_file_stat file_stat;
+        if (!mz_zip_reader_file_stat(&zip, i, &file_stat) || file_stat.m_is_directory ||
+            !has_extension(file_stat.m_filename, ".mc")) {
+            continue;
+        }
+        const char *name = file_stat.m_filename;
+        if (count == 0) {
+            const char *last_slash = strrchr(name, '/');
+            dir_len = last_slash ? (size_t) (last_slash - name) : 0;
+            snprintf(chart_dir, size, "%.*s", (int) dir_len, name);
+        } else if (dir_len > 0 && (strncmp(name, chart_dir, dir_len) != 0 || name[dir_len] != '/')) {
+            continue;
+        }
+        names[count] = strdup(dir_len > 0 ? name + dir_len + 1 : name);
+        indices[count] = i;
+        ok = names[count++] != NULL;
+    }
+
+    char *mc_file = ok ? choose_mc_file(names, count) : NULL;
+    ok = 0;
+    for (int i = 0; mc_file && i < count; i++) {
+        if (names[i] != mc_file) continue;
+        printf(GREEN "==> 处理文件: %s:%s%s%s\n" RESET, mcz_path, chart_dir, dir_len > 0 ? "/" : "", mc_file);
+        ok = mc_preview_zip_entry(&zip, indices[i], preview_seconds, mc);
+        if (!ok) {
+            fprintf(stderr, RED "==> JSON 解析失败\n" RESET);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        free(names[i]);
+    }
+    free(names);
+    free(indices);
+    mz_zip_reader_end(&zip);
+    return ok;
+}
+
 int main(const int argc, char *argv[]) {
     enable_ansi_colors(); // Enable ANSI colors on Windows
 
     const char *input_path = NULL;
     const char *output_path = "Chart.json";
+    const char *package_path = NULL;
     int is_mcz = 0;
+    int is_ndjson = 0;
+    int thread_count = 0;
+    const char *batch_input = NULL;
+    int output_specified = 0;
+    int merge_shards = 0;
+    batch_options batch;
+    batch_options_init(&batch);
 
     // 解析命令行参数
     for (int i = 1; i < argc; i++) {
@@ -456,8 +625,102 @@ int main(const int argc, char *argv[]) {
             input_path = argv[++i];
         } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
             output_path = argv[++i];
+            output_specified = 1;
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            batch_input = argv[++i];
+        } else if (strcmp(argv[i], "--stage-workers") == 0 && i + 1 < argc) {
+            if (!batch_parse_stage_workers(&batch, argv[++i])) {
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--queue-depth") == 0 && i + 1 < argc) {
+            batch.queue_depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            batch.metrics_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            if (!trace_start(argv[++i])) {
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc) {
+            batch.metrics_interval = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--no-fsync") == 0) {
+            batch.fsync_outputs = 0;
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            batch.resume = 1;
+        } else if (strcmp(argv[i], "--retry-crashed") == 0) {
+            batch.resume = 1;
+            batch.retry_crashed = 1;
+        } else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            batch.journal_path = argv[++i];
+        } else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            if (!batch_parse_shard(argv[++i], &batch.shard_index, &batch.shard_count)) {
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--preview") == 0 && i + 1 < argc) {
+            batch.preview_seconds = atof(argv[++i]);
+            if (batch.preview_seconds <= 0) {
+                fprintf(stderr, RED "==> 预览长度必须大于 0: %s\n" RESET, argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if ((strcmp(argv[i], "--job-timeout") == 0 || strcmp(argv[i], "--job-memory") == 0 ||
+                    strcmp(argv[i], "--archive-limit") == 0) && i + 1 < argc) {
+            const char *name = argv[i];
+            const double value = atof(argv[++i]);
+            if (value <= 0) {
+                fprintf(stderr, RED "==> %s 必须大于 0: %s\n" RESET, name, argv[i]);
+                return EXIT_FAILURE;
+            }
+            if (strcmp(name, "--job-timeout") == 0) {
+                batch.job_timeout = value;
+            } else if (strcmp(name, "--job-memory") == 0) {
+                batch.job_memory_limit = (size_t) (value * 1048576);
+            } else {
+                batch.archive_limit = (size_t) (value * 1048576);
+            }
+        } else if (strcmp(argv[i], "--isolate") == 0) {
+            batch.isolate = 1;
+        } else if (strcmp(argv[i], "--compress") == 0 && i + 1 < argc) {
+            if (!output_compression_parse(argv[++i], &batch.compression)) {
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--compress-level") == 0 && i + 1 < argc) {
+            batch.compression_level = atoi(argv[++i]);
+            if (batch.compression_level < 0 || batch.compression_level > 9) {
+                fprintf(stderr, RED "==> 压缩级别必须在 0-9 之间: %s\n" RESET, argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--analyze") == 0 && i + 1 < argc) {
+            if (!analysis_format_parse(argv[++i], &batch.analyze)) {
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--merge-shards") == 0) {
+            merge_shards = 1;
+        } else if (strcmp(argv[i], "--io") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "stdio") == 0) {
+                batch.io_backend = BATCH_IO_STDIO;
+            } else if (strcmp(argv[i], "uring") == 0) {
+                batch.io_backend = BATCH_IO_URING;
+            } else if (strcmp(argv[i], "auto") == 0) {
+                batch.io_backend = BATCH_IO_AUTO;
+            } else {
+                fprintf(stderr, RED "==> 未知的 I/O 后端: %s\n" RESET, argv[i]);
+                return EXIT_FAILURE;
+            }
         } else if (strcmp(argv[i], "-z") == 0) {
             is_mcz = 1;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0) {
+            is_ndjson = 1;
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            package_path = argv[++i];
+        } else if (strcmp(argv[i], "--validate") == 0 && i + 1 < argc) {
+            const int errors = validate_chart_file(argv[++i]);
+            if (errors != 0) {
+                return EXIT_FAILURE;
+            }
+            printf(GREEN "==> 校验通过: %s\n" RESET, argv[i]);
+            return EXIT_SUCCESS;
         } else if (strcmp(argv[i], "-h") == 0) {
             print_help(argv[0]);
             return EXIT_SUCCESS;
@@ -467,6 +730,51 @@ int main(const int argc, char *argv[]) {
         }
     }
 
+    if (package_path && !is_mcz) {
+        fprintf(stderr, RED "==> -p 选项需要配合 -z 使用\n" RESET);
+        return EXIT_FAILURE;
+    }
+
+    // 统计模式：单个文件同样走批量流水线
+    if (batch.analyze) {
+        if (merge_shards || batch.resume || batch.preview_seconds > 0 || is_ndjson || package_path ||
+            batch.compression != OUTPUT_COMPRESSION_NONE) {
+            fprintf(stderr, RED "==> --analyze 不能与 --merge-shards、--resume、--preview、--compress、-n、-p 同时使用\n" RESET);
+            return EXIT_FAILURE;
+        }
+        const char *analyze_input = batch_input ? batch_input : input_path;
+        if (!analyze_input || (batch_input && input_path)) {
+            fprintf(stderr, RED "==> --analyze 需要 -b 或 -f 指定一个输入\n" RESET);
+            return EXIT_FAILURE;
+        }
+        batch.inputs = &analyze_input;
+        batch.input_count = 1;
+        batch.output_dir = "";
+        batch.analyze_path = output_specified ? output_path : "-";
+        return run_batch(&batch) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // 分片合并检查
+    if (merge_shards) {
+        batch.inputs = &batch_input;
+        batch.input_count = batch_input ? 1 : 0;
+        batch.output_dir = output_specified ? output_path : "blophy_output";
+        return batch_merge_shards(&batch) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // 批量模式
+    if (batch_input) {
+        batch.inputs = &batch_input;
+        batch.input_count = 1;
+        batch.output_dir = output_specified ? output_path : "blophy_output";
+        return run_batch(&batch) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (is_ndjson && input_path) {
+        fprintf(stderr, RED "==> -n 选项只能用于标准输入\n" RESET);
+        return EXIT_FAILURE;
+    }
+
     // 检查 output_path 是否是目录路径，如果是目录，则附加文件名 "Chart.json"
     if (output_path) {
 #ifdef _WIN32
@@ -485,36 +793,65 @@ int main(const int argc, char *argv[]) {
         output_path = "Chart.json"; // 如果没有指定 -o，则默认使用 "Chart.json"
     }
 
+    // 压缩输出时文件名追加 .gz / .zz
+    if (batch.compression != OUTPUT_COMPRESSION_NONE) {
+        if (is_ndjson || strcmp(output_path, "-") == 0) {
+            fprintf(stderr, RED "==> 压缩输出不能用于 NDJSON 模式或标准输出\n" RESET);
+            return EXIT_FAILURE;
+        }
+        const char *extension = output_compression_extension(batch.compression);
+        if (!has_extension(output_path, extension)) {
+            char temp_path[1024];
+            snprintf(temp_path, sizeof(temp_path), "%s%s", output_path, extension);
+            output_path = strdup(temp_path);
+        }
+    }
+
+    // 谱面写到标准输出时，在任何进度信息之前把标准输出改写到标准错误
+    if (strcmp(output_path, "-") == 0 && !get_chart_stdout()) {
+        return EXIT_FAILURE;
+    }
+
     DEBUG_PRINT("程序启动，输入路径: %s, 输出路径: %s\n", input_path ? input_path : "(未指定)", output_path);
 
     // 读取输入文件内容
     char *input_content = NULL;
-    if (!input_path) {
+    if (!input_path && is_ndjson) {
+        // 逐行读取 NDJSON
+        if (!process_ndjson_stdin(output_path, batch.preview_seconds)) {
+            return EXIT_FAILURE;
+        }
+    } else if (!input_path) {
         // 从标准输入读取
         input_content = read_stdin_custom();
         if (input_content == NULL) {
             return EXIT_FAILURE;
         }
 
-        // 解析 JSON 数据
-        cJSON *json = cJSON_Parse(input_content);
+        // 解码谱面数据
+        mc_chart mc;
+        const int decoded = mc_preview_string(input_content, strlen(input_content), batch.preview_seconds, &mc);
         free(input_content);
-        if (json == NULL) {
+        if (!decoded) {
             fprintf(stderr, RED "==> 无法解析 JSON 数据\n" RESET);
+            mc_chart_free(&mc);
             return EXIT_FAILURE;
         }
 
         // 提取数据并生成 Chart.json
-        const cJSON *notes = cJSON_GetObjectItem(json, "note");
-        const cJSON *time = cJSON_GetObjectItem(json, "time");
-
-        const double offset = extract_last_offset(notes);
-        cJSON *bpm_list = create_bpm_list(time);
-
-        create_chart_json(offset, bpm_list, output_path);
+        chart_ir ir;
+        int built = mc_build_chart_ir(&mc, -1.0, &ir);
+        if (built && batch.preview_seconds > 0) {
+            chart_ir_truncate(&ir, batch.preview_seconds);
+        }
+        built = built && create_chart_json(&ir, output_path, batch.compression, batch.compression_level);
 
         // 清理内存
-        cJSON_Delete(json);
+        chart_ir_free(&ir);
+        mc_chart_free(&mc);
+        if (!built) {
+            return EXIT_FAILURE;
+        }
     } else {
         if (!is_mcz) {
             // 直接处理 .mc 文件
@@ -523,25 +860,46 @@ int main(const int argc, char *argv[]) {
                 return EXIT_FAILURE;
             }
 
-            // 解析 JSON 数据
-            cJSON *json = cJSON_Parse(input_content);
+            // 解码谱面数据
+            mc_chart mc;
+            const int decoded = mc_preview_string(input_content, strlen(input_content), batch.preview_seconds, &mc);
             free(input_content);
-            if (json == NULL) {
+            if (!decoded) {
                 fprintf(stderr, RED "==> 无法解析 JSON 数据\n" RESET);
+                mc_chart_free(&mc);
                 return EXIT_FAILURE;
             }
 
-            // 提取数据并生成 Chart.json
-            const cJSON *notes = cJSON_GetObjectItem(json, "note");
-            const cJSON *time = cJSON_GetObjectItem(json, "time");
-
-            const double offset = extract_last_offset(notes);
-            cJSON *bpm_list = create_bpm_list(time);
+            // 音频文件与 .mc 文件位于同一目录
+            double music_length = -1.0;
+            const char *sound = extract_sound_file(&mc);
+            if (sound && batch.preview_seconds <= 0) {
+                char sound_path[BUFFER_SIZE];
+                const char *last_sep = strrchr(input_path, PATH_SEPARATOR);
+                if (last_sep) {
+                    snprintf(sound_path, sizeof(sound_path), "%.*s%c%s", (int) (last_sep - input_path), input_path,
+                             PATH_SEPARATOR, sound);
+                } else {
+                    snprintf(sound_path, sizeof(sound_path), "%s", sound);
+                }
+                music_length = probe_file_audio_length(sound_path);
+            }
+            printf(BLUE "  -> Music Length: %lf\n" RESET, music_length);
 
-            create_chart_json(offset, bpm_list, output_path);
+            // 提取数据并生成 Chart.json
+            chart_ir ir;
+            int built = mc_build_chart_ir(&mc, music_length, &ir);
+            if (built && batch.preview_seconds > 0) {
+                chart_ir_truncate(&ir, batch.preview_seconds);
+            }
+            built = built && create_chart_json(&ir, output_path, batch.compression, batch.compression_level);
 
             // 清理内存
-            cJSON_Delete(json);
+            chart_ir_free(&ir);
+            mc_chart_free(&mc);
+            if (!built) {
+                return EXIT_FAILURE;
+            }
         } else {
             // 处理 .mcz 文件
             char abs_input_path[1024];
@@ -549,83 +907,137 @@ int main(const int argc, char *argv[]) {
                 return EXIT_FAILURE;
             }
 
-            // 生成解压目录路径
-            char unzip_dir[1024];
-            snprintf(unzip_dir, sizeof(unzip_dir), "%s_unzip", abs_input_path);
-
-            // 解压文件
-            if (!unzip_mcz(abs_input_path, unzip_dir)) {
-                return EXIT_FAILURE;
+            mc_chart mc;
+            char chart_dir[BUFFER_SIZE] = "";
+            char unzip_dir[1024] = "";
+            if (package_path) {
+                // 音频和资源都直接从 .mcz 中读取，谱面也从压缩包中解码，不解压到磁盘
+                if (!decode_archive_chart(abs_input_path, batch.preview_seconds, &mc, chart_dir, sizeof(chart_dir))) {
+                    mc_chart_free(&mc);
+                    return EXIT_FAILURE;
+                }
+            } else {
+                // 生成解压目录路径
+                snprintf(unzip_dir, sizeof(unzip_dir), "%s_unzip", abs_input_path);
+
+                // 解压文件
+                if (!unzip_mcz(abs_input_path, unzip_dir, thread_count)) {
+                    return EXIT_FAILURE;
+                }
+
+                // 获取唯一的子目录
+                char subdir[BUFFER_SIZE];
+                if (!get_unique_subdirectory(unzip_dir, subdir)) {
+                    fprintf(stderr, RED "==> 找到多个子目录或未找到包含 .mc 文件的目录，无法继续\n" RESET);
+                    fprintf(stderr, YELLOW "==> 谱面包请使用 -b %s 按歌曲批量转换\n" RESET, input_path);
+                    // 清理解压目录
+                    delete_directory_custom(unzip_dir);
+                    return EXIT_FAILURE;
+                }
+
+                // 获取所有 .mc 文件
+                char **mc_files = NULL;
+                int mc_file_count = 0;
+                if (!get_mc_files(subdir, &mc_files, &mc_file_count)) {
+                    // 清理解压目录
+                    delete_directory_custom(unzip_dir);
+                    return EXIT_FAILURE;
+                }
+
+                // 让用户选择一个文件
+                char *mc_file = choose_mc_file(mc_files, mc_file_count);
+                if (!mc_file) {
+                    // 清理解压目录
+                    delete_directory_custom(unzip_dir);
+                    return EXIT_FAILURE;
+                }
+
+                // 获取 mc 文件的完整路径并处理
+                char mc_file_path[BUFFER_SIZE];
+                snprintf(mc_file_path, sizeof(mc_file_path), "%s%c%s", subdir, PATH_SEPARATOR, mc_file);
+
+                printf(GREEN "==> 处理文件: %s\n" RESET, mc_file_path);
+
+                char *mc_content = read_file(mc_file_path);
+                if (!mc_content) {
+                    // 清理解压目录
+                    delete_directory_custom(unzip_dir);
+                    return EXIT_FAILURE;
+                }
+
+                const int decoded = mc_preview_string(mc_content, strlen(mc_content), batch.preview_seconds, &mc);
+                free(mc_content);
+                if (!decoded) {
+                    fprintf(stderr, RED "==> JSON 解析失败\n" RESET);
+                    mc_chart_free(&mc);
+                    // 清理解压目录
+                    delete_directory_custom(unzip_dir);
+                    return EXIT_FAILURE;
+                }
+
+                // 计算谱面目录在压缩包中的相对路径
+                const size_t unzip_dir_len = strlen(unzip_dir);
+                if (strncmp(subdir, unzip_dir, unzip_dir_len) == 0 && subdir[unzip_dir_len] == PATH_SEPARATOR) {
+                    snprintf(chart_dir, sizeof(chart_dir), "%s", subdir + unzip_dir_len + 1);
+                    for (char *p = chart_dir; *p; p++) {
+                        if (*p == PATH_SEPARATOR) *p = '/';
+                    }
+                }
             }
+            DEBUG_PRINT("OUTPUT_PATH: %s", output_path);
 
-            // 获取唯一的子目录
-            char subdir[BUFFER_SIZE];
-            if (!get_unique_subdirectory(unzip_dir, subdir)) {
-                fprintf(stderr, RED "==> 找到多个子目录或未找到包含 .mc 文件的目录，无法继续\n" RESET);
-                // 清理解压目录
-                delete_directory_custom(unzip_dir);
-                return EXIT_FAILURE;
+            // 直接从 .mcz 中读取音频文件头计算时长
+            double music_length = -1.0;
+            mz_zip_archive zip_archive = {0};
+            if (batch.preview_seconds <= 0 && mz_zip_reader_init_file(&zip_archive, abs_input_path, 0)) {
+                const int audio_index = locate_chart_audio(&zip_archive, chart_dir, extract_sound_file(&mc));
+                if (audio_index >= 0) {
+                    music_length = probe_zip_audio_length(&zip_archive, audio_index);
+                }
+                mz_zip_reader_end(&zip_archive);
             }
+            printf(BLUE "  -> Music Length: %lf\n" RESET, music_length);
 
-            // 获取所有 .mc 文件
-            char **mc_files = NULL;
-            int mc_file_count = 0;
-            if (!get_mc_files(subdir, &mc_files, &mc_file_count)) {
-                // 清理解压目录
-                delete_directory_custom(unzip_dir);
-                return EXIT_FAILURE;
+            // 提取数据并生成 Chart.json
+            chart_ir ir;
+            char *chart_string = NULL;
+            int chart_ok = mc_build_chart_ir(&mc, music_length, &ir);
+            if (chart_ok) {
+                if (batch.preview_seconds > 0) {
+                    chart_ir_truncate(&ir, batch.preview_seconds);
+                }
+                // 压缩输出时边序列化边写入，只有生成谱面包时才需要完整的文本
+                if (package_path || batch.compression == OUTPUT_COMPRESSION_NONE) {
+                    chart_string = create_chart_string(&ir, 1);
+                    chart_ok = chart_string != NULL;
+                }
             }
-
-            // 让用户选择一个文件
-            char *mc_file = choose_mc_file(mc_files, mc_file_count);
-            if (!mc_file) {
-                // 清理解压目录
-                delete_directory_custom(unzip_dir);
-                return EXIT_FAILURE;
+            if (chart_ok) {
+                chart_ok = batch.compression != OUTPUT_COMPRESSION_NONE
+                               ? chart_ir_write_file_compressed(&ir, output_path, batch.compression,
+                                                                batch.compression_level)
+                               : write_chart_string(chart_string, output_path);
             }
+            chart_ir_free(&ir);
 
-            // 获取 mc 文件的完整路径并处理
-            char mc_file_path[BUFFER_SIZE];
-            snprintf(mc_file_path, sizeof(mc_file_path), "%s%c%s", subdir, PATH_SEPARATOR, mc_file);
-
-            printf(GREEN "==> 处理文件: %s\n" RESET, mc_file_path);
-
-            char *mc_content = read_file(mc_file_path);
-            if (!mc_content) {
-                // 清理解压目录
-                delete_directory_custom(unzip_dir);
-                return EXIT_FAILURE;
+            // 生成谱面包，资源直接从 .mcz 中复制
+            if (chart_ok && package_path) {
+                chart_ok = create_blophy_package(abs_input_path, chart_dir, chart_string, package_path);
             }
-
-            cJSON *json = cJSON_Parse(mc_content);
-            free(mc_content);
-            if (!json) {
-                fprintf(stderr, RED "==> JSON 解析失败\n" RESET);
-                // 清理解压目录
-                delete_directory_custom(unzip_dir);
-                return EXIT_FAILURE;
-            }
-
-            // 提取数据并生成 Chart.json
-            const cJSON *notes = cJSON_GetObjectItem(json, "note");
-            const cJSON *time = cJSON_GetObjectItem(json, "time");
-
-            const double offset = extract_last_offset(notes);
-            cJSON *bpm_list = create_bpm_list(time);
-
-            DEBUG_PRINT("OUTPUT_PATH: %s", output_path);
-
-            create_chart_json(offset, bpm_list, output_path);
+            free(chart_string);
 
             // 删除解压目录
-            if (delete_directory_custom(unzip_dir) != 0) {
+            if (unzip_dir[0] && delete_directory_custom(unzip_dir) != 0) {
                 fprintf(stderr, RED "==> 无法删除解压目录: %s\n" RESET, unzip_dir);
-                cJSON_Delete(json);
+                mc_chart_free(&mc);
                 return EXIT_FAILURE;
             }
 
-            // 清理 JSON
-            cJSON_Delete(json);
+            // 清理谱面数据
+            mc_chart_free(&mc);
+            if (!chart_ok) {
+                return EXIT_FAILURE;
+            }
         }
     }
 
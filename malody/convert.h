@@ -1,15 +1,16 @@
 #pragma once
 #include "../includes/cross_platform.h"
 #include "tools.h"
+#include "create_bpmlist.h"
+#include "../includes/file_utils.h"
 void print_help(const char *program_name);
-char *read_file(const char *filename);
-int get_absolute_path(const char *path, char *abs_path);
 int create_directory_if_not_exists(const char *path);
-int unzip_mcz(const char *mcz_path, const char *output_dir);
+int unzip_mcz(const char *mcz_path, const char *output_dir, int thread_count);
 char *choose_mc_file(char **mc_files, int mc_file_count);
 char *read_stdin_custom();
-double extract_last_offset(const cJSON *notes);
-cJSON *create_bpm_list(const cJSON *bpm);
-cJSON *createBeatObject(double startBPM, double endBPM);
-void add_boxes_to_chart(cJSON *chart);
-void create_chart_json(double offset, cJSON *bpm_list, const char *output_path);
+void build_numbered_output_path(const char *output_path, int index, char *numbered_path, size_t size);
+char *convert_mc_json(const mc_chart *mc, int formatted, double preview_seconds);
+int process_ndjson_stdin(const char *output_path, double preview_seconds);
+char *create_chart_string(const chart_ir *ir, int formatted);
+int write_chart_string(const char *json_string, const char *output_path);
+int create_chart_json(const chart_ir *ir, const char *output_path, output_compression compression, int level);
@@ -0,0 +1,91 @@
+#include "create_bpmlist.h"
+#include "../includes/trace.h"
+
+// 提取最后的 offset 值并处理
+double extract_last_offset(const mc_chart *mc) {
+    if (!mc->has_note) {
+        LOG_ERROR(RED "==> note 字段不是数组\n" RESET);
+        return 0;
+    }
+
+    if (mc->note_count == 0) {
+        LOG_ERROR(RED "==> note 数组为空\n" RESET);
+        return 0;
+    }
+
+    if (!mc->has_last_offset) {
+        LOG_ERROR(RED "==> 未找到有效的 offset 值\n" RESET);
+        return 0;
+    }
+
+    const double result = mc->last_offset;
+
+    LOG_INFO(BLUE "  -> Offset: %lf\n", result);
+
+    return result;
+}
+
+// 查找谱面引用的音频文件名（Malody 的音频信息在带 sound 字段的 note 中）
+const char *extract_sound_file(const mc_chart *mc) {
+    return mc->sound;
+}
+
+// 生成 bpmList
+int mc_create_bpm_list(const mc_chart *mc, chart_ir *ir) {
+    if (!mc->has_time) {
+        LOG_ERROR(RED "==> time 字段不是数组\n" RESET);
+        return 0;
+    }
+
+    TRACE_PROBE1(bpm_list_start, mc->time_count);
+    const double trace_start_time = trace_begin();
+    for (int i = 0; i < mc->time_count; i++) {
+        const mc_time_point *point = &mc->time[i];
+        const int a = point->beat[0];
+        const int b = point->beat[1];
+        const int c = point->beat[2];
+
+        const double e = (c != 0) ? a + (double) b / c : a;
+
+        const chart_beat beat = {a, b, c, point->bpm, e};
+        if (!chart_ir_add_tempo(ir, &beat)) {
+            return 0;
+        }
+    }
+
+    TRACE_PROBE1(bpm_list_done, mc->time_count);
+    trace_end("create_bpm_list", trace_start_time, NULL);
+    LOG_INFO(BLUE "  -> BPM List解析完成.\n");
+
+    return 1;
+}
+
+// 由解码后的 .mc 谱面生成中间表示，music_length 未知时为 -1；失败时 ir 仍需 chart_ir_free
+int mc_build_chart_ir(const mc_chart *mc, const double music_length, chart_ir *ir) {
+    const double offset = extract_last_offset(mc);
+    if (!chart_ir_init(ir, offset / 1000, music_length, mc->time_count)) {
+        return 0;
+    }
+    if (!mc_create_bpm_list(mc, ir)) {
+        return 0;
+    }
+
+    LOG_INFO(BLUE " -> 文件初始化完成.\n" RESET);
+    return 1;
+}
+
+int mc_stats_add_note(void *user, const mc_note *note) {
+    if (note->type == 1) return 1;
+    return chart_stats_add_note(user, note->beat, note->end_beat, note->column);
+}
+
+void mc_stats_take_meta(mc_chart *mc, chart_stats *stats) {
+    mc_meta *meta = &mc->meta;
+    stats->title = meta->title;
+    stats->artist = meta->artist;
+    stats->version = meta->version;
+    stats->creator = meta->creator;
+    stats->mode = meta->mode;
+    stats->columns = meta->columns;
+    meta->title = meta->artist = meta->version = meta->creator = NULL;
+}
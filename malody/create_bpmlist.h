@@ -0,0 +1,18 @@
+#pragma once
+#include "../includes/cross_platform.h"
+#include "mc_decode.h"
+#include "../includes/chart_ir.h"
+#include "../includes/chart_stats.h"
+
+// 提取最后一个 note 的 offset（毫秒）
+double extract_last_offset(const mc_chart *mc);
+// 查找谱面引用的音频文件名
+const char *extract_sound_file(const mc_chart *mc);
+// 生成 bpmList
+int mc_create_bpm_list(const mc_chart *mc, chart_ir *ir);
+// 由解码后的 .mc 谱面生成中间表示，music_length 未知时为 -1；失败时 ir 仍需 chart_ir_free
+int mc_build_chart_ir(const mc_chart *mc, double music_length, chart_ir *ir);
+// 分析模式的 note 回调，user 为 chart_stats；音频 note (type 1) 不计入统计
+int mc_stats_add_note(void *user, const mc_note *note);
+// 把解码出的 meta 移交给统计结果
+void mc_stats_take_meta(mc_chart *mc, chart_stats *stats);
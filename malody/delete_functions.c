@@ -1,4 +1,5 @@
 #include "tools.h"
+#include "../includes/file_utils.h"
 
 int remove_file_custom(const char *filename) {
 #ifdef _WIN32
@@ -86,7 +87,7 @@ int delete_directory_contents(const char *dir_path) {
         char file_path[1024];
         snprintf(file_path, sizeof(file_path), "%s%c%s", dir_path, PATH_SEPARATOR, entry->d_name);
 
-        if (entry->d_type == DT_DIR) {
+        if (dirent_is_directory(dir_path, entry)) {
             // 如果是子目录，递归删除
             if (delete_directory_custom(file_path) != 0) {
                 closedir(d);
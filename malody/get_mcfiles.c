@@ -1,4 +1,5 @@
 #include "tools.h"
+#include "../includes/file_utils.h"
 
 int get_mc_files(const char *dir, char ***mc_files, int *mc_file_count) {
     DEBUG_PRINT("获取目录 %s 下所有 .mc 文件\n", dir);
@@ -94,7 +95,7 @@ int get_mc_files(const char *dir, char ***mc_files, int *mc_file_count) {
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
             continue;
 
-        if (entry->d_type == DT_DIR) {
+        if (dirent_is_directory(dir, entry)) {
             // 如果是目录，则递归查找子目录
             char subdir[BUFFER_SIZE];
             snprintf(subdir, sizeof(subdir), "%s%c%s", dir, PATH_SEPARATOR, entry->d_name);
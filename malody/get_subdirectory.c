@@ -1,4 +1,5 @@
 #include "tools.h"
+#include "../includes/file_utils.h"
 
 int get_unique_subdirectory(const char *dir, char *subdir) {
     DEBUG_PRINT("递归查找目录 %s 下的 .mc 文件\n", dir);
@@ -49,7 +50,7 @@ int get_unique_subdirectory(const char *dir, char *subdir) {
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
             continue;
 
-        if (entry->d_type == DT_DIR) {
+        if (dirent_is_directory(dir, entry)) {
             // 如果是目录，则递归查找
             char subdir_path[BUFFER_SIZE];
             snprintf(subdir_path, sizeof(subdir_path), "%s%c%s", dir, PATH_SEPARATOR, entry->d_name);
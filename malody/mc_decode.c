@@ -0,0 +1,376 @@
+#include "mc_decode.h"
+#include <math.h>
+#include "../includes/trace.h"
+
+enum {
+    MC_KEY_UNKNOWN = 0,
+    MC_KEY_TIME,
+    MC_KEY_NOTE,
+    MC_KEY_BEAT,
+    MC_KEY_BPM,
+    MC_KEY_OFFSET,
+    MC_KEY_SOUND,
+    MC_KEY_META,
+};
+
+#define MC_KEY_MASK 63u
+
+static const schema_key mc_keys[MC_KEY_MASK + 1] = {
+    SCHEMA_KEY(MC_KEY_MASK, "time", 't', 'e', MC_KEY_TIME),
+    SCHEMA_KEY(MC_KEY_MASK, "note", 'n', 'e', MC_KEY_NOTE),
+    SCHEMA_KEY(MC_KEY_MASK, "beat", 'b', 't', MC_KEY_BEAT),
+    SCHEMA_KEY(MC_KEY_MASK, "bpm", 'b', 'm', MC_KEY_BPM),
+    SCHEMA_KEY(MC_KEY_MASK, "offset", 'o', 't', MC_KEY_OFFSET),
+    SCHEMA_KEY(MC_KEY_MASK, "sound", 's', 'd', MC_KEY_SOUND),
+    SCHEMA_KEY(MC_KEY_MASK, "meta", 'm', 'a', MC_KEY_META),
+};
+
+// 分析模式中 note 和 meta 的字段。type 与 time 的哈希相同，不能放进上面的键表
+enum {
+    MC_DETAIL_UNKNOWN = 0,
+    MC_DETAIL_BEAT,
+    MC_DETAIL_END_BEAT,
+    MC_DETAIL_COLUMN,
+    MC_DETAIL_TYPE,
+    MC_DETAIL_OFFSET,
+    MC_DETAIL_SOUND,
+    MC_DETAIL_VERSION,
+    MC_DETAIL_CREATOR,
+    MC_DETAIL_MODE,
+    MC_DETAIL_MODE_EXT,
+    MC_DETAIL_SONG,
+    MC_DETAIL_TITLE,
+    MC_DETAIL_ARTIST,
+};
+
+#define MC_DETAIL_MASK 31u
+
+static const schema_key mc_detail_keys[MC_DETAIL_MASK + 1] = {
+    SCHEMA_KEY(MC_DETAIL_MASK, "beat", 'b', 't', MC_DETAIL_BEAT),
+    SCHEMA_KEY(MC_DETAIL_MASK, "endbeat", 'e', 't', MC_DETAIL_END_BEAT),
+    SCHEMA_KEY(MC_DETAIL_MASK, "column", 'c', 'n', MC_DETAIL_COLUMN),
+    SCHEMA_KEY(MC_DETAIL_MASK, "type", 't', 'e', MC_DETAIL_TYPE),
+    SCHEMA_KEY(MC_DETAIL_MASK, "offset", 'o', 't', MC_DETAIL_OFFSET),
+    SCHEMA_KEY(MC_DETAIL_MASK, "sound", 's', 'd', MC_DETAIL_SOUND),
+    SCHEMA_KEY(MC_DETAIL_MASK, "version", 'v', 'n', MC_DETAIL_VERSION),
+    SCHEMA_KEY(MC_DETAIL_MASK, "creator", 'c', 'r', MC_DETAIL_CREATOR),
+    SCHEMA_KEY(MC_DETAIL_MASK, "mode", 'm', 'e', MC_DETAIL_MODE),
+    SCHEMA_KEY(MC_DETAIL_MASK, "mode_ext", 'm', 't', MC_DETAIL_MODE_EXT),
+    SCHEMA_KEY(MC_DETAIL_MASK, "song", 's', 'g', MC_DETAIL_SONG),
+    SCHEMA_KEY(MC_DETAIL_MASK, "title", 't', 'e', MC_DETAIL_TITLE),
+    SCHEMA_KEY(MC_DETAIL_MASK, "artist", 'a', 't', MC_DETAIL_ARTIST),
+};
+
+// time 数组中正在解码的一项 {beat: [a, b, c], bpm}
+typedef struct {
+    double beat[3];
+    double bpm;
+    int has_beat;
+    int has_bpm;
+} mc_time_fields;
+
+static int decode_time_field(json_reader *r, void *ctx, const int key, const json_token_type token) {
+    mc_time_fields *fields = ctx;
+    if (key == MC_KEY_BEAT) {
+        fields->has_beat = token == JSON_TOKEN_ARRAY_START;
+        return schema_read_numbers(r, token, fields->beat, 3);
+    }
+    if (key == MC_KEY_BPM) {
+        return fields->has_bpm = schema_read_number(r, token, &fields->bpm);
+    }
+    return json_reader_skip(r, token) ? 0 : -1;
+}
+
+static int decode_time_point(json_reader *r, void *ctx, const json_token_type token) {
+    mc_chart *chart = ctx;
+    mc_time_fields fields = {0};
+    if (schema_read_object(r, token, mc_keys, MC_KEY_MASK, &fields, decode_time_field) < 0) return -1;
+
+    if (!fields.has_beat || fields.has_bpm != 1) {
+        LOG_ERROR(RED "==> time 数组中的元素格式不正确\n" RESET);
+        return 0;
+    }
+    if (!schema_array_reserve((void **) &chart->time, &chart->time_capacity, chart->time_count,
+                              sizeof(mc_time_point))) {
+        return -1;
+    }
+    mc_time_point *point = &chart->time[chart->time_count++];
+    for (int i = 0; i < 3; i++) {
+        point->beat[i] = (int) fields.beat[i];
+    }
+    point->bpm = fields.bpm;
+    return 1;
+}
+
+// note 只保留 offset 和 sound
+static int decode_note_field(json_reader *r, void *ctx, const int key, const json_token_type token) {
+    mc_chart *chart = ctx;
+    if (key == MC_KEY_OFFSET) {
+        return chart->has_last_offset = schema_read_number(r, token, &chart->last_offset);
+    }
+    if (key == MC_KEY_SOUND) {
+        return schema_read_string(r, token, &chart->sound);
+    }
+    return json_reader_skip(r, token) ? 0 : -1;
+}
+
+static int read_int(json_reader *r, const json_token_type token, int *value) {
+    double number = 0;
+    const int result = schema_read_number(r, token, &number);
+    if (result == 1) *value = (int) number;
+    return result;
+}
+
+// [小节, 分子, 分母] 换算为小数拍
+static double beat_value(const double *beat) {
+    return beat[2] != 0 ? beat[0] + beat[1] / beat[2] : beat[0];
+}
+
+// 分析和预览模式中正在解码的 note
+typedef struct {
+    mc_chart *chart;
+    mc_note note;
+    double beat[3];
+    double end_beat[3];
+    int has_beat;
+    int has_end_beat;
+    int has_sound;
+} mc_note_fields;
+
+static int decode_note_detail(json_reader *r, void *ctx, const int key, const json_token_type token) {
+    mc_note_fields *fields = ctx;
+    mc_chart *chart = fields->chart;
+    switch (key) {
+        case MC_DETAIL_BEAT:
+            fields->has_beat = token == JSON_TOKEN_ARRAY_START;
+            return schema_read_numbers(r, token, fields->beat, 3);
+        case MC_DETAIL_END_BEAT:
+            fields->has_end_beat = token == JSON_TOKEN_ARRAY_START;
+            return schema_read_numbers(r, token, fields->end_beat, 3);
+        case MC_DETAIL_COLUMN:
+            return read_int(r, token, &fields->note.column);
+        case MC_DETAIL_TYPE:
+            return read_int(r, token, &fields->note.type);
+        case MC_DETAIL_OFFSET:
+            return chart->has_last_offset = schema_read_number(r, token, &chart->last_offset);
+        case MC_DETAIL_SOUND:
+            return fields->has_sound = schema_read_string(r, token, &chart->sound);
+        default:
+            return json_reader_skip(r, token) ? 0 : -1;
+    }
+}
+
+// 分析模式：读取 note 的拍数、列和类型后交给回调，没有 beat 字段的 note 不交给回调
+static int decode_note_for_analysis(json_reader *r, mc_chart *chart, const json_token_type token) {
+    mc_note_fields fields = {0};
+    fields.chart = chart;
+    fields.note.end_beat = -1;
+    fields.note.column = -1;
+    const int result = schema_read_object(r, token, mc_detail_keys, MC_DETAIL_MASK, &fields, decode_note_detail);
+    if (result != 1 || !fields.has_beat) return result;
+    fields.note.beat = beat_value(fields.beat);
+    if (fields.has_end_beat) {
+        fields.note.end_beat = beat_value(fields.end_beat);
+    }
+    return chart->on_note(chart->note_user, &fields.note) ? 1 : -1;
+}
+
+// 预览窗口结束处的拍数：与 chart_ir_beat_to_seconds 一样按 time 数组逐段累加时间，
+// time 尚未读到或窗口结束前 BPM 不为正时返回 HUGE_VAL，不跳过任何 note
+static double preview_end_beat(const mc_chart *chart) {
+    if (chart->time_count == 0) return HUGE_VAL;
+    double elapsed = 0.0;
+    double last_beat = 0.0;
+    double bpm = chart->time[0].bpm;
+    for (int i = 0; i < chart->time_count; i++) {
+        const int *beat = chart->time[i].beat;
+        const double point = beat[2] != 0 ? beat[0] + (double) beat[1] / beat[2] : beat[0];
+        if (point > last_beat) {
+            if (bpm > 0) {
+                const double segment = (point - last_beat) * 60.0 / bpm;
+                if (elapsed + segment > chart->preview_seconds) break;
+                elapsed += segment;
+            }
+            last_beat = point;
+        }
+        bpm = chart->time[i].bpm;
+    }
+    return bpm > 0 ? last_beat + (chart->preview_seconds - elapsed) * bpm / 60.0 : HUGE_VAL;
+}
+
+// 预览模式：窗口之后开始的 note（音频 note 除外）不计入，offset 恢复为之前的值。
+// 窗口之后只剩音频 note 需要查找，它已经读到时停止解码
+static int decode_note_for_preview(json_reader *r, mc_chart *chart, const json_token_type token) {
+    const int had_sound = chart->sound != NULL;
+    const int has_last_offset = chart->has_last_offset;
+    const double last_offset = chart->last_offset;
+    mc_note_fields fields = {0};
+    fields.chart = chart;
+    chart->has_last_offset = 0;
+    const int result = schema_read_object(r, token, mc_detail_keys, MC_DETAIL_MASK, &fields, decode_note_detail);
+    if (result != 1 || !fields.has_beat || fields.has_sound == 1 || beat_value(fields.beat) <= chart->preview_beat) {
+        chart->note_count++;
+        return result;
+    }
+    chart->has_last_offset = has_last_offset;
+    chart->last_offset = last_offset;
+    if (!had_sound) return 1;
+    chart->preview_stopped = 1;
+    return SCHEMA_STOP;
+}
+
+static int decode_note(json_reader *r, void *ctx, const json_token_type token) {
+    mc_chart *chart = ctx;
+    if (chart->preview_seconds > 0) {
+        return decode_note_for_preview(r, chart, token);
+    }
+    chart->note_count++;
+    chart->has_last_offset = 0;
+    if (chart->on_note) {
+        return decode_note_for_analysis(r, chart, token);
+    }
+    return schema_read_object(r, token, mc_keys, MC_KEY_MASK, chart, decode_note_field);
+}
+
+// meta 及其中的 song、mode_ext 对象
+static int decode_meta_field(json_reader *r, void *ctx, const int key, const json_token_type token) {
+    mc_chart *chart = ctx;
+    mc_meta *meta = &chart->meta;
+    switch (key) {
+        case MC_DETAIL_VERSION:
+            return schema_read_string(r, token, &meta->version);
+        case MC_DETAIL_CREATOR:
+            return schema_read_string(r, token, &meta->creator);
+        case MC_DETAIL_TITLE:
+            return schema_read_string(r, token, &meta->title);
+        case MC_DETAIL_ARTIST:
+            return schema_read_string(r, token, &meta->artist);
+        case MC_DETAIL_MODE:
+            return read_int(r, token, &meta->mode);
+        case MC_DETAIL_COLUMN:
+            return read_int(r, token, &meta->columns);
+        case MC_DETAIL_SONG:
+        case MC_DETAIL_MODE_EXT:
+            return schema_read_object(r, token, mc_detail_keys, MC_DETAIL_MASK, chart, decode_meta_field);
+        default:
+            return json_reader_skip(r, token) ? 0 : -1;
+    }
+}
+
+static int decode_chart_field(json_reader *r, void *ctx, const int key, const json_token_type token) {
+    mc_chart *chart = ctx;
+    if (key == MC_KEY_TIME) {
+        chart->has_time = token == JSON_TOKEN_ARRAY_START;
+        return schema_read_array(r, token, chart, decode_time_point);
+    }
+    if (key == MC_KEY_NOTE) {
+        chart->has_note = token == JSON_TOKEN_ARRAY_START;
+        chart->preview_beat = preview_end_beat(chart);
+        return schema_read_array(r, token, chart, decode_note);
+    }
+    if (key == MC_KEY_META && chart->on_note) {
+        return schema_read_object(r, token, mc_detail_keys, MC_DETAIL_MASK, chart, decode_meta_field);
+    }
+    return json_reader_skip(r, token) ? 0 : -1;
+}
+
+static int decode_chart(json_reader *r, mc_chart *chart, const mc_note_fn on_note, void *user,
+                        const double preview_seconds) {
+    memset(chart, 0, sizeof(*chart));
+    chart->meta.mode = -1;
+    chart->meta.columns = -1;
+    chart->on_note = on_note;
+    chart->note_user = user;
+    chart->preview_seconds = preview_seconds > 0 ? preview_seconds : 0.0;
+    return schema_decode_document(r, mc_keys, MC_KEY_MASK, chart, decode_chart_field);
+}
+
+int mc_decode(json_reader *r, mc_chart *chart) {
+    return decode_chart(r, chart, NULL, NULL, 0.0);
+}
+
+static int decode_string(const char *json, const size_t len, mc_chart *chart, const mc_note_fn on_note,
+                         void *user, const double preview_seconds) {
+    TRACE_PROBE2(parse_start, "malody", len);
+    const double trace_start_time = trace_begin();
+    json_reader r;
+    json_reader_init_mem(&r, json, len);
+    const int ok = decode_chart(&r, chart, on_note, user, preview_seconds);
+    TRACE_PROBE2(parse_done, "malody", ok);
+    trace_end("decode", trace_start_time, NULL);
+    if (!ok && r.error) {
+        DEBUG_PRINT("JSON 解析失败: %s\n", r.error);
+    }
+    json_reader_free(&r);
+    return ok;
+}
+
+int mc_decode_string(const char *json, const size_t len, mc_chart *chart) {
+    return decode_string(json, len, chart, NULL, NULL, 0.0);
+}
+
+int mc_analyze_string(const char *json, const size_t len, mc_chart *chart, const mc_note_fn on_note, void *user) {
+    return decode_string(json, len, chart, on_note, user, 0.0);
+}
+
+int mc_preview_string(const char *json, const size_t len, const double seconds, mc_chart *chart) {
+    return decode_string(json, len, chart, NULL, NULL, seconds);
+}
+
+static size_t read_zip_block(void *ctx, char *buf, const size_t size) {
+    return mz_zip_reader_extract_iter_read(ctx, buf, size);
+}
+
+static int decode_zip_entry(mz_zip_archive *zip, const unsigned int index, mc_chart *chart,
+                            const mc_note_fn on_note, void *user, const double preview_seconds) {
+    memset(chart, 0, sizeof(*chart));
+    TRACE_PROBE2(parse_start, "malody", 0);
+    const double trace_start_time = trace_begin();
+    mz_zip_reader_extract_iter_state *iter = mz_zip_reader_extract_iter_new(zip, index, 0);
+    if (!iter) {
+        return 0;
+    }
+    json_reader r;
+    int ok = json_reader_init(&r, read_zip_block, iter, MC_STREAM_BLOCK_SIZE) &&
+             decode_chart(&r, chart, on_note, user, preview_seconds);
+    if (!ok && r.error) {
+        DEBUG_PRINT("JSON 解析失败: %s\n", r.error);
+    }
+    json_reader_free(&r);
+    // 读完剩余内容（通常只是结尾的换行），解压完整时 iter_free 才会校验 CRC-32；
+    // 预览提前停止时不再解压剩余内容，也就无法校验
+    char rest[256];
+    if (ok && chart->preview_stopped) {
+        mz_zip_reader_extract_iter_free(iter);
+    } else {
+        while (ok && read_zip_block(iter, rest, sizeof(rest)) > 0) {
+        }
+        ok = mz_zip_reader_extract_iter_free(iter) && ok;
+    }
+    TRACE_PROBE2(parse_done, "malody", ok);
+    trace_end("decode", trace_start_time, NULL);
+    return ok;
+}
+
+int mc_decode_zip_entry(mz_zip_archive *zip, const unsigned int index, mc_chart *chart) {
+    return decode_zip_entry(zip, index, chart, NULL, NULL, 0.0);
+}
+
+int mc_analyze_zip_entry(mz_zip_archive *zip, const unsigned int index, mc_chart *chart, const mc_note_fn on_note,
+                         void *user) {
+    return decode_zip_entry(zip, index, chart, on_note, user, 0.0);
+}
+
+int mc_preview_zip_entry(mz_zip_archive *zip, const unsigned int index, const double seconds, mc_chart *chart) {
+    return decode_zip_entry(zip, index, chart, NULL, NULL, seconds);
+}
+
+void mc_chart_free(mc_chart *chart) {
+    free(chart->time);
+    free(chart->sound);
+    free(chart->meta.version);
+    free(chart->meta.creator);
+    free(chart->meta.title);
+    free(chart->meta.artist);
+    memset(chart, 0, sizeof(*chart));
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "../includes/schema_decode.h"
+
+// 流式解码时每次解压和解析的块大小
+#define MC_STREAM_BLOCK_SIZE (32 * 1024)
+
+// .mc 谱面中转换所需的字段，由 schema 解码器直接填充
+
+typedef struct {
+    int beat[3]; // 小节、分子、分母
+    double bpm;
+} mc_time_point;
+
+// 分析模式中逐个交给回调的 note，拍数已换算为小数
+typedef struct {
+    double beat;
+    double end_beat; // 长条的结束拍，不是长条时为 -1
+    int column; // 没有 column 字段（非 Key 模式）时为 -1
+    int type; // 普通 note 为 0，带 sound 字段的音频 note 为 1
+} mc_note;
+
+// 返回 0 时中止解码
+typedef int (*mc_note_fn)(void *user, const mc_note *note);
+
+// 谱面信息 (meta)，只在分析模式中解码，未给出的字段为 NULL / -1
+typedef struct {
+    char *version; // 难度名
+    char *creator;
+    char *title;
+    char *artist;
+    int mode;
+    int columns; // mode_ext.column
+} mc_meta;
+
+typedef struct {
+    mc_time_point *time;
+    int time_count;
+    int time_capacity;
+    int has_time; // time 字段存在且为数组
+
+    int note_count;
+    int has_note; // note 字段存在且为数组
+    double last_offset; // 最后一个 note 的 offset
+    int has_last_offset;
+    char *sound; // 最后一个带 sound 字段的 note 中的音频文件名
+
+    mc_meta meta;
+    mc_note_fn on_note; // 分析模式的 note 回调，转换时为 NULL
+    void *note_user;
+    double preview_seconds; // 预览窗口长度，不是预览时为 0
+    double preview_beat; // 预览窗口结束处的拍数，读到 note 数组时按已解码的 time 计算
+    int preview_stopped; // 预览已提前停止，文档剩余部分没有读取
+} mc_chart;
+
+// 解码 .mc 谱面，成功返回 1；失败时 chart 中已解码的内容仍需 mc_chart_free
+int mc_decode(json_reader *r, mc_chart *chart);
+int mc_decode_string(const char *json, size_t len, mc_chart *chart);
+// 流式解码压缩包中的 .mc 条目：按 MC_STREAM_BLOCK_SIZE 分块解压后直接交给读取器，
+// 不在内存中保留解压后的完整文本，峰值内存只取决于块大小和解码出的 BPM 点
+int mc_decode_zip_entry(mz_zip_archive *zip, unsigned int index, mc_chart *chart);
+// 分析模式：同上，另外解码 meta，并把每个 note 的拍数、列和类型交给 on_note，不保存 note
+int mc_analyze_string(const char *json, size_t len, mc_chart *chart, mc_note_fn on_note, void *user);
+int mc_analyze_zip_entry(mz_zip_archive *zip, unsigned int index, mc_chart *chart, mc_note_fn on_note, void *user);
+// 预览：同 mc_decode_*，开始时间晚于 seconds 的 note 不计入（也不作为最后一个 note 提供 offset）；
+// 音频 note 已经读到后，遇到窗口之后的 note 即停止，不再读取和解压剩余内容。seconds 不大于 0 时完整解码
+int mc_preview_string(const char *json, size_t len, double seconds, mc_chart *chart);
+int mc_preview_zip_entry(mz_zip_archive *zip, unsigned int index, double seconds, mc_chart *chart);
+void mc_chart_free(mc_chart *chart);
@@ -0,0 +1,91 @@
+#include "tools.h"
+
+// 判断文件名是否为需要打包的音频或图片资源
+static int is_package_asset(const char *filename) {
+    static const char *extensions[] = {".ogg", ".mp3", ".wav", ".jpg", ".jpeg", ".png"};
+    const char *dot = strrchr(filename, '.');
+    if (!dot) return 0;
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+        if (STRCASECMP(dot, extensions[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+// 判断压缩包内的条目是否直接位于 prefix 目录下（prefix 为空表示根目录）
+static int is_in_directory(const char *filename, const char *prefix) {
+    const size_t prefix_len = strlen(prefix);
+    if (prefix_len > 0) {
+        if (strncmp(filename, prefix, prefix_len) != 0 || filename[prefix_len] != '/') return 0;
+        filename += prefix_len + 1;
+    }
+    return strchr(filename, '/') == NULL;
+}
+
+// 生成 Blophy 谱面包：音频和图片直接从 .mcz 中按原始压缩数据复制，不重新压缩
+int create_blophy_package(const char *mcz_path, const char *chart_dir, const char *chart_json,
+                          const char *package_path) {
+    DEBUG_PRINT("生成谱面包: %s (来源: %s, 目录: %s)\n", package_path, mcz_path, chart_dir);
+    mz_zip_archive source = {0};
+    if (!mz_zip_reader_init_file(&source, mcz_path, 0)) {
+        fprintf(stderr, RED "==> 无法打开 .mcz 文件: %s\n" RESET, mcz_path);
+        return 0;
+    }
+
+    mz_zip_archive package = {0};
+    if (!mz_zip_writer_init_file(&package, package_path, 0)) {
+        fprintf(stderr, RED "==> 无法创建谱面包: %s\n" RESET, package_path);
+        mz_zip_reader_end(&source);
+        return 0;
+    }
+
+    int ok = 1;
+    const unsigned int num_files = mz_zip_reader_get_num_files(&source);
+    for (unsigned int i = 0; i < num_files && ok; i++) {
+        mz_zip_archive_file_stat file_stat;
+        if (!mz_zip_reader_file_stat(&source, i, &file_stat)) {
+            fprintf(stderr, RED "==> 无法获取文件信息: %u\n" RESET, i);
+            ok = 0;
+            break;
+        }
+        if (file_stat.m_is_directory || !is_in_directory(file_stat.m_filename, chart_dir) ||
+            !is_package_asset(file_stat.m_filename)) {
+            continue;
+        }
+
+        if (!mz_zip_writer_add_from_zip_reader(&package, &source, i)) {
+            fprintf(stderr, RED "==> 复制资源失败: %s\n" RESET, file_stat.m_filename);
+            ok = 0;
+            break;
+        }
+        printf(BLUE " -> 已复制资源: %s\n" RESET, file_stat.m_filename);
+    }
+
+    if (ok) {
+        char chart_name[BUFFER_SIZE];
+        if (chart_dir[0] != '\0') {
+            snprintf(chart_name, sizeof(chart_name), "%s/Chart.json", chart_dir);
+        } else {
+            snprintf(chart_name, sizeof(chart_name), "Chart.json");
+        }
+        if (!mz_zip_writer_add_mem(&package, chart_name, chart_json, strlen(chart_json), MZ_DEFAULT_LEVEL)) {
+            fprintf(stderr, RED "==> 写入 Chart.json 失败\n" RESET);
+            ok = 0;
+        }
+    }
+
+    if (ok && !mz_zip_writer_finalize_archive(&package)) {
+        fprintf(stderr, RED "==> 谱面包写入失败: %s\n" RESET, package_path);
+        ok = 0;
+    }
+
+    mz_zip_writer_end(&package);
+    mz_zip_reader_end(&source);
+
+    if (!ok) {
+        REMOVE_FILE(package_path);
+        return 0;
+    }
+
+    printf(GREEN "==> 谱面包已生成: %s\n" RESET, package_path);
+    return 1;
+}
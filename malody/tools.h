@@ -7,4 +7,12 @@ int remove_file_custom(const char *filename);
 // 删除目录
 int delete_directory_custom(const char *dir_path);
 int delete_directory_contents(const char *dir_path);
-int get_mc_files(const char *dir, char ***mc_files, int *mc_file_count);
\ No newline at end of file
+int get_mc_files(const char *dir, char ***mc_files, int *mc_file_count);
+// 生成 Blophy 谱面包，资源从 .mcz 原样复制
+int create_blophy_package(const char *mcz_path, const char *chart_dir, const char *chart_json,
+                          const char *package_path);
+// 只读取文件头尾计算音频时长（秒），无法识别时返回 -1
+double probe_zip_audio_length(mz_zip_archive *zip, unsigned int file_index);
+double probe_file_audio_length(const char *path);
+// 查找谱面目录下的音频条目，未找到返回 -1
+int locate_chart_audio(mz_zip_archive *zip, const char *chart_dir, const char *sound);
\ No newline at end of file
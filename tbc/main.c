@@ -0,0 +1,236 @@
+#include "../includes/cross_platform.h"
+#include "../includes/chart_format.h"
+#include "../includes/chart_validate.h"
+#include "../includes/file_utils.h"
+#include "../includes/trace.h"
+#include "../malody/batch.h"
+#include "../malody/batch_shard.h"
+
+// 帮助信息
+static void print_help(const char *program_name) {
+    printf("用法: %s [选项] <输入文件或目录>...\n", program_name);
+    printf("按内容识别输入格式（.mcz、Malody、Cylheim、Lanota），转换为 Blophy 谱面\n");
+    printf("选项:\n");
+    printf("  -f <文件路径>       转换单个谱面文件，输出到 -o 指定的 Chart.json\n");
+    printf("  -o <输出路径>       单文件模式为 Chart.json 路径（默认 Chart.json），\n");
+    printf("                      批量模式为输出目录（默认 blophy_output）\n");
+    printf("  --stage-workers <配置>  批量模式各阶段线程数，如 load=2,parse=4,convert=4,serialize=2,write=2；\n");
+    printf("                          discover 为并行遍历输入目录的线程数\n");
+    printf("  --queue-depth <数量>    批量模式阶段之间队列的容量（默认 64）\n");
+    printf("  --io <后端>         批量模式的读写后端: auto、stdio 或 uring（默认 auto）\n");
+    printf("  --metrics <文件>    批量模式定期把运行指标写成 Prometheus textfile\n");
+    printf("  --metrics-interval <秒>  指标输出间隔（默认 10 秒）\n");
+    printf("  --trace <文件>      把各线程处理每个文件的时间线写成 Chrome Trace JSON（可用 Perfetto 查看）\n");
+    printf("  --no-fsync          批量模式不等待输出落盘（仍使用临时文件加重命名）\n");
+    printf("  --resume            批量模式跳过任务日志中已完成且未改动的输入\n");
+    printf("  --retry-crashed     同 --resume，并重试之前单独处理时进程中断而跳过的输入（保留任务日志）\n");
+    printf("  --journal <文件>    批量模式的任务日志（默认为输出目录下的 %s）\n", BATCH_JOURNAL_NAME);
+    printf("  --shard <i/N>       批量模式只转换第 i 个分片（共 N 个），结束时在输出目录写入分片清单\n");
+    printf("  --merge-shards      检查 -o 目录中各分片的清单；给出输入时同时检查每个输入都已转换\n");
+    printf("  --preview <秒>      只输出开头这么多秒的预览谱面（完整 bpmList 和 offset），不探测音频时长\n");
+    printf("  --job-timeout <秒>  批量模式单个谱面的处理时间预算，超出时记为失败\n");
+    printf("  --job-memory <MB>   批量模式单个谱面的内存预算（输入、解压后的谱面和中间数据）\n");
+    printf("  --archive-limit <MB>  批量模式 .mcz 中谱面解压后的总大小上限，解压前检查\n");
+    printf("  --isolate           批量模式在子进程中处理每个谱面，用 rlimit 限制内存和 CPU 时间，崩溃只影响该谱面\n");
+    printf("  --compress <格式>   输出 gzip 或 zlib 压缩的 Chart.json（文件名追加 .gz / .zz），序列化时直接压缩\n");
+    printf("  --compress-level <级别>  压缩级别 0-9（默认 %d）\n", MZ_DEFAULT_LEVEL);
+    printf("  --analyze <格式>    只统计谱面（note 数量、BPM、时长、密度峰值和谱面信息），不输出 Chart.json；\n");
+    printf("                      每个谱面输出一行 json 或 csv 到 -o 指定的文件（默认标准输出）\n");
+    printf("  --validate <文件>   校验 Chart.json 文件后退出\n");
+    printf("  -h                  显示帮助信息\n");
+    printf("未指定 -f 时，所有输入文件和目录（递归查找 .mc/.mcz/.json/.txt）在同一个流水线中转换\n");
+}
+
+// 单文件模式：识别格式后交给对应前端，预览和压缩选项与批量模式相同
+static int convert_single_file(const char *input_path, const char *output_path, const batch_options *options) {
+    size_t size;
+    char *content = read_file_sized(input_path, &size);
+    if (!content) {
+        return 0;
+    }
+
+    const chart_format format = chart_format_detect(content, size);
+    printf(BLUE " -> 输入格式: %s\n" RESET, chart_format_name(format));
+    if (format == CHART_FORMAT_MCZ) {
+        fprintf(stderr, RED "==> .mcz 文件请直接作为输入参数，使用批量模式转换\n" RESET);
+        free(content);
+        return 0;
+    }
+
+    chart_ir ir;
+    int built = chart_format_build(format, content, size, -1.0, options->preview_seconds, &ir);
+    if (built && options->preview_seconds > 0) {
+        chart_ir_truncate(&ir, options->preview_seconds);
+    }
+    // 压缩输出时文件名追加 .gz / .zz
+    char compressed_path[1024];
+    const char *extension = output_compression_extension(options->compression);
+    if (extension[0] && !has_extension(output_path, extension)) {
+        snprintf(compressed_path, sizeof(compressed_path), "%s%s", output_path, extension);
+        output_path = compressed_path;
+    }
+    built = built &&
+            chart_ir_write_file_compressed(&ir, output_path, options->compression, options->compression_level);
+    chart_ir_free(&ir);
+    free(content);
+    return built;
+}
+
+int main(const int argc, char *argv[]) {
+    enable_ansi_colors(); // Enable ANSI colors on Windows
+
+    const char *input_path = NULL;
+    const char *output_path = NULL;
+    batch_options batch;
+    batch_options_init(&batch);
+    batch.all_formats = 1;
+
+    const char **inputs = malloc(sizeof(const char *) * (size_t) (argc > 1 ? argc : 1));
+    if (!inputs) {
+        fprintf(stderr, RED "==> 内存分配失败\n" RESET);
+        return EXIT_FAILURE;
+    }
+    int input_count = 0;
+    int merge = 0;
+
+    // 解析命令行参数
+    int status = -1;
+    for (int i = 1; i < argc && status < 0; i++) {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            input_path = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--stage-workers") == 0 && i + 1 < argc) {
+            if (!batch_parse_stage_workers(&batch, argv[++i])) {
+                status = EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--queue-depth") == 0 && i + 1 < argc) {
+            batch.queue_depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            batch.metrics_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            if (!trace_start(argv[++i])) {
+                status = EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc) {
+            batch.metrics_interval = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--no-fsync") == 0) {
+            batch.fsync_outputs = 0;
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            batch.resume = 1;
+        } else if (strcmp(argv[i], "--retry-crashed") == 0) {
+            batch.resume = 1;
+            batch.retry_crashed = 1;
+        } else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            batch.journal_path = argv[++i];
+        } else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            if (!batch_parse_shard(argv[++i], &batch.shard_index, &batch.shard_count)) {
+                status = EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--preview") == 0 && i + 1 < argc) {
+            batch.preview_seconds = atof(argv[++i]);
+            if (batch.preview_seconds <= 0) {
+                fprintf(stderr, RED "==> 预览长度必须大于 0: %s\n" RESET, argv[i]);
+                status = EXIT_FAILURE;
+            }
+        } else if ((strcmp(argv[i], "--job-timeout") == 0 || strcmp(argv[i], "--job-memory") == 0 ||
+                    strcmp(argv[i], "--archive-limit") == 0) && i + 1 < argc) {
+            const char *name = argv[i];
+            const double value = atof(argv[++i]);
+            if (value <= 0) {
+                fprintf(stderr, RED "==> %s 必须大于 0: %s\n" RESET, name, argv[i]);
+                status = EXIT_FAILURE;
+            }
+            if (strcmp(name, "--job-timeout") == 0) {
+                batch.job_timeout = value;
+            } else if (strcmp(name, "--job-memory") == 0) {
+                batch.job_memory_limit = (size_t) (value * 1048576);
+            } else {
+                batch.archive_limit = (size_t) (value * 1048576);
+            }
+        } else if (strcmp(argv[i], "--isolate") == 0) {
+            batch.isolate = 1;
+        } else if (strcmp(argv[i], "--compress") == 0 && i + 1 < argc) {
+            if (!output_compression_parse(argv[++i], &batch.compression)) {
+                status = EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--compress-level") == 0 && i + 1 < argc) {
+            batch.compression_level = atoi(argv[++i]);
+            if (batch.compression_level < 0 || batch.compression_level > 9) {
+                fprintf(stderr, RED "==> 压缩级别必须在 0-9 之间: %s\n" RESET, argv[i]);
+                status = EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--analyze") == 0 && i + 1 < argc) {
+            if (!analysis_format_parse(argv[++i], &batch.analyze)) {
+                status = EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--merge-shards") == 0) {
+            merge = 1;
+        } else if (strcmp(argv[i], "--io") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "stdio") == 0) {
+                batch.io_backend = BATCH_IO_STDIO;
+            } else if (strcmp(argv[i], "uring") == 0) {
+                batch.io_backend = BATCH_IO_URING;
+            } else if (strcmp(argv[i], "auto") == 0) {
+                batch.io_backend = BATCH_IO_AUTO;
+            } else {
+                fprintf(stderr, RED "==> 未知的 I/O 后端: %s\n" RESET, argv[i]);
+                status = EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--validate") == 0 && i + 1 < argc) {
+            const int errors = validate_chart_file(argv[++i]);
+            if (errors == 0) {
+                printf(GREEN "==> 校验通过: %s\n" RESET, argv[i]);
+            }
+            status = errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        } else if (strcmp(argv[i], "-h") == 0) {
+            print_help(argv[0]);
+            status = EXIT_SUCCESS;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, RED "==> 未知选项: %s\n" RESET, argv[i]);
+            status = EXIT_FAILURE;
+        } else {
+            inputs[input_count++] = argv[i];
+        }
+    }
+
+    if (status < 0) {
+        if (input_path && input_count > 0) {
+            fprintf(stderr, RED "==> -f 不能与批量输入同时使用\n" RESET);
+            status = EXIT_FAILURE;
+        } else if (batch.analyze && (merge || batch.resume || batch.preview_seconds > 0 ||
+                                     batch.compression != OUTPUT_COMPRESSION_NONE)) {
+            fprintf(stderr, RED "==> --analyze 不能与 --merge-shards、--resume、--preview、--compress 同时使用\n" RESET);
+            status = EXIT_FAILURE;
+        } else if (batch.analyze && (input_path || input_count > 0)) {
+            // 单个文件同样走批量流水线，.mcz 中的每个谱面各输出一行
+            if (input_path) inputs[input_count++] = input_path;
+            batch.inputs = inputs;
+            batch.input_count = input_count;
+            batch.output_dir = "";
+            batch.analyze_path = output_path ? output_path : "-";
+            status = run_batch(&batch) ? EXIT_SUCCESS : EXIT_FAILURE;
+        } else if (merge) {
+            batch.inputs = inputs;
+            batch.input_count = input_count;
+            batch.output_dir = output_path ? output_path : "blophy_output";
+            status = batch_merge_shards(&batch) ? EXIT_SUCCESS : EXIT_FAILURE;
+        } else if (input_path) {
+            status = convert_single_file(input_path, output_path ? output_path : "Chart.json", &batch)
+                         ? EXIT_SUCCESS
+                         : EXIT_FAILURE;
+        } else if (input_count > 0) {
+            batch.inputs = inputs;
+            batch.input_count = input_count;
+            batch.output_dir = output_path ? output_path : "blophy_output";
+            status = run_batch(&batch) ? EXIT_SUCCESS : EXIT_FAILURE;
+        } else {
+            print_help(argv[0]);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    free(inputs);
+    return status;
+}